@@ -0,0 +1,70 @@
+# Copyright (C) 2017-2020 Trent Houliston <trent@houliston.me>
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+# documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+# rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to permit
+# persons to whom the Software is furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+# Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+# WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+# COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+# OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+# Location of the network compiler, either next to this file once installed or in the source tree
+if(EXISTS "${CMAKE_CURRENT_LIST_DIR}/compile_network.py")
+    set(VISUALMESH_COMPILE_NETWORK_SCRIPT "${CMAKE_CURRENT_LIST_DIR}/compile_network.py")
+else()
+    set(VISUALMESH_COMPILE_NETWORK_SCRIPT "${CMAKE_CURRENT_LIST_DIR}/../Scripts/compile_network.py")
+endif()
+
+# ~~~
+# Compile a trained network ahead of time into a static library for the CPU engine
+#
+# visualmesh_compile_network(<name> MODEL <model.yaml> [MESH <mesh model>] [SCALAR <float|double>] [UNROLL <weights>])
+#
+# Generates <name>.hpp and <name>.cpp in the current binary directory and builds them into the library <name>. Link to
+# it and pass visualmesh::compiled::<name>() to visualmesh::engine::cpu::Engine in place of a NetworkStructure.
+#
+# MODEL  the model.yaml file exported from training
+# MESH   the mesh model class the network will run on (e.g. Ring6), its number of neighbours is checked when compiling
+# SCALAR the scalar type to compile for, float by default
+# UNROLL layers with at most this many weights are written as straight line code, 2048 by default
+# ~~~
+function(visualmesh_compile_network name)
+    cmake_parse_arguments(NETWORK "" "MODEL;MESH;SCALAR;UNROLL" "" ${ARGN})
+
+    if(NOT NETWORK_MODEL)
+        message(FATAL_ERROR "visualmesh_compile_network requires a MODEL")
+    endif()
+    get_filename_component(model "${NETWORK_MODEL}" ABSOLUTE)
+
+    set(options)
+    if(NETWORK_MESH)
+        list(APPEND options --mesh ${NETWORK_MESH})
+    endif()
+    if(NETWORK_SCALAR)
+        list(APPEND options --scalar ${NETWORK_SCALAR})
+    endif()
+    if(NETWORK_UNROLL)
+        list(APPEND options --unroll ${NETWORK_UNROLL})
+    endif()
+
+    add_custom_command(
+        OUTPUT "${CMAKE_CURRENT_BINARY_DIR}/${name}.hpp" "${CMAKE_CURRENT_BINARY_DIR}/${name}.cpp"
+        COMMAND ${PYTHON_EXECUTABLE} ARGS "${VISUALMESH_COMPILE_NETWORK_SCRIPT}" "${model}" ${name}
+                "${CMAKE_CURRENT_BINARY_DIR}" ${options}
+        DEPENDS "${model}" "${VISUALMESH_COMPILE_NETWORK_SCRIPT}"
+        COMMENT "Compiling network ${name} from ${NETWORK_MODEL}")
+
+    add_library(${name} STATIC "${CMAKE_CURRENT_BINARY_DIR}/${name}.cpp")
+    target_include_directories(${name} PUBLIC "${CMAKE_CURRENT_BINARY_DIR}")
+    # Inside this project the library is visualmesh, once installed it is visualmesh::visualmesh
+    if(TARGET visualmesh)
+        target_link_libraries(${name} PUBLIC visualmesh)
+    else()
+        target_link_libraries(${name} PUBLIC visualmesh::visualmesh)
+    endif()
+endfunction(visualmesh_compile_network)
@@ -0,0 +1,281 @@
+#!/usr/bin/env python3
+
+
+# Copyright (C) 2017-2020 Trent Houliston <trent@houliston.me>
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+# documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+# rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+# permit persons to whom the Software is furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+# Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+# WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+# COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+# OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+"""
+Compiles a network from a model.yaml file into a C++ translation unit for the CPU engine.
+
+The dimensions of every layer are compile time constants and the weights are constant arrays, so the compiler is able
+to unroll and vectorise each layer for the exact network that will be deployed. Layers with few enough weights are
+written out as straight line code the same way the OpenCL engine generates its kernels.
+
+The generated header declares a function visualmesh::compiled::<name>() returning a CompiledNetwork that can be given
+to visualmesh::engine::cpu::Engine in place of a NetworkStructure.
+"""
+
+import argparse
+import os
+import re
+import struct
+
+import yaml
+
+parser = argparse.ArgumentParser(description="Compile a visual mesh network into C++ for the CPU engine")
+parser.add_argument("model", help="the model.yaml file to compile")
+parser.add_argument("name", help="the name of the generated function and files, must be a valid C++ identifier")
+parser.add_argument("output_dir", help="the directory to write <name>.hpp and <name>.cpp to")
+parser.add_argument("--scalar", default="float", choices=["float", "double"], help="the scalar type to compile for")
+parser.add_argument("--mesh", help="the mesh model the network will run on (e.g. Ring6), checked at compile time")
+parser.add_argument(
+    "--unroll", type=int, default=2048, help="layers with at most this many weights are written as straight line code"
+)
+args = parser.parse_args()
+
+if not re.match(r"^[A-Za-z_][A-Za-z0-9_]*$", args.name):
+    raise ValueError("The network name {} is not a valid C++ identifier".format(args.name))
+
+activations = {"selu": "SELU", "relu": "RELU", "softmax": "SOFTMAX", "tanh": "TANH", "linear": "LINEAR"}
+
+with open(args.model, "r") as f:
+    model = yaml.safe_load(f)
+
+if len(model) == 0 or len(model[0]) == 0:
+    raise ValueError("The model {} has no layers".format(args.model))
+
+
+def literal(v):
+    # Round through the scalar type so the literal is exactly the value the runtime loader would produce
+    if args.scalar == "float":
+        text = "{:.9g}".format(struct.unpack("f", struct.pack("f", v))[0])
+    else:
+        text = "{:.17g}".format(v)
+
+    # Make sure the literal is floating point and not an integer
+    if "." not in text and "e" not in text:
+        text = text + ".0"
+    return text + "f" if args.scalar == "float" else text
+
+
+def array(values):
+    return "{" + ", ".join(literal(v) for v in values) + "}"
+
+
+# The first layer has 4 inputs from the image for each point and its neighbours
+if "depthwise" in model[0][0]:
+    n_neighbours = len(model[0][0]["depthwise"]) - 1
+else:
+    n_neighbours = len(model[0][0]["weights"]) // 4 - 1
+scalar = args.scalar
+
+weights = []
+code = []
+input_dimensions = 4
+for conv_no, conv in enumerate(model):
+
+    code.append(
+        "    void conv{}(const int* neighbourhood, const int& n_points, const {s}* input, {s}* output, "
+        "const ActivationAccuracy& accuracy) {{".format(conv_no, s=scalar)
+    )
+    code.append("        for (int idx = 0; idx < n_points; ++idx) {")
+
+    if "depthwise" in conv[0]:
+        # Sum each channel over our neighbourhood
+        d = conv[0]["depthwise"]
+        if len(d) != n_neighbours + 1 or any(len(row) != input_dimensions for row in d):
+            raise ValueError("The depthwise weights of group {} have the wrong shape".format(conv_no))
+        code.append("            // Sum each channel over our neighbourhood")
+        code.append("            const int* neighbours = neighbourhood + idx * N_NEIGHBOURS;")
+        code.append("            {} in0[{}];".format(scalar, input_dimensions))
+        for j in range(input_dimensions):
+            # Pruned weights are left out entirely
+            points = ["idx"] + ["neighbours[{}]".format(n) for n in range(n_neighbours)]
+            terms = [
+                "input[{} * {} + {}] * {}".format(p, input_dimensions, j, literal(d[n][j]))
+                for n, p in enumerate(points)
+                if d[n][j] != 0
+            ]
+            code.append("            in0[{}] = {};".format(j, " + ".join(terms) if terms else literal(0)))
+    else:
+        # Gather from our neighbourhood
+        gathered = input_dimensions * (n_neighbours + 1)
+        code.append("            // Gather from our neighbourhood")
+        code.append("            {} in0[{}];".format(scalar, gathered))
+        code.append(
+            "            std::copy(input + idx * {d}, input + (idx + 1) * {d}, in0);".format(d=input_dimensions)
+        )
+        code.append("            for (int n = 0; n < N_NEIGHBOURS; ++n) {")
+        code.append(
+            "                const {s}* p = input + neighbourhood[idx * N_NEIGHBOURS + n] * {d};".format(
+                s=scalar, d=input_dimensions
+            )
+        )
+        code.append("                std::copy(p, p + {d}, in0 + (n + 1) * {d});".format(d=input_dimensions))
+        code.append("            }")
+        input_dimensions = gathered
+
+    for layer_no, layer in enumerate(conv):
+        w = layer["weights"]
+        b = layer["biases"]
+        output_dimensions = len(b)
+        if len(w) != input_dimensions or any(len(row) != output_dimensions for row in w):
+            raise ValueError("Layer {} of group {} has the wrong shape".format(layer_no, conv_no))
+        if layer_no > 0 and "depthwise" in layer:
+            raise ValueError("Only the first layer of a group can be depthwise separable")
+        if layer["activation"] not in activations:
+            raise ValueError("Unknown activation function {}".format(layer["activation"]))
+
+        prefix = "conv{}_layer{}".format(conv_no, layer_no)
+        src = "in{}".format(layer_no)
+        dst = "in{}".format(layer_no + 1)
+
+        code.append("")
+        code.append("            // Layer {} ({} -> {})".format(layer_no, input_dimensions, output_dimensions))
+        code.append("            {} {}[{}];".format(scalar, dst, output_dimensions))
+        if input_dimensions * output_dimensions <= args.unroll:
+            for j in range(output_dimensions):
+                # Pruned weights are left out entirely
+                terms = [literal(b[j])]
+                terms.extend(
+                    "{}[{}] * {}".format(src, i, literal(w[i][j])) for i in range(input_dimensions) if w[i][j] != 0
+                )
+                code.append("            {}[{}] = {};".format(dst, j, " + ".join(terms)))
+        else:
+            weights.append(
+                "    const {} {}_weights[{}][{}] = {{\n{}}};".format(
+                    scalar,
+                    prefix,
+                    input_dimensions,
+                    output_dimensions,
+                    "".join("      {},\n".format(array(row)) for row in w),
+                )
+            )
+            weights.append("    const {} {}_biases[{}] = {};".format(scalar, prefix, output_dimensions, array(b)))
+            code.append(
+                "            std::copy({p}_biases, {p}_biases + {n}, {d});".format(p=prefix, n=output_dimensions, d=dst)
+            )
+            code.append("            for (int i = 0; i < {}; ++i) {{".format(input_dimensions))
+            code.append("                for (int j = 0; j < {}; ++j) {{".format(output_dimensions))
+            code.append("                    {}[j] += {}[i] * {}_weights[i][j];".format(dst, src, prefix))
+            code.append("                }")
+            code.append("            }")
+        code.append(
+            "            apply_activation(ActivationFunction::{}, {}, {}, accuracy);".format(
+                activations[layer["activation"]], dst, output_dimensions
+            )
+        )
+        input_dimensions = output_dimensions
+
+    code.append("")
+    code.append("            // Save our value to the output")
+    code.append("            std::copy({v}, {v} + {d}, output + idx * {d});".format(v=dst, d=input_dimensions))
+    code.append("        }")
+    code.append("    }")
+    code.append("")
+
+# Run each group in turn ping ponging between the buffers
+code.append(
+    "    unsigned int classify(const int* neighbourhood, const int& n_points, std::vector<{s}>& input, "
+    "std::vector<{s}>& output, const ActivationAccuracy& accuracy) {{".format(s=scalar)
+)
+input_dimensions = 4
+for conv_no, conv in enumerate(model):
+    output_dimensions = len(conv[-1]["biases"])
+    code.append("        output.resize(n_points * {});".format(output_dimensions))
+    code.append("        conv{}(neighbourhood, n_points, input.data(), output.data(), accuracy);".format(conv_no))
+    code.append("        std::swap(input, output);")
+code.append("        return {};".format(len(model[-1][-1]["biases"])))
+code.append("    }")
+
+guard = "VISUALMESH_COMPILED_{}_HPP".format(args.name.upper())
+header = """// Generated by compile_network.py from {model}, do not edit
+
+#ifndef {guard}
+#define {guard}
+
+#include "visualmesh/engine/cpu/compiled_network.hpp"
+
+namespace visualmesh {{
+namespace compiled {{
+
+    /**
+     * @return the network from {model} compiled for a mesh with {n} neighbours
+     */
+    const engine::cpu::CompiledNetwork<{scalar}>& {name}();
+
+}}  // namespace compiled
+}}  // namespace visualmesh
+
+#endif  // {guard}
+""".format(
+    model=os.path.basename(args.model), guard=guard, n=n_neighbours, scalar=scalar, name=args.name
+)
+
+mesh_check = ""
+if args.mesh is not None:
+    mesh_check = (
+        '#include "visualmesh/model/{lower}.hpp"\n\n'
+        "static_assert(visualmesh::model::{mesh}<{scalar}>::N_NEIGHBOURS == {n},\n"
+        '              "The network was trained for {n} neighbours which does not match {mesh}");\n'
+    ).format(lower=args.mesh.lower(), mesh=args.mesh, scalar=scalar, n=n_neighbours)
+
+source = """// Generated by compile_network.py from {model}, do not edit
+
+#include "{name}.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include "visualmesh/engine/cpu/apply_activation.hpp"
+{mesh_check}
+namespace visualmesh {{
+namespace compiled {{
+
+    namespace {{
+
+    using engine::cpu::ActivationAccuracy;
+    using engine::cpu::apply_activation;
+
+    constexpr int N_NEIGHBOURS = {n};
+
+{body}
+
+    }}  // namespace
+
+    const engine::cpu::CompiledNetwork<{scalar}>& {name}() {{
+        static const engine::cpu::CompiledNetwork<{scalar}> network{{N_NEIGHBOURS, &classify, {n_groups}}};
+        return network;
+    }}
+
+}}  // namespace compiled
+}}  // namespace visualmesh
+""".format(
+    model=os.path.basename(args.model),
+    name=args.name,
+    mesh_check=mesh_check,
+    n=n_neighbours,
+    n_groups=len(model),
+    body="\n\n".join(part for part in ("\n".join(weights), "\n".join(code)) if part),
+    scalar=scalar,
+)
+
+os.makedirs(args.output_dir, exist_ok=True)
+for ext, content in ((".hpp", header), (".cpp", source)):
+    path = os.path.join(args.output_dir, args.name + ext)
+    # Only touch the file if it changed so dependent targets are not rebuilt needlessly
+    if not os.path.exists(path) or open(path, "r").read() != content:
+        with open(path, "w") as f:
+            f.write(content)
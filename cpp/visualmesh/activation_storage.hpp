@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) 2017-2020 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef VISUALMESH_ACTIVATION_STORAGE_HPP
+#define VISUALMESH_ACTIVATION_STORAGE_HPP
+
+namespace visualmesh {
+
+/// How an engine stores activations between layers, arithmetic is always done at the engine's Scalar precision
+enum ActivationStorage {
+    /// Store activations with the engine's Scalar type
+    FULL,
+    /// Store activations as IEEE 754 half precision floats
+    HALF,
+    /// Store activations as bfloat16, the upper 16 bits of a single precision float
+    BFLOAT16,
+};
+
+}  // namespace visualmesh
+
+#endif  // VISUALMESH_ACTIVATION_STORAGE_HPP
@@ -0,0 +1,293 @@
+/*
+ * Copyright (C) 2017-2020 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef VISUALMESH_BOUNDARY_HPP
+#define VISUALMESH_BOUNDARY_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "visualmesh/classified_mesh.hpp"
+
+namespace visualmesh {
+
+/**
+ * @brief The points of one class that have a neighbour of another class
+ */
+struct Boundary {
+    /// The class of the points on this boundary
+    unsigned int inside;
+    /// The class of the neighbours across the boundary
+    unsigned int outside;
+    /// Where the points of this boundary start in the points of every boundary
+    unsigned int first;
+    /// The number of points on this boundary
+    unsigned int size;
+    /// Where the lines of this boundary start in the lines of every boundary, only filled when ordering the points
+    unsigned int first_line;
+    /// The number of lines this boundary is made of, only filled when ordering the points
+    unsigned int n_lines;
+};
+
+/**
+ * @brief A run of points along a boundary where each point is a neighbour of the one before it
+ */
+struct BoundaryLine {
+    /// Where the points of this line start in the points of every boundary
+    unsigned int first;
+    /// The number of points in this line
+    unsigned int size;
+};
+
+/**
+ * @brief Finds the points in a classified mesh where the class changes between a point and its neighbours
+ *
+ * @details
+ *  The class of each point is the label an engine gave it, or the largest of its classifications. A point is on the
+ *  boundary from its class to another class if any of its neighbours has that other class, so a change of class gives
+ *  two boundaries, one on each side. The points of every boundary are found in one pass over the neighbourhood graph
+ *  that counts them and a second that puts them in place, stored together in one buffer ordered by the inside class
+ *  and then the outside class.
+ *
+ *  The points of each boundary can also be ordered into lines that follow the mesh. Each line starts from a point with
+ *  the fewest neighbours on the same boundary, so lines start at the ends of a boundary where there are any, and walks
+ *  to the unvisited neighbour on the boundary that has the fewest neighbours on it until there are none left.
+ *
+ *  The buffers are kept between calls so once a finder has seen a frame of the largest size it does not allocate.
+ */
+class BoundaryFinder {
+public:
+    /**
+     * @brief Finds the boundaries between classes in a classified mesh
+     *
+     * @tparam Scalar       the scalar type used for calculations and storage (normally one of float or double)
+     * @tparam N_NEIGHBOURS the number of neighbours that each point has
+     *
+     * @param classified the classified mesh to find the boundaries in
+     * @param pairs      the inside and outside class of each boundary to find, or empty to find all of them
+     * @param ordered    if the points of each boundary should be ordered into lines
+     *
+     * @return the boundaries that have any points, ordered by their inside class and then their outside class
+     */
+    template <typename Scalar, int N_NEIGHBOURS>
+    const std::vector<Boundary>& operator()(const ClassifiedMesh<Scalar, N_NEIGHBOURS>& classified,
+                                            const std::vector<std::pair<unsigned int, unsigned int>>& pairs = {},
+                                            const bool& ordered = false) {
+        boundaries.clear();
+        boundary_points.clear();
+        boundary_lines.clear();
+        if (classified.neighbourhood.empty()) { return boundaries; }
+
+        // The last point is the offscreen point, which is never on a boundary
+        const auto& neighbourhood = classified.neighbourhood;
+        const int n_points        = neighbourhood.size() - 1;
+
+        // Work out the class of each point
+        unsigned int n_classes = 0;
+        if (!classified.classifications.empty()) {
+            n_classes = classified.classifications.size() / (n_points + 1);
+            classes.resize(n_points);
+            for (int i = 0; i < n_points; ++i) {
+                const Scalar* values = classified.classifications.data() + i * n_classes;
+                classes[i]           = std::distance(values, std::max_element(values, values + n_classes));
+            }
+        }
+        else if (!classified.labels.empty()) {
+            classes.assign(classified.labels.begin(), std::next(classified.labels.begin(), n_points));
+            n_classes = *std::max_element(classes.begin(), classes.end()) + 1;
+        }
+        else {
+            return boundaries;
+        }
+
+        // Only count the boundaries that were asked for
+        wanted.assign(n_classes * n_classes, pairs.empty());
+        for (const auto& p : pairs) {
+            if (p.first < n_classes && p.second < n_classes) { wanted[p.first * n_classes + p.second] = true; }
+        }
+
+        // Count the points on each boundary, then work out where each boundary starts and put its points in place
+        counts.assign(n_classes * n_classes, 0);
+        for_each_boundary(neighbourhood, n_classes, [this](const int&, const unsigned int& boundary) {  //
+            ++counts[boundary];
+        });
+        unsigned int offset = 0;
+        for (unsigned int b = 0; b < counts.size(); ++b) {
+            if (counts[b] == 0) { continue; }
+            const unsigned int size = counts[b];
+            counts[b]               = boundaries.size();
+            boundaries.push_back(Boundary{b / n_classes, b % n_classes, offset, 0, 0, 0});
+            offset += size;
+        }
+        boundary_points.resize(offset);
+        for_each_boundary(neighbourhood, n_classes, [this](const int& i, const unsigned int& boundary) {
+            auto& b                             = boundaries[counts[boundary]];
+            boundary_points[b.first + b.size++] = i;
+        });
+
+        if (ordered) {
+            // A point can be on several boundaries so it is marked with the boundary it was last seen on
+            on_boundary.assign(n_points + 1, -1);
+            visited.assign(n_points + 1, -1);
+            degree.resize(n_points + 1);
+            for (unsigned int b = 0; b < boundaries.size(); ++b) {
+                order_boundary(neighbourhood, b);
+            }
+        }
+
+        return boundaries;
+    }
+
+    /**
+     * @brief The points of the boundaries found in the last call, a boundary's points are the size points from its
+     * first, and when ordered the points of each of its lines are together in the order they follow the boundary
+     *
+     * @return the index in the classified mesh of the points of every boundary
+     */
+    const std::vector<int>& points() const {
+        return boundary_points;
+    }
+
+    /**
+     * @brief The lines of the boundaries found in the last call when they were ordered, a boundary's lines are the
+     * n_lines lines from its first_line
+     *
+     * @return the lines of every boundary
+     */
+    const std::vector<BoundaryLine>& lines() const {
+        return boundary_lines;
+    }
+
+private:
+    /**
+     * @brief Calls a function for each point and each boundary that was asked for that the point is on
+     *
+     * @tparam N_NEIGHBOURS the number of neighbours that each point has
+     * @tparam Func         the type of the function to call
+     *
+     * @param neighbourhood the graph of the points, including the offscreen point
+     * @param n_classes     the number of classes
+     * @param func          the function to call with the point and the index of the boundary
+     */
+    template <std::size_t N_NEIGHBOURS, typename Func>
+    void for_each_boundary(const std::vector<std::array<int, N_NEIGHBOURS>>& neighbourhood,
+                           const unsigned int& n_classes,
+                           Func&& func) const {
+        const int n_points = neighbourhood.size() - 1;
+        for (int i = 0; i < n_points; ++i) {
+            const unsigned int inside = classes[i];
+            const auto& neighbours    = neighbourhood[i];
+            for (unsigned int j = 0; j < N_NEIGHBOURS; ++j) {
+                const int n = neighbours[j];
+                if (n == n_points || classes[n] == inside) { continue; }
+
+                // Only count each boundary once for a point even if several neighbours are across it
+                bool seen = false;
+                for (unsigned int k = 0; k < j; ++k) {
+                    seen = seen || (neighbours[k] != n_points && classes[neighbours[k]] == classes[n]);
+                }
+                const unsigned int boundary = inside * n_classes + classes[n];
+                if (!seen && wanted[boundary]) { func(i, boundary); }
+            }
+        }
+    }
+
+    /**
+     * @brief Reorders the points of a boundary into lines that follow the mesh
+     *
+     * @tparam N_NEIGHBOURS the number of neighbours that each point has
+     *
+     * @param neighbourhood the graph of the points, including the offscreen point
+     * @param b             the index of the boundary to order
+     */
+    template <std::size_t N_NEIGHBOURS>
+    void order_boundary(const std::vector<std::array<int, N_NEIGHBOURS>>& neighbourhood, const unsigned int& b) {
+        Boundary& boundary  = boundaries[b];
+        const auto first    = std::next(boundary_points.begin(), boundary.first);
+        const auto last     = std::next(first, boundary.size);
+        boundary.first_line = boundary_lines.size();
+
+        // Count how many neighbours of each point are on the same boundary
+        for (auto it = first; it != last; ++it) {
+            on_boundary[*it] = b;
+        }
+        for (auto it = first; it != last; ++it) {
+            degree[*it] = 0;
+            for (const auto& n : neighbourhood[*it]) {
+                degree[*it] += on_boundary[n] == int(b);
+            }
+        }
+
+        // Start lines from the ends of the boundary before any closed loops, in the order of the points
+        line.clear();
+        for (int start_degree = 0; start_degree <= int(N_NEIGHBOURS); ++start_degree) {
+            for (auto it = first; it != last; ++it) {
+                if (visited[*it] == int(b) || degree[*it] != start_degree) { continue; }
+
+                // Walk to the unvisited neighbour on the boundary with the fewest neighbours on it
+                const unsigned int line_start = line.size();
+                int point                     = *it;
+                while (point >= 0) {
+                    visited[point] = b;
+                    line.push_back(point);
+                    int next = -1;
+                    for (const auto& n : neighbourhood[point]) {
+                        if (on_boundary[n] == int(b) && visited[n] != int(b)
+                            && (next < 0 || degree[n] < degree[next])) {
+                            next = n;
+                        }
+                    }
+                    point = next;
+                }
+                boundary_lines.push_back(
+                  BoundaryLine{boundary.first + line_start, static_cast<unsigned int>(line.size() - line_start)});
+            }
+        }
+        std::copy(line.begin(), line.end(), first);
+        boundary.n_lines = boundary_lines.size() - boundary.first_line;
+    }
+
+    /// The boundaries found in the last call
+    std::vector<Boundary> boundaries;
+    /// The points of every boundary found in the last call
+    std::vector<int> boundary_points;
+    /// The lines of every boundary found in the last call when they were ordered
+    std::vector<BoundaryLine> boundary_lines;
+    /// The class of each point
+    std::vector<uint8_t> classes;
+    /// Whether each boundary was asked for, indexed by the inside class times the number of classes plus the outside
+    std::vector<bool> wanted;
+    /// The number of points on each boundary while counting, and then the index of each boundary that has points
+    std::vector<unsigned int> counts;
+    /// The last boundary that each point was found on while ordering
+    std::vector<int> on_boundary;
+    /// The last boundary that each point was added to a line of while ordering
+    std::vector<int> visited;
+    /// The number of neighbours of each point on the boundary that is being ordered
+    std::vector<int> degree;
+    /// The points of the boundary that is being ordered in the order of its lines
+    std::vector<int> line;
+};
+
+}  // namespace visualmesh
+
+#endif  // VISUALMESH_BOUNDARY_HPP
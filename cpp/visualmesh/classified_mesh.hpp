@@ -19,6 +19,9 @@
 #define VISUALMESH_CLASSIFIED_MESH_HPP
 
 #include <array>
+#include <cstdint>
+#include <map>
+#include <string>
 #include <vector>
 
 namespace visualmesh {
@@ -43,8 +46,15 @@ struct ClassifiedMesh {
     std::vector<std::array<int, N_NEIGHBOURS>> neighbourhood;
     /// The original indicies of these points in the visual mesh
     std::vector<int> global_indices;
-    /// The final output of classification in the visual mesh
+    /// The final output of classification in the visual mesh, for a branching network the output of the first head
     std::vector<Scalar> classifications;
+    /// The output of each head of a branching network by name, empty for networks without heads
+    std::map<std::string, std::vector<Scalar>> heads = {};
+    /// The index of the most likely class of each point, filled in place of classifications when an engine is only
+    /// outputting labels
+    std::vector<uint8_t> labels = {};
+    /// The probability of each point's label scaled to 0-255, only filled when the confidence was asked for
+    std::vector<uint8_t> confidence = {};
 };
 
 }  // namespace visualmesh
@@ -0,0 +1,237 @@
+/*
+ * Copyright (C) 2017-2020 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef VISUALMESH_CLUSTER_HPP
+#define VISUALMESH_CLUSTER_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "visualmesh/classified_mesh.hpp"
+#include "visualmesh/mesh.hpp"
+#include "visualmesh/utility/math.hpp"
+
+namespace visualmesh {
+
+/**
+ * @brief A connected group of points in a classified mesh that all belong to the same class
+ *
+ * @tparam Scalar the scalar type used for calculations and storage (normally one of float or double)
+ */
+template <typename Scalar>
+struct Cluster {
+    /// The index of the class that the points of this cluster belong to
+    unsigned int class_index;
+    /// Where the points of this cluster start in the points of every cluster
+    unsigned int first;
+    /// The number of points in this cluster
+    unsigned int size;
+    /// The smallest x and y pixel coordinates of the points in this cluster
+    vec2<Scalar> top_left;
+    /// The largest x and y pixel coordinates of the points in this cluster
+    vec2<Scalar> bottom_right;
+    /// The unit vector in the direction of the mean of the rays of the points, in the same space as the mesh's rays
+    vec3<Scalar> ray;
+};
+
+/**
+ * @brief Finds the clusters of connected points of each class in a classified mesh
+ *
+ * @details
+ *  A point belongs to a class if its value for that class is at least a threshold, or if an engine only output labels,
+ *  if that is its label (and its confidence is at least the threshold when it was output). The points of each class are
+ *  joined with their neighbours of the same class using union find over the neighbourhood graph, treating every link
+ *  as going both ways. The lowest index of each cluster is its root so the clusters come out in the order of their
+ *  first point.
+ *
+ *  The buffers are kept between calls so once a clusterer has seen a frame of the largest size it does not allocate.
+ *  The points of every cluster are stored together in one buffer, with each cluster holding where its points start.
+ *
+ * @tparam Scalar the scalar type used for calculations and storage (normally one of float or double)
+ */
+template <typename Scalar>
+class Clusterer {
+public:
+    /**
+     * @brief Finds the clusters of each class in a classified mesh
+     *
+     * @tparam Model        the mesh model that was classified
+     * @tparam N_NEIGHBOURS the number of neighbours that each point has
+     *
+     * @param mesh       the mesh that was classified, used to find the ray of each point
+     * @param classified the classified mesh to find the clusters in
+     * @param classes    the index of each class to find clusters for and the smallest value for a point to be in it
+     * @param min_points clusters with fewer points than this are dropped
+     *
+     * @return the clusters of every class, ordered by class and then by their first point
+     */
+    template <template <typename> class Model, int N_NEIGHBOURS>
+    const std::vector<Cluster<Scalar>>& operator()(const Mesh<Scalar, Model>& mesh,
+                                                   const ClassifiedMesh<Scalar, N_NEIGHBOURS>& classified,
+                                                   const std::vector<std::pair<unsigned int, Scalar>>& classes,
+                                                   const unsigned int& min_points = 1) {
+        clusters.clear();
+        cluster_points.clear();
+        if (classified.neighbourhood.empty()
+            || (classified.classifications.empty() && classified.labels.empty())) {
+            return clusters;
+        }
+
+        // The last point is the offscreen point, which is never part of a cluster
+        const int n_points            = classified.neighbourhood.size() - 1;
+        const bool labelled           = classified.classifications.empty();
+        const unsigned int dimensions = labelled ? 0 : classified.classifications.size() / (n_points + 1);
+        const auto& neighbourhood     = classified.neighbourhood;
+        const auto& pixels            = classified.pixel_coordinates;
+        parent.resize(n_points);
+        cluster_of.resize(n_points);
+
+        for (const auto& c : classes) {
+            const unsigned int& class_index = c.first;
+            const Scalar& threshold         = c.second;
+            const Scalar min_confidence     = threshold * Scalar(std::numeric_limits<uint8_t>::max());
+            if (!labelled && class_index >= dimensions) {
+                throw std::runtime_error("Class " + std::to_string(class_index) + " is not one of the "
+                                         + std::to_string(dimensions) + " outputs of the classified mesh");
+            }
+
+            // Find the members of the class
+            for (int i = 0; i < n_points; ++i) {
+                bool member = false;
+                if (labelled) {
+                    member = classified.labels[i] == class_index
+                             && (classified.confidence.empty() || classified.confidence[i] >= min_confidence);
+                }
+                else {
+                    member = classified.classifications[i * dimensions + class_index] >= threshold;
+                }
+                parent[i] = member ? i : -1;
+            }
+
+            // Join every member to the members among its neighbours, a point is not always a neighbour of its own
+            // neighbours so this is done for every link rather than only the links to earlier points
+            for (int i = 0; i < n_points; ++i) {
+                if (parent[i] < 0) { continue; }
+                for (const auto& n : neighbourhood[i]) {
+                    if (n < n_points && parent[n] >= 0) {
+                        const int a            = find(i);
+                        const int b            = find(n);
+                        parent[std::max(a, b)] = std::min(a, b);
+                    }
+                }
+            }
+
+            // Give each root a cluster and add up the sizes, bounds and rays of the clusters
+            const unsigned int first_cluster = clusters.size();
+            for (int i = 0; i < n_points; ++i) {
+                if (parent[i] < 0) { continue; }
+                const int root = find(i);
+                if (root == i) {
+                    cluster_of[i] = clusters.size();
+                    clusters.push_back(Cluster<Scalar>{class_index, 0, 0, pixels[i], pixels[i], {{0, 0, 0}}});
+                }
+                else {
+                    cluster_of[i] = cluster_of[root];
+                }
+
+                auto& cluster           = clusters[cluster_of[i]];
+                const auto& px          = pixels[i];
+                cluster.top_left[0]     = std::min(cluster.top_left[0], px[0]);
+                cluster.top_left[1]     = std::min(cluster.top_left[1], px[1]);
+                cluster.bottom_right[0] = std::max(cluster.bottom_right[0], px[0]);
+                cluster.bottom_right[1] = std::max(cluster.bottom_right[1], px[1]);
+                cluster.ray             = add(cluster.ray, mesh.nodes[classified.global_indices[i]].ray);
+                ++cluster.size;
+            }
+
+            // Drop the small clusters and work out where the points of the others start
+            remap.resize(clusters.size() - first_cluster);
+            unsigned int kept = first_cluster;
+            for (unsigned int i = first_cluster; i < clusters.size(); ++i) {
+                Cluster<Scalar> cluster = clusters[i];
+                if (cluster.size < min_points) {
+                    remap[i - first_cluster] = -1;
+                    continue;
+                }
+                cluster.first            = cluster_points.size();
+                cluster.ray              = normalise(cluster.ray);
+                remap[i - first_cluster] = kept;
+                clusters[kept++]         = cluster;
+                cluster_points.resize(cluster_points.size() + cluster.size);
+            }
+            clusters.resize(kept);
+
+            // Put the points of each cluster in place, counting the size back up as they are added
+            for (unsigned int i = first_cluster; i < kept; ++i) {
+                clusters[i].size = 0;
+            }
+            for (int i = 0; i < n_points; ++i) {
+                if (parent[i] < 0 || remap[cluster_of[i] - first_cluster] < 0) { continue; }
+                auto& cluster                                  = clusters[remap[cluster_of[i] - first_cluster]];
+                cluster_points[cluster.first + cluster.size++] = i;
+            }
+        }
+
+        return clusters;
+    }
+
+    /**
+     * @brief The points of the clusters found in the last call, a cluster's points are the size points from its first
+     *
+     * @return the index in the classified mesh of the points of every cluster
+     */
+    const std::vector<int>& points() const {
+        return cluster_points;
+    }
+
+private:
+    /**
+     * @brief Finds the root of the cluster that a point is in, halving the path to it as it goes
+     *
+     * @param i the point to find the root of
+     *
+     * @return the root of the point's cluster
+     */
+    int find(int i) {
+        while (parent[i] != i) {
+            parent[i] = parent[parent[i]];
+            i         = parent[i];
+        }
+        return i;
+    }
+
+    /// The clusters found in the last call
+    std::vector<Cluster<Scalar>> clusters;
+    /// The points of every cluster found in the last call, each cluster's points are together and in order
+    std::vector<int> cluster_points;
+    /// The parent of each point in the union find, or -1 if the point is not in the class
+    std::vector<int> parent;
+    /// The cluster that each point is in
+    std::vector<int> cluster_of;
+    /// Where each cluster of the current class ended up after the small clusters were dropped, or -1 if it was dropped
+    std::vector<int> remap;
+};
+
+}  // namespace visualmesh
+
+#endif  // VISUALMESH_CLUSTER_HPP
@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2017-2020 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef VISUALMESH_ENGINE_BRANCHING_HPP
+#define VISUALMESH_ENGINE_BRANCHING_HPP
+
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "visualmesh/classified_mesh.hpp"
+#include "visualmesh/network_structure.hpp"
+
+namespace visualmesh {
+namespace engine {
+
+    /**
+     * @brief Lists the parts of a branching network in the order the engines hold them, the trunk and then each head
+     *
+     * @tparam Scalar the scalar type used for calculations and storage (normally one of float or double)
+     *
+     * @param network the branching network to split up
+     *
+     * @return the structure of the trunk followed by the structure of each head
+     */
+    template <typename Scalar>
+    std::vector<NetworkStructure<Scalar>> trunk_and_heads(const BranchingNetwork<Scalar>& network) {
+        if (network.heads.empty()) { throw std::runtime_error("A branching network needs at least one head"); }
+
+        std::vector<NetworkStructure<Scalar>> structures = {network.trunk};
+        for (const auto& head : network.heads) {
+            if (head.structure.empty() || head.structure.front().empty()) {
+                throw std::runtime_error("The head " + head.name + " of the branching network has no layers");
+            }
+            structures.push_back(head.structure);
+        }
+        return structures;
+    }
+
+    /**
+     * @brief Lists the names of the heads of a branching network in order
+     *
+     * @tparam Scalar the scalar type used for calculations and storage (normally one of float or double)
+     *
+     * @param network the branching network to list the heads of
+     *
+     * @return the name of each head
+     */
+    template <typename Scalar>
+    std::vector<std::string> head_names_of(const BranchingNetwork<Scalar>& network) {
+        std::vector<std::string> names;
+        for (const auto& head : network.heads) {
+            names.push_back(head.name);
+        }
+        return names;
+    }
+
+    /**
+     * @brief Copies a range of points from the output of each head into a classified mesh, with the first head also
+     * being used as its classifications
+     *
+     * @tparam Scalar       the scalar type used for calculations and storage (normally one of float or double)
+     * @tparam N_NEIGHBOURS the number of neighbours that each point has
+     *
+     * @param names      the name of each head
+     * @param outputs    the output of each head and the number of values for each point in it
+     * @param first      the first point to copy
+     * @param last       one past the last point to copy
+     * @param classified the classified mesh to fill in
+     */
+    template <typename Scalar, int N_NEIGHBOURS>
+    void assign_heads(const std::vector<std::string>& names,
+                      const std::vector<std::pair<std::vector<Scalar>, unsigned int>>& outputs,
+                      const unsigned int& first,
+                      const unsigned int& last,
+                      ClassifiedMesh<Scalar, N_NEIGHBOURS>& classified) {
+        for (unsigned int head = 0; head < outputs.size(); ++head) {
+            const auto& output    = outputs[head].first;
+            const auto dimensions = outputs[head].second;
+            classified.heads[names[head]].assign(std::next(output.begin(), first * dimensions),
+                                                 std::next(output.begin(), last * dimensions));
+        }
+        classified.classifications = classified.heads[names.front()];
+    }
+
+}  // namespace engine
+}  // namespace visualmesh
+
+#endif  // VISUALMESH_ENGINE_BRANCHING_HPP
@@ -0,0 +1,113 @@
+/*
+ * Copyright (C) 2017-2020 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef VISUALMESH_ENGINE_CPU_ACTIVATION_CACHE_HPP
+#define VISUALMESH_ENGINE_CPU_ACTIVATION_CACHE_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace visualmesh {
+namespace engine {
+    namespace cpu {
+
+        /**
+         * @brief Remembers the activations of every group of a network from the last frame so that only the points
+         * whose input changed, and the points that read from them, need to be classified again
+         *
+         * @details
+         *  Each point is identified by its index in the mesh, so the cache is only used while the same mesh is being
+         *  classified. A point is recomputed for a group if it is new, if the number of its neighbours on screen has
+         *  changed, or if it or one of its neighbours was recomputed for the group before. At the input a point
+         *  changes when any of its sampled values moves by more than the threshold.
+         *
+         *  The stored input of a point is only replaced when it is recomputed, so the cached activations always match
+         *  the stored inputs and slow changes eventually exceed the threshold rather than accumulating error.
+         *
+         * @tparam Scalar the scalar type used for calculations and storage (normally one of float or double)
+         */
+        template <typename Scalar>
+        class ActivationCache {
+        public:
+            /**
+             * @brief Set how far a sampled value can move before its point is classified again
+             *
+             * @param threshold the largest change in a sampled value for which a point is reused, 0 disables reuse
+             */
+            void set_threshold(const Scalar& threshold) {
+                this->threshold = threshold;
+                clear();
+            }
+
+            /**
+             * @return true if the cache will be used
+             */
+            bool enabled() const {
+                return threshold > 0;
+            }
+
+            /**
+             * @brief Forget the previous frame
+             */
+            void clear() {
+                mesh = nullptr;
+                global_indices.clear();
+                onscreen.clear();
+                activations.clear();
+            }
+
+            /**
+             * @brief Finds the row that each point of a new frame had in the previous frame
+             *
+             * @param mesh           the mesh that the points come from
+             * @param global_indices the index of each point of the new frame in the mesh
+             *
+             * @return the row of each point in the previous frame, or -1 if it was not in the previous frame
+             */
+            std::vector<int> rows(const void* mesh, const std::vector<int>& global_indices) const {
+                std::vector<int> out(global_indices.size(), -1);
+                if (mesh != this->mesh || this->global_indices.empty()) { return out; }
+
+                std::vector<int> lookup(
+                  *std::max_element(this->global_indices.begin(), this->global_indices.end()) + 1, -1);
+                for (unsigned int i = 0; i < this->global_indices.size(); ++i) {
+                    lookup[this->global_indices[i]] = i;
+                }
+                for (unsigned int i = 0; i < global_indices.size(); ++i) {
+                    if (global_indices[i] < int(lookup.size())) { out[i] = lookup[global_indices[i]]; }
+                }
+                return out;
+            }
+
+            /// The largest change in a sampled value for which a point is reused
+            Scalar threshold = Scalar(0.0);
+            /// The mesh that the previous frame came from
+            const void* mesh = nullptr;
+            /// The index in the mesh of each point of the previous frame
+            std::vector<int> global_indices;
+            /// The number of neighbours of each point of the previous frame that were on screen
+            std::vector<uint8_t> onscreen;
+            /// The input of each point of the previous frame followed by the output of each group of the network
+            std::vector<std::vector<Scalar>> activations;
+        };
+
+    }  // namespace cpu
+}  // namespace engine
+}  // namespace visualmesh
+
+#endif  // VISUALMESH_ENGINE_CPU_ACTIVATION_CACHE_HPP
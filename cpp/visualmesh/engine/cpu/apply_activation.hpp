@@ -20,8 +20,10 @@
 
 #include <algorithm>
 #include <cmath>
-#include <vector>
+#include <limits>
+#include <numeric>
 
+#include "fast_math.hpp"
 #include "visualmesh/network_structure.hpp"
 
 namespace visualmesh {
@@ -31,8 +33,8 @@ namespace engine {
         namespace activation {
 
             template <typename Scalar>
-            void selu(std::vector<Scalar>& data, const int& /*dimensions*/) {
-                std::transform(data.begin(), data.end(), data.begin(), [](const Scalar& s) {
+            void selu(Scalar* data, const int& dimensions) {
+                std::transform(data, data + dimensions, data, [](const Scalar& s) {
                     constexpr const Scalar lambda = 1.0507009873554804934193349852946;
                     constexpr const Scalar alpha  = 1.6732632423543772848170429916717;
                     return lambda * (s >= 0 ? s : alpha * std::exp(s) - alpha);
@@ -40,36 +42,152 @@ namespace engine {
             }
 
             template <typename Scalar>
-            void relu(std::vector<Scalar>& data, const int& /*dimensions*/) {
+            void relu(Scalar* data, const int& dimensions) {
                 std::transform(
-                  data.begin(), data.end(), data.begin(), [](const Scalar& s) { return std::max(s, Scalar(0.0)); });
+                  data, data + dimensions, data, [](const Scalar& s) { return std::max(s, Scalar(0.0)); });
             }
 
             template <typename Scalar>
-            void tanh(std::vector<Scalar>& data, const int& /*dimensions*/) {
-                std::transform(data.begin(), data.end(), data.begin(), [](const Scalar& s) {  //
+            void tanh(Scalar* data, const int& dimensions) {
+                std::transform(data, data + dimensions, data, [](const Scalar& s) {  //
                     return std::tanh(s);
                 });
             }
 
             template <typename Scalar>
-            void softmax(std::vector<Scalar>& data, const int& dimensions) {
-                std::transform(data.begin(), data.end(), data.begin(), [](const Scalar& s) { return std::exp(s); });
-                for (auto it = data.begin(); it < data.end(); std::advance(it, dimensions)) {
-                    const auto end = std::next(it, dimensions);
-                    Scalar total   = std::accumulate(it, end, Scalar(0.0));
-                    std::transform(it, end, it, [total](const Scalar& s) { return s / total; });
+            void softmax(Scalar* data, const int& dimensions) {
+                std::transform(data, data + dimensions, data, [](const Scalar& s) { return std::exp(s); });
+                Scalar total = std::accumulate(data, data + dimensions, Scalar(0.0));
+                std::transform(data, data + dimensions, data, [total](const Scalar& s) { return s / total; });
+            }
+
+            /**
+             * @brief Applies an activation function to one point using the polynomial approximations of exp and tanh
+             *
+             * @details
+             *  With AVX2 and FMA blocks of eight values are done at once and whatever is left over is done one at a
+             *  time. Softmax subtracts the largest value before exponentiating so the clamping of exp can never change
+             *  the result.
+             *
+             * @tparam A the accuracy of the approximations to use
+             *
+             * @param fn         the activation function to apply
+             * @param data       the values of the point
+             * @param dimensions the number of values in the point
+             */
+            template <ActivationAccuracy A>
+            void approximate(const ActivationFunction& fn, float* data, const int& dimensions) {
+                constexpr float lambda = 1.0507009873554804934193349852946f;
+                constexpr float alpha  = 1.6732632423543772848170429916717f;
+
+                int i = 0;
+                switch (fn) {
+                    case ActivationFunction::SELU: {
+#if defined(__AVX2__) && defined(__FMA__)
+                        const __m256 l  = _mm256_set1_ps(lambda);
+                        const __m256 la = _mm256_set1_ps(lambda * alpha);
+                        for (; i + 8 <= dimensions; i += 8) {
+                            const __m256 v = _mm256_loadu_ps(data + i);
+                            const __m256 n = _mm256_fmsub_ps(la, fast_math::exp<A>(v), la);
+                            const __m256 p = _mm256_mul_ps(l, v);
+                            _mm256_storeu_ps(data + i,
+                                             _mm256_blendv_ps(n, p, _mm256_cmp_ps(v, _mm256_setzero_ps(), _CMP_GE_OQ)));
+                        }
+#endif
+                        for (; i < dimensions; ++i) {
+                            const float s = data[i];
+                            data[i] = s >= 0 ? lambda * s : lambda * alpha * fast_math::exp<A>(s) - lambda * alpha;
+                        }
+                    } break;
+                    case ActivationFunction::RELU: relu(data, dimensions); break;
+                    case ActivationFunction::TANH: {
+#if defined(__AVX2__) && defined(__FMA__)
+                        for (; i + 8 <= dimensions; i += 8) {
+                            _mm256_storeu_ps(data + i, fast_math::tanh<A>(_mm256_loadu_ps(data + i)));
+                        }
+#endif
+                        for (; i < dimensions; ++i) {
+                            data[i] = fast_math::tanh<A>(data[i]);
+                        }
+                    } break;
+                    case ActivationFunction::SOFTMAX: {
+                        const float largest = *std::max_element(data, data + dimensions);
+
+                        // Exponentiate and sum
+                        float total = 0.0f;
+#if defined(__AVX2__) && defined(__FMA__)
+                        __m256 totals = _mm256_setzero_ps();
+                        for (; i + 8 <= dimensions; i += 8) {
+                            const __m256 e =
+                              fast_math::exp<A>(_mm256_sub_ps(_mm256_loadu_ps(data + i), _mm256_set1_ps(largest)));
+                            _mm256_storeu_ps(data + i, e);
+                            totals = _mm256_add_ps(totals, e);
+                        }
+                        alignas(32) float lanes[8];
+                        _mm256_store_ps(lanes, totals);
+                        total = std::accumulate(lanes, lanes + 8, total);
+#endif
+                        for (; i < dimensions; ++i) {
+                            data[i] = fast_math::exp<A>(data[i] - largest);
+                            total += data[i];
+                        }
+
+                        // Normalise
+                        const float inverse = 1.0f / total;
+                        std::transform(
+                          data, data + dimensions, data, [inverse](const float& s) { return s * inverse; });
+                    } break;
+                    case ActivationFunction::LINEAR: break;
                 }
             }
         }  // namespace activation
 
+        /**
+         * @brief Applies an activation function to the values of a single point. Applying it to each point as soon as
+         * its layer output is computed means the values are still in cache rather than making another pass over the
+         * whole layer.
+         *
+         * @tparam Scalar the scalar type used for calculations and storage (normally one of float or double)
+         *
+         * @param fn         the activation function to apply
+         * @param data       the values of the point
+         * @param dimensions the number of values in the point
+         * @param accuracy   only used by the single precision overload, other types always use the standard library
+         */
         template <typename Scalar>
-        void apply_activation(const ActivationFunction& fn, std::vector<Scalar>& data, const int& dimensions) {
+        void apply_activation(const ActivationFunction& fn,
+                              Scalar* data,
+                              const int& dimensions,
+                              const ActivationAccuracy& /*accuracy*/ = ActivationAccuracy::EXACT) {
             switch (fn) {
                 case ActivationFunction::SELU: activation::selu(data, dimensions); break;
                 case ActivationFunction::RELU: activation::relu(data, dimensions); break;
                 case ActivationFunction::TANH: activation::tanh(data, dimensions); break;
                 case ActivationFunction::SOFTMAX: activation::softmax(data, dimensions); break;
+                case ActivationFunction::LINEAR: break;
+            }
+        }
+
+        /**
+         * @brief Applies an activation function to the values of a single point using the requested accuracy
+         *
+         * @param fn         the activation function to apply
+         * @param data       the values of the point
+         * @param dimensions the number of values in the point
+         * @param accuracy   how closely exp and tanh are approximated
+         */
+        inline void apply_activation(const ActivationFunction& fn,
+                                     float* data,
+                                     const int& dimensions,
+                                     const ActivationAccuracy& accuracy = ActivationAccuracy::EXACT) {
+            switch (accuracy) {
+                case ActivationAccuracy::EXACT: apply_activation<float>(fn, data, dimensions); break;
+                case ActivationAccuracy::ACCURATE:
+                    activation::approximate<ActivationAccuracy::ACCURATE>(fn, data, dimensions);
+                    break;
+                case ActivationAccuracy::FAST:
+                    activation::approximate<ActivationAccuracy::FAST>(fn, data, dimensions);
+                    break;
             }
         }
 
@@ -0,0 +1,251 @@
+/*
+ * Copyright (C) 2017-2020 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef VISUALMESH_ENGINE_CPU_BILINEAR_SAMPLER_HPP
+#define VISUALMESH_ENGINE_CPU_BILINEAR_SAMPLER_HPP
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "visualmesh/utility/math.hpp"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace visualmesh {
+namespace engine {
+    namespace cpu {
+
+        namespace bilinear {
+
+            /// The weights of the two pixels either side of a point sum to this, so the four corners sum to its square
+            constexpr int ONE = 256;
+
+            /**
+             * @brief Finds the two pixels either side of a coordinate, clamped to the image, and the fixed point weight
+             * of the second one
+             *
+             * @param p    the coordinate along one axis of the image
+             * @param size the size of the image along that axis
+             * @param c0   the pixel at or before p
+             * @param c1   the pixel after p
+             * @param w    how much of c1 to use, between 0 and ONE
+             */
+            template <typename Scalar>
+            inline void corners(const Scalar& p, const int& size, int& c0, int& c1, int& w) {
+                const Scalar f = std::floor(p);
+                w              = int(std::nearbyint((p - f) * Scalar(ONE)));
+                c0             = std::min(std::max(int(f), 0), size - 1);
+                c1             = std::min(std::max(int(f) + 1, 0), size - 1);
+            }
+
+            /**
+             * @brief Samples a range of points from an 8 bit RGB image one at a time
+             *
+             * @param pixels     the pixel coordinates to sample the image at
+             * @param first      the index of the first point to sample
+             * @param image      the image to sample from
+             * @param dimensions the dimensions of the image
+             * @param depth      the number of bytes in each pixel, 3 for RGB or 4 for RGBA
+             * @param R          the byte offset of the red channel in each pixel
+             * @param B          the byte offset of the blue channel in each pixel
+             * @param output     where to write the RGBA values of each point, starting with the first point
+             */
+            template <typename Scalar>
+            inline void sample_rgb(const std::vector<std::array<Scalar, 2>>& pixels,
+                                   const std::size_t& first,
+                                   const uint8_t* const image,
+                                   const vec2<int>& dimensions,
+                                   const int& depth,
+                                   const int& R,
+                                   const int& B,
+                                   Scalar* output) {
+                for (std::size_t i = first; i < pixels.size(); ++i, output += 4) {
+                    int x0, x1, wx, y0, y1, wy;
+                    corners(pixels[i][0], dimensions[0], x0, x1, wx);
+                    corners(pixels[i][1], dimensions[1], y0, y1, wy);
+
+                    const std::array<const uint8_t*, 4> q = {{image + (y0 * dimensions[0] + x0) * depth,
+                                                              image + (y0 * dimensions[0] + x1) * depth,
+                                                              image + (y1 * dimensions[0] + x0) * depth,
+                                                              image + (y1 * dimensions[0] + x1) * depth}};
+                    const std::array<int, 4> w = {
+                      {(ONE - wx) * (ONE - wy), wx * (ONE - wy), (ONE - wx) * wy, wx * wy}};
+
+                    const std::array<int, 4> channel = {{R, 1, B, 3}};
+                    for (int c = 0; c < 4; ++c) {
+                        int sum = 0;
+                        if (c < 3 || depth == 4) {
+                            for (int k = 0; k < 4; ++k) {
+                                sum += w[k] * q[k][channel[c]];
+                            }
+                        }
+                        output[c] = Scalar(sum) * Scalar(1.0 / (255.0 * ONE * ONE));
+                    }
+                }
+            }
+
+        }  // namespace bilinear
+
+        /**
+         * @brief Bilinearly samples an 8 bit RGB image at each pixel coordinate, writing RGBA values to the output
+         *
+         * @details The weights of the four surrounding pixels are calculated in fixed point and the bytes are summed
+         * as integers, so each value is only converted and normalised once. Points on a pixel boundary use a weight of
+         * zero for the pixel past it, and pixels past the edge of the image are clamped to the edge.
+         *
+         * @param pixels     the pixel coordinates to sample the image at
+         * @param image      the image to sample from
+         * @param dimensions the dimensions of the image
+         * @param depth      the number of bytes in each pixel, 3 for RGB or 4 for RGBA
+         * @param R          the byte offset of the red channel in each pixel
+         * @param B          the byte offset of the blue channel in each pixel
+         * @param output     where to write the four values of each point
+         */
+        template <typename Scalar>
+        inline void sample_rgb(const std::vector<std::array<Scalar, 2>>& pixels,
+                               const uint8_t* const image,
+                               const vec2<int>& dimensions,
+                               const int& depth,
+                               const int& R,
+                               const int& B,
+                               Scalar* output) {
+            bilinear::sample_rgb(pixels, 0, image, dimensions, depth, R, B, output);
+        }
+
+#if defined(__AVX2__)
+        /**
+         * @brief Bilinearly samples an 8 bit RGB image at each pixel coordinate eight points at a time, gathering the
+         * four pixels around each point and giving the same result as the scalar version
+         */
+        inline void sample_rgb(const std::vector<std::array<float, 2>>& pixels,
+                               const uint8_t* const image,
+                               const vec2<int>& dimensions,
+                               const int& depth,
+                               const int& R,
+                               const int& B,
+                               float* output) {
+            const __m256i zero   = _mm256_setzero_si256();
+            const __m256i one    = _mm256_set1_epi32(1);
+            const __m256i full   = _mm256_set1_epi32(bilinear::ONE);
+            const __m256i bytes  = _mm256_set1_epi32(0xFF);
+            const __m256i width  = _mm256_set1_epi32(dimensions[0]);
+            const __m256i max_x  = _mm256_set1_epi32(dimensions[0] - 1);
+            const __m256i max_y  = _mm256_set1_epi32(dimensions[1] - 1);
+            const __m256i stride = _mm256_set1_epi32(depth);
+            const __m256 scale   = _mm256_set1_ps(float(1.0 / (255.0 * bilinear::ONE * bilinear::ONE)));
+            const __m256 weight  = _mm256_set1_ps(float(bilinear::ONE));
+
+            // How far to shift each gathered pixel to get the red, green, blue and alpha bytes
+            const __m256i shifts[4] = {
+              _mm256_set1_epi32(8 * R), _mm256_set1_epi32(8), _mm256_set1_epi32(8 * B), _mm256_set1_epi32(24)};
+
+            // A three byte pixel is read as four bytes, so the very last pixel of the image can't be gathered
+            const __m256i last = _mm256_set1_epi32(dimensions[0] * dimensions[1] * depth - 4);
+
+            if (pixels.empty()) { return; }
+            const int* const base = reinterpret_cast<const int*>(image);
+            const float* p        = pixels.front().data();
+
+            std::size_t i = 0;
+            for (; i + 8 <= pixels.size(); i += 8, p += 16) {
+                // Split the coordinates of the eight points into x and y
+                const __m256 a = _mm256_loadu_ps(p);
+                const __m256 b = _mm256_loadu_ps(p + 8);
+                const __m256 x = _mm256_castpd_ps(
+                  _mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0))), 0xD8));
+                const __m256 y = _mm256_castpd_ps(
+                  _mm256_permute4x64_pd(_mm256_castps_pd(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1))), 0xD8));
+
+                // Find the surrounding pixels and the fixed point weights, the same as bilinear::corners
+                const __m256 fx  = _mm256_floor_ps(x);
+                const __m256 fy  = _mm256_floor_ps(y);
+                const __m256i wx = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_sub_ps(x, fx), weight));
+                const __m256i wy = _mm256_cvtps_epi32(_mm256_mul_ps(_mm256_sub_ps(y, fy), weight));
+                const __m256i ix = _mm256_cvttps_epi32(fx);
+                const __m256i iy = _mm256_cvttps_epi32(fy);
+                const __m256i x0 = _mm256_min_epi32(_mm256_max_epi32(ix, zero), max_x);
+                const __m256i x1 = _mm256_min_epi32(_mm256_max_epi32(_mm256_add_epi32(ix, one), zero), max_x);
+                const __m256i y0 = _mm256_mullo_epi32(_mm256_min_epi32(_mm256_max_epi32(iy, zero), max_y), width);
+                const __m256i y1 = _mm256_mullo_epi32(
+                  _mm256_min_epi32(_mm256_max_epi32(_mm256_add_epi32(iy, one), zero), max_y), width);
+
+                const __m256i offsets[4] = {_mm256_mullo_epi32(_mm256_add_epi32(y0, x0), stride),
+                                            _mm256_mullo_epi32(_mm256_add_epi32(y0, x1), stride),
+                                            _mm256_mullo_epi32(_mm256_add_epi32(y1, x0), stride),
+                                            _mm256_mullo_epi32(_mm256_add_epi32(y1, x1), stride)};
+
+                // The bottom right pixel is the furthest into the image, fall back if it is the last pixel
+                if (_mm256_movemask_epi8(_mm256_cmpgt_epi32(offsets[3], last)) != 0) { break; }
+
+                const __m256i nx = _mm256_sub_epi32(full, wx);
+                const __m256i ny = _mm256_sub_epi32(full, wy);
+                const __m256i w[4] = {_mm256_mullo_epi32(nx, ny),
+                                      _mm256_mullo_epi32(wx, ny),
+                                      _mm256_mullo_epi32(nx, wy),
+                                      _mm256_mullo_epi32(wx, wy)};
+
+                __m256i q[4];
+                for (int k = 0; k < 4; ++k) {
+                    q[k] = _mm256_i32gather_epi32(base, offsets[k], 1);
+                }
+
+                // Weight the bytes of each channel and sum them as integers
+                __m256 c[4];
+                for (int ch = 0; ch < 4; ++ch) {
+                    if (ch == 3 && depth == 3) {
+                        c[ch] = _mm256_setzero_ps();
+                        continue;
+                    }
+                    __m256i sum = zero;
+                    for (int k = 0; k < 4; ++k) {
+                        const __m256i v = _mm256_and_si256(_mm256_srlv_epi32(q[k], shifts[ch]), bytes);
+                        sum             = _mm256_add_epi32(sum, _mm256_mullo_epi32(w[k], v));
+                    }
+                    c[ch] = _mm256_mul_ps(_mm256_cvtepi32_ps(sum), scale);
+                }
+
+                // Interleave the channels so each point is written as RGBA
+                const __m256 rg_lo = _mm256_unpacklo_ps(c[0], c[1]);
+                const __m256 rg_hi = _mm256_unpackhi_ps(c[0], c[1]);
+                const __m256 ba_lo = _mm256_unpacklo_ps(c[2], c[3]);
+                const __m256 ba_hi = _mm256_unpackhi_ps(c[2], c[3]);
+                const __m256 p04   = _mm256_shuffle_ps(rg_lo, ba_lo, _MM_SHUFFLE(1, 0, 1, 0));
+                const __m256 p15   = _mm256_shuffle_ps(rg_lo, ba_lo, _MM_SHUFFLE(3, 2, 3, 2));
+                const __m256 p26   = _mm256_shuffle_ps(rg_hi, ba_hi, _MM_SHUFFLE(1, 0, 1, 0));
+                const __m256 p37   = _mm256_shuffle_ps(rg_hi, ba_hi, _MM_SHUFFLE(3, 2, 3, 2));
+                _mm256_storeu_ps(output + i * 4 + 0, _mm256_permute2f128_ps(p04, p15, 0x20));
+                _mm256_storeu_ps(output + i * 4 + 8, _mm256_permute2f128_ps(p26, p37, 0x20));
+                _mm256_storeu_ps(output + i * 4 + 16, _mm256_permute2f128_ps(p04, p15, 0x31));
+                _mm256_storeu_ps(output + i * 4 + 24, _mm256_permute2f128_ps(p26, p37, 0x31));
+            }
+
+            // Whatever is left over is done one at a time
+            bilinear::sample_rgb(pixels, i, image, dimensions, depth, R, B, output + i * 4);
+        }
+#endif
+
+    }  // namespace cpu
+}  // namespace engine
+}  // namespace visualmesh
+
+#endif  // VISUALMESH_ENGINE_CPU_BILINEAR_SAMPLER_HPP
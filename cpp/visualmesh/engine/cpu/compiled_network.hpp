@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2017-2020 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef VISUALMESH_ENGINE_CPU_COMPILED_NETWORK_HPP
+#define VISUALMESH_ENGINE_CPU_COMPILED_NETWORK_HPP
+
+#include <vector>
+
+#include "fast_math.hpp"
+
+namespace visualmesh {
+namespace engine {
+    namespace cpu {
+
+        /**
+         * @brief A network that has been compiled ahead of time into C++ by cmake/Scripts/compile_network.py.
+         * These are made with the visualmesh_compile_network CMake function and can be given to the CPU engine in place
+         * of a NetworkStructure.
+         *
+         * @tparam Scalar the scalar type used for calculations and storage (normally one of float or double)
+         */
+        template <typename Scalar>
+        struct CompiledNetwork {
+            /**
+             * @brief Runs the network over a graph of points
+             *
+             * @param neighbourhood the neighbours of each point, n_neighbours values per point
+             * @param n_points      the number of points in the graph, including any offscreen points
+             * @param input         the 4 input values for each point, which will hold the output when this returns
+             * @param output        a buffer to ping/pong with while running the network
+             * @param accuracy      how closely to approximate exp and tanh in the activation functions
+             *
+             * @return the number of values for each point in the output
+             */
+            using Classify = unsigned int (*)(const int* neighbourhood,
+                                              const int& n_points,
+                                              std::vector<Scalar>& input,
+                                              std::vector<Scalar>& output,
+                                              const ActivationAccuracy& accuracy);
+
+            /// The number of neighbours each point has in the mesh the network was compiled for
+            int n_neighbours = 0;
+            /// The generated function that runs the network
+            Classify classify = nullptr;
+            /// The number of graph convolutions in the network, which is how many rings of neighbours it reads from
+            int n_groups = 0;
+        };
+
+    }  // namespace cpu
+}  // namespace engine
+}  // namespace visualmesh
+
+#endif  // VISUALMESH_ENGINE_CPU_COMPILED_NETWORK_HPP
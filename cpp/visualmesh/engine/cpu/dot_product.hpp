@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2017-2020 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef VISUALMESH_ENGINE_CPU_DOT_PRODUCT_HPP
+#define VISUALMESH_ENGINE_CPU_DOT_PRODUCT_HPP
+
+#include <cstdint>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace visualmesh {
+namespace engine {
+    namespace cpu {
+
+        /**
+         * @brief Dot product of unsigned 8 bit values with signed 8 bit values accumulated exactly in 32 bits.
+         *
+         * @details
+         *  With AVX-512 VNNI blocks of 32 bytes use vpdpbusd which multiplies and sums groups of four bytes straight
+         *  into 32 bit lanes. With AVX2 blocks of 16 bytes are widened to 16 bits and multiplied with vpmaddwd.
+         *  vpmaddubsw is not used as its 16 bit pairwise sum saturates for 255 * 127 * 2. Whatever is left over is done
+         *  with a plain loop.
+         *
+         * @param a  the unsigned values
+         * @param b  the signed values
+         * @param n  the number of values in each of a and b
+         *
+         * @return the sum of the products of a and b
+         */
+        inline int32_t dot_product(const uint8_t* a, const int8_t* b, const int& n) {
+            int i       = 0;
+            int32_t sum = 0;
+
+#if defined(__AVX2__)
+            __m256i acc = _mm256_setzero_si256();
+#if defined(__AVX512VNNI__) && defined(__AVX512VL__)
+            for (; i + 32 <= n; i += 32) {
+                const __m256i va = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + i));
+                const __m256i vb = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + i));
+                acc              = _mm256_dpbusd_epi32(acc, va, vb);
+            }
+#endif
+            for (; i + 16 <= n; i += 16) {
+                const __m256i va = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)));
+                const __m256i vb = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+                acc              = _mm256_add_epi32(acc, _mm256_madd_epi16(va, vb));
+            }
+
+            // Horizontal sum of the eight 32 bit lanes
+            __m128i s = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+            s         = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(1, 0, 3, 2)));
+            s         = _mm_add_epi32(s, _mm_shuffle_epi32(s, _MM_SHUFFLE(2, 3, 0, 1)));
+            sum       = _mm_cvtsi128_si32(s);
+#endif
+
+            for (; i < n; ++i) {
+                sum += int32_t(a[i]) * int32_t(b[i]);
+            }
+            return sum;
+        }
+
+    }  // namespace cpu
+}  // namespace engine
+}  // namespace visualmesh
+
+#endif  // VISUALMESH_ENGINE_CPU_DOT_PRODUCT_HPP
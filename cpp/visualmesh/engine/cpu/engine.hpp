@@ -18,14 +18,39 @@
 #ifndef VISUALMESH_ENGINE_CPU_ENGINE_HPP
 #define VISUALMESH_ENGINE_CPU_ENGINE_HPP
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
 #include <cstdint>
+#include <limits>
 #include <numeric>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
 
+#include "activation_cache.hpp"
 #include "apply_activation.hpp"
+#include "bilinear_sampler.hpp"
+#include "compiled_network.hpp"
+#include "dot_product.hpp"
+#include "half.hpp"
+#include "project_mesh.hpp"
+#include "read_image.hpp"
+#include "sparse_weights.hpp"
+#include "visualmesh/activation_storage.hpp"
 #include "visualmesh/classified_mesh.hpp"
+#include "visualmesh/engine/branching.hpp"
+#include "visualmesh/engine/label_outputs.hpp"
+#include "visualmesh/engine/projection_cache.hpp"
+#include "visualmesh/frame.hpp"
 #include "visualmesh/mesh.hpp"
 #include "visualmesh/network_structure.hpp"
+#include "visualmesh/optimise_network.hpp"
+#include "visualmesh/output_mode.hpp"
 #include "visualmesh/projected_mesh.hpp"
+#include "visualmesh/quantised_network.hpp"
+#include "visualmesh/region_of_interest.hpp"
 #include "visualmesh/utility/fourcc.hpp"
 #include "visualmesh/visualmesh.hpp"
 
@@ -33,6 +58,9 @@ namespace visualmesh {
 namespace engine {
     namespace cpu {
 
+        template <typename Scalar, int N_NEIGHBOURS>
+        class RowStream;
+
         /**
          * @brief The reference CPU implementation of the visual mesh inference engine
          *
@@ -50,24 +78,92 @@ namespace engine {
             /**
              * @brief Construct a new CPU Engine object
              *
-             * @param structure the network structure to use classification
+             * @param structure the network structure to use classification, simplified with optimise
+             * @param storage   how to store activations between layers, 16 bit storage halves the memory traffic of
+             *                  the gather while the arithmetic stays at Scalar precision
+             */
+            Engine(const NetworkStructure<Scalar>& structure = {},
+                   const ActivationStorage& storage          = ActivationStorage::FULL)
+              : Engine(std::vector<NetworkStructure<Scalar>>{structure}, storage) {}
+
+            /**
+             * @brief Construct a new CPU Engine object that runs several networks over the same projection and image
+             *
+             * @param structures the network structures to use for classification, each simplified with optimise. The
+             *                   first is the one used when classifying a mesh directly
+             * @param storage    how to store activations between layers
              */
-            Engine(const NetworkStructure<Scalar>& structure = {}) : structure(structure) {
-                // Transpose all the weights matrices to make it easier for us to multiply against
-                for (auto& conv : this->structure) {
+            Engine(const std::vector<NetworkStructure<Scalar>>& structures,
+                   const ActivationStorage& storage = ActivationStorage::FULL)
+              : storage(storage) {
+                for (const auto& structure : structures) {
+                    networks.push_back(optimise(structure));
+
+                    // Transpose all the weights matrices to make it easier for us to multiply against
+                    for (auto& conv : networks.back()) {
+                        for (auto& layer : conv) {
+                            auto& w = layer.weights;
+                            Weights<Scalar> new_weights(w.front().size(), std::vector<Scalar>(w.size()));
+                            for (unsigned int i = 0; i < w.size(); ++i) {
+                                for (unsigned int j = 0; j < w[i].size(); ++j) {
+                                    new_weights[j][i] = w[i][j];
+                                }
+                            }
+                            w = std::move(new_weights);
+                        }
+                    }
+                }
+
+                // Only the first network is calibrated
+                if (!networks.empty()) {
+                    for (const auto& conv : networks.front()) {
+                        calibration_ranges.emplace_back(conv.size(),
+                                                        std::make_pair(std::numeric_limits<Scalar>::infinity(),
+                                                                       -std::numeric_limits<Scalar>::infinity()));
+                    }
+                }
+                make_sparse_layers();
+            }
+
+            /**
+             * @brief Construct a new CPU Engine object that runs a branching network, running its trunk once and then
+             * each of its heads
+             *
+             * @param network the branching network to use for classification, each part simplified with optimise
+             * @param storage how to store activations between layers
+             */
+            Engine(const BranchingNetwork<Scalar>& network, const ActivationStorage& storage = ActivationStorage::FULL)
+              : Engine(trunk_and_heads(network), storage) {
+                head_names = head_names_of(network);
+            }
+
+            /**
+             * @brief Construct a new CPU Engine object that runs a quantised network with 8 bit weights and activations
+             *
+             * @param network the quantised network to use for classification
+             */
+            Engine(const QuantisedNetwork<Scalar>& network) : quantised(network) {
+                // Fold the input zero point into the biases so the inner loop is a plain dot product
+                for (auto& conv : quantised) {
                     for (auto& layer : conv) {
-                        auto& w = layer.weights;
-                        Weights<Scalar> new_weights(w.front().size(), std::vector<Scalar>(w.size()));
-                        for (unsigned int i = 0; i < w.size(); ++i) {
-                            for (unsigned int j = 0; j < w[i].size(); ++j) {
-                                new_weights[j][i] = w[i][j];
+                        for (unsigned int j = 0; j < layer.biases.size(); ++j) {
+                            int32_t sum = 0;
+                            for (const auto& w : layer.weights[j]) {
+                                sum += w;
                             }
+                            layer.biases[j] -= layer.input.zero_point * sum;
                         }
-                        w = std::move(new_weights);
                     }
                 }
             }
 
+            /**
+             * @brief Construct a new CPU Engine object that runs a network compiled ahead of time into C++
+             *
+             * @param network the compiled network to use for classification
+             */
+            Engine(const CompiledNetwork<Scalar>& network) : compiled(network) {}
+
             /**
              * @brief Projects a provided mesh to pixel coordinates
              *
@@ -85,63 +181,12 @@ namespace engine {
                                                                           const Lens<Scalar>& lens) const {
                 static constexpr int N_NEIGHBOURS = Model<Scalar>::N_NEIGHBOURS;
 
-                // Lookup the on screen ranges
-                auto ranges = mesh.lookup(Hoc, lens);
-
-                // Convenience variables
-                const auto& nodes = mesh.nodes;
-                const mat3<Scalar> Rco(block<3, 3>(transpose(Hoc)));
-
-                // Work out how many points total there are in the ranges
-                unsigned int n_points = 0;
-                for (auto& r : ranges) {
-                    n_points += r.second - r.first;
-                }
-
-                // Output variables
-                std::vector<int> global_indices;
-                global_indices.reserve(n_points);
-                std::vector<vec2<Scalar>> pixels;
-                pixels.reserve(n_points);
-
-                // Loop through adding global indices and pixel coordinates
-                for (const auto& range : ranges) {
-                    for (int i = range.first; i < range.second; ++i) {
-                        // Even though we have already gone through a bsp to remove out of range points, sometimes it's
-                        // not perfect and misses by a few pixels. So as we are projecting the points here we also need
-                        // to check that they are on screen
-                        auto px = project(multiply(Rco, nodes[i].ray), lens);
-                        if (0 <= px[0] && px[0] + 1 < lens.dimensions[0] && 0 <= px[1]
-                            && px[1] + 1 < lens.dimensions[1]) {
-                            global_indices.emplace_back(i);
-                            pixels.emplace_back(px);
-                        }
-                    }
-                }
-
-                // Update the number of points to account for how many pixels we removed
-                n_points = pixels.size();
+                // If the camera has barely moved since we last projected this mesh reuse that projection
+                if (auto cached = projection_cache.template find<N_NEIGHBOURS>(mesh, Hoc, lens)) { return *cached; }
 
-                // Build our reverse lookup, the default point goes to the null point
-                std::vector<int> r_lookup(nodes.size() + 1, n_points);
-                for (unsigned int i = 0; i < n_points; ++i) {
-                    r_lookup[global_indices[i]] = i;
-                }
-
-                // Build our local neighbourhood map
-                std::vector<std::array<int, N_NEIGHBOURS>> neighbourhood(n_points + 1);  // +1 for the null point
-                for (unsigned int i = 0; i < n_points; ++i) {
-                    const Node<Scalar, N_NEIGHBOURS>& node = nodes[global_indices[i]];
-                    for (unsigned int j = 0; j < node.neighbours.size(); ++j) {
-                        const auto& n       = node.neighbours[j];
-                        neighbourhood[i][j] = r_lookup[n];
-                    }
-                }
-                // Last point is the null point
-                neighbourhood[n_points].fill(n_points);
-
-                return ProjectedMesh<Scalar, N_NEIGHBOURS>{
-                  std::move(pixels), std::move(neighbourhood), std::move(global_indices)};
+                ProjectedMesh<Scalar, N_NEIGHBOURS> projected = project_mesh(mesh, Hoc, lens);
+                projection_cache.store(mesh, Hoc, lens, projected);
+                return projected;
             }
 
             /**
@@ -162,6 +207,50 @@ namespace engine {
                 return operator()(mesh.height(Hoc[2][3]), Hoc, lens);
             }
 
+            /**
+             * @brief Projects the part of a mesh inside a region of interest to pixel coordinates, along with the rings
+             * of neighbours around it that the network reads from when classifying the points in the region
+             *
+             * @tparam Model the mesh model that we are projecting
+             *
+             * @param mesh   the mesh table that we are projecting to pixel coordinates
+             * @param Hoc    the homogenous transformation matrix from the camera to the observation plane
+             * @param lens   the lens parameters that describe the optics of the camera
+             * @param region the part of the image to project
+             *
+             * @return a projected mesh for the provided arguments
+             */
+            template <template <typename> class Model>
+            ProjectedMesh<Scalar, Model<Scalar>::N_NEIGHBOURS> operator()(
+              const Mesh<Scalar, Model>& mesh,
+              const mat4<Scalar>& Hoc,
+              const Lens<Scalar>& lens,
+              const RegionOfInterest<Scalar>& region) const {
+                return project_region(mesh, Hoc, lens, region, receptive_field());
+            }
+
+            /**
+             * @brief Projects the part of a mesh inside a region of interest to pixel coordinates from an aggregate
+             * VisualMesh object
+             *
+             * @tparam Model the mesh model that we are projecting
+             *
+             * @param mesh   the mesh table that we are projecting to pixel coordinates
+             * @param Hoc    the homogenous transformation matrix from the camera to the observation plane
+             * @param lens   the lens parameters that describe the optics of the camera
+             * @param region the part of the image to project
+             *
+             * @return a projected mesh for the provided arguments
+             */
+            template <template <typename> class Model>
+            ProjectedMesh<Scalar, Model<Scalar>::N_NEIGHBOURS> operator()(
+              const VisualMesh<Scalar, Model>& mesh,
+              const mat4<Scalar>& Hoc,
+              const Lens<Scalar>& lens,
+              const RegionOfInterest<Scalar>& region) const {
+                return operator()(mesh.height(Hoc[2][3]), Hoc, lens, region);
+            }
+
             /**
              * @brief Project and classify a mesh using the neural network that is loaded into this engine
              *
@@ -181,184 +270,1271 @@ namespace engine {
                                                                            const Lens<Scalar>& lens,
                                                                            const void* image,
                                                                            const uint32_t& format) const {
+                // Project the pixels to the display
+                return classify_projected(operator()(mesh, Hoc, lens), lens, image, format, &mesh);
+            }
+
+            /**
+             * @brief Project and classify a mesh using the neural network that is loaded into this engine.
+             * This version takes an aggregate VisualMesh object
+             *
+             * @tparam Model the mesh model that we are projecting
+             *
+             * @param mesh    the mesh table that we are projecting to pixel coordinates
+             * @param Hoc     the homogenous transformation matrix from the camera to the observation plane
+             * @param lens    the lens parameters that describe the optics of the camera
+             * @param image   the data that represents the image the network will run from
+             * @param format  the pixel format of this image as a fourcc code
+             *
+             * @return a classified mesh for the provided arguments
+             */
+            template <template <typename> class Model>
+            ClassifiedMesh<Scalar, Model<Scalar>::N_NEIGHBOURS> operator()(const VisualMesh<Scalar, Model>& mesh,
+                                                                           const mat4<Scalar>& Hoc,
+                                                                           const Lens<Scalar>& lens,
+                                                                           const void* image,
+                                                                           const uint32_t& format) const {
+                return operator()(mesh.height(Hoc[2][3]), Hoc, lens, image, format);
+            }
+
+            /**
+             * @brief Project and classify only the part of a mesh inside a region of interest
+             *
+             * @details
+             *  The points in the region are classified along with the rings of neighbours around them that the network
+             *  reads from, so the points in the region get the same classifications as they would from the whole
+             *  image. The rings are kept in the classified mesh, and can be told apart with
+             *  RegionOfInterest::contains(px, Hoc, lens), which checks the distance band as well as the rectangle.
+             *
+             * @tparam Model the mesh model that we are projecting
+             *
+             * @param mesh    the mesh table that we are projecting to pixel coordinates
+             * @param Hoc     the homogenous transformation matrix from the camera to the observation plane
+             * @param lens    the lens parameters that describe the optics of the camera
+             * @param image   the data that represents the image the network will run from
+             * @param format  the pixel format of this image as a fourcc code
+             * @param region  the part of the image to classify
+             *
+             * @return a classified mesh for the provided arguments
+             */
+            template <template <typename> class Model>
+            ClassifiedMesh<Scalar, Model<Scalar>::N_NEIGHBOURS> operator()(
+              const Mesh<Scalar, Model>& mesh,
+              const mat4<Scalar>& Hoc,
+              const Lens<Scalar>& lens,
+              const void* image,
+              const uint32_t& format,
+              const RegionOfInterest<Scalar>& region) const {
+                return classify_projected(operator()(mesh, Hoc, lens, region), lens, image, format, &mesh);
+            }
+
+            /**
+             * @brief Project and classify only the part of a mesh inside a region of interest.
+             * This version takes an aggregate VisualMesh object
+             *
+             * @tparam Model the mesh model that we are projecting
+             *
+             * @param mesh    the mesh table that we are projecting to pixel coordinates
+             * @param Hoc     the homogenous transformation matrix from the camera to the observation plane
+             * @param lens    the lens parameters that describe the optics of the camera
+             * @param image   the data that represents the image the network will run from
+             * @param format  the pixel format of this image as a fourcc code
+             * @param region  the part of the image to classify
+             *
+             * @return a classified mesh for the provided arguments
+             */
+            template <template <typename> class Model>
+            ClassifiedMesh<Scalar, Model<Scalar>::N_NEIGHBOURS> operator()(
+              const VisualMesh<Scalar, Model>& mesh,
+              const mat4<Scalar>& Hoc,
+              const Lens<Scalar>& lens,
+              const void* image,
+              const uint32_t& format,
+              const RegionOfInterest<Scalar>& region) const {
+                return operator()(mesh.height(Hoc[2][3]), Hoc, lens, image, format, region);
+            }
+
+            /**
+             * @brief Classify a projected mesh with every network that is loaded into this engine
+             *
+             * @details
+             *  The image is sampled once at the projected pixels and that input is given to each of the networks, so
+             *  running several networks on the same camera frame only projects and samples it once.
+             *
+             * @tparam N_NEIGHBOURS the number of neighbours that each point has
+             *
+             * @param projected the projected mesh to classify, as made by projecting a mesh with this engine
+             * @param lens      the lens parameters that describe the optics of the camera
+             * @param image     the data that represents the image the networks will run from
+             * @param format    the pixel format of this image as a fourcc code
+             *
+             * @return a classified mesh for each of the networks in the order they were given
+             */
+            template <int N_NEIGHBOURS>
+            std::vector<ClassifiedMesh<Scalar, N_NEIGHBOURS>> operator()(
+              const ProjectedMesh<Scalar, N_NEIGHBOURS>& projected,
+              const Lens<Scalar>& lens,
+              const void* image,
+              const uint32_t& format) const {
+                // Quantised and compiled engines hold a single network, and the parts of a branching network run as one
+                const unsigned int n_networks = head_names.empty() ? std::max(std::size_t(1), networks.size()) : 1;
+                if (projected.global_indices.empty()) {
+                    return std::vector<ClassifiedMesh<Scalar, N_NEIGHBOURS>>(n_networks);
+                }
+
+                // Sample the image once, then run each network from a copy of those samples
+                input.clear();
+                load_image(projected.pixel_coordinates, lens, image, format);
+                const std::vector<Scalar> sampled = input;
+
+                std::vector<ClassifiedMesh<Scalar, N_NEIGHBOURS>> classified;
+                classified.reserve(n_networks);
+                for (unsigned int network = 0; network < n_networks; ++network) {
+                    if (network > 0) { input = sampled; }
+                    classified.push_back(ClassifiedMesh<Scalar, N_NEIGHBOURS>{
+                      projected.pixel_coordinates, projected.neighbourhood, projected.global_indices, {}});
+                    if (head_names.empty()) {
+                        const unsigned int dimensions = classify(projected.neighbourhood, network);
+                        assign_outputs(0, projected.neighbourhood.size(), dimensions, classified.back());
+                    }
+                    else {
+                        const auto outputs = classify_heads(projected.neighbourhood);
+                        assign_heads(head_names, outputs, 0, projected.neighbourhood.size(), classified.back());
+                        assign_labels(output_mode, outputs.front().second, classified.back());
+                    }
+                }
+
+                return classified;
+            }
+
+            /**
+             * @brief Project and classify several frames, running the network once over all of them
+             *
+             * @details
+             *  The projected points of every frame are joined into a single graph where each frame keeps its own
+             *  offscreen point, so the network weights are only streamed once for the whole batch. The results are then
+             *  split back out into one classified mesh per frame in the order they were given.
+             *
+             * @tparam Model the mesh model that we are projecting
+             *
+             * @param frames the frames to classify
+             *
+             * @return a classified mesh for each of the frames
+             */
+            template <template <typename> class Model>
+            std::vector<ClassifiedMesh<Scalar, Model<Scalar>::N_NEIGHBOURS>> operator()(
+              const std::vector<Frame<Scalar, Model>>& frames) const {
                 static constexpr int N_NEIGHBOURS = Model<Scalar>::N_NEIGHBOURS;
 
-                // Project the pixels to the display
-                ProjectedMesh<Scalar, N_NEIGHBOURS> projected = operator()(mesh, Hoc, lens);
-                auto& neighbourhood                           = projected.neighbourhood;
-                unsigned int n_points                         = neighbourhood.size();
+                // Project each frame and append it to the combined graph
+                std::vector<ProjectedMesh<Scalar, N_NEIGHBOURS>> projected;
+                projected.reserve(frames.size());
+                std::vector<std::array<int, N_NEIGHBOURS>> neighbourhood;
+                input.clear();
+                for (const auto& frame : frames) {
+                    projected.push_back(operator()(*frame.mesh, frame.Hoc, frame.lens));
+                    const auto& p = projected.back();
+                    if (p.global_indices.empty()) { continue; }
+
+                    // Shift this frame's graph to where its points start in the combined graph
+                    const int offset = neighbourhood.size();
+                    for (const auto& n : p.neighbourhood) {
+                        std::array<int, N_NEIGHBOURS> shifted;
+                        for (int j = 0; j < N_NEIGHBOURS; ++j) {
+                            shifted[j] = n[j] + offset;
+                        }
+                        neighbourhood.push_back(shifted);
+                    }
+                    load_image(p.pixel_coordinates, frame.lens, frame.image, frame.format);
+                }
+
+                unsigned int dimensions = 0;
+                std::vector<std::pair<std::vector<Scalar>, unsigned int>> outputs;
+                if (head_names.empty()) { dimensions = classify(neighbourhood); }
+                else {
+                    outputs = classify_heads(neighbourhood);
+                }
+
+                // Split the classifications back up into their frames
+                std::vector<ClassifiedMesh<Scalar, N_NEIGHBOURS>> classified;
+                classified.reserve(frames.size());
+                unsigned int offset = 0;
+                for (auto& p : projected) {
+                    if (p.global_indices.empty()) {
+                        classified.emplace_back();
+                        continue;
+                    }
+                    const unsigned int n_points = p.neighbourhood.size();
+                    classified.push_back(ClassifiedMesh<Scalar, N_NEIGHBOURS>{
+                      std::move(p.pixel_coordinates), std::move(p.neighbourhood), std::move(p.global_indices), {}});
+                    if (head_names.empty()) {
+                        assign_outputs(offset, offset + n_points, dimensions, classified.back());
+                    }
+                    else {
+                        assign_heads(head_names, outputs, offset, offset + n_points, classified.back());
+                        assign_labels(output_mode, outputs.front().second, classified.back());
+                    }
+                    offset += n_points;
+                }
+
+                return classified;
+            }
+
+            /**
+             * @brief Classify an image with the floating point network while recording the range of values seen at the
+             * input of each layer. After calibrating over a set of representative images the ranges can be passed to
+             * visualmesh::quantise to build a quantised network.
+             *
+             * @tparam Model the mesh model that we are projecting
+             *
+             * @param mesh    the mesh table that we are projecting to pixel coordinates
+             * @param Hoc     the homogenous transformation matrix from the camera to the observation plane
+             * @param lens    the lens parameters that describe the optics of the camera
+             * @param image   the data that represents the image the network will run from
+             * @param format  the pixel format of this image as a fourcc code
+             */
+            template <template <typename> class Model>
+            void calibrate(const Mesh<Scalar, Model>& mesh,
+                           const mat4<Scalar>& Hoc,
+                           const Lens<Scalar>& lens,
+                           const void* image,
+                           const uint32_t& format) const {
+                if (!quantised.empty() || compiled.classify != nullptr) {
+                    throw std::runtime_error("Only an engine running a floating point network can be calibrated");
+                }
+
+                ProjectedMesh<Scalar, Model<Scalar>::N_NEIGHBOURS> projected = operator()(mesh, Hoc, lens);
+                if (projected.global_indices.empty()) { return; }
+
+                input.clear();
+                load_image(projected.pixel_coordinates, lens, image, format);
+                classify(projected.neighbourhood, 0, true);
+            }
+
+            /**
+             * @brief Calibrate using the mesh from a VisualMesh that is appropriate for the camera height
+             *
+             * @tparam Model the mesh model that we are projecting
+             *
+             * @param mesh    the mesh table that we are projecting to pixel coordinates
+             * @param Hoc     the homogenous transformation matrix from the camera to the observation plane
+             * @param lens    the lens parameters that describe the optics of the camera
+             * @param image   the data that represents the image the network will run from
+             * @param format  the pixel format of this image as a fourcc code
+             */
+            template <template <typename> class Model>
+            void calibrate(const VisualMesh<Scalar, Model>& mesh,
+                           const mat4<Scalar>& Hoc,
+                           const Lens<Scalar>& lens,
+                           const void* image,
+                           const uint32_t& format) const {
+                calibrate(mesh.height(Hoc[2][3]), Hoc, lens, image, format);
+            }
+
+            /**
+             * @return the range of values seen at the input of each layer by calls to calibrate, indexed by the layers
+             *         of the optimised network
+             */
+            const CalibrationRanges<Scalar>& calibration() const {
+                return calibration_ranges;
+            }
 
+            /**
+             * @brief Starts projecting a mesh on another thread for a camera pose that is expected in the future.
+             * The next projection or classification of this mesh uses this result if the actual pose is within the
+             * tolerance of the prediction, otherwise the projection is recomputed.
+             * The mesh must stay alive until the speculation has been used.
+             *
+             * @tparam Model the mesh model that we are projecting
+             *
+             * @param mesh      the mesh table that we are projecting to pixel coordinates
+             * @param Hoc       the predicted homogenous transformation matrix from the camera to the observation plane
+             * @param lens      the lens parameters that describe the optics of the camera
+             * @param tolerance the largest pixel displacement from the predicted pose for which the result is used
+             */
+            template <template <typename> class Model>
+            void speculate(const Mesh<Scalar, Model>& mesh,
+                           const mat4<Scalar>& Hoc,
+                           const Lens<Scalar>& lens,
+                           const Scalar& tolerance) const {
+                projection_cache.template speculate<Model<Scalar>::N_NEIGHBOURS>(
+                  mesh, Hoc, lens, tolerance, &project_mesh<Scalar, Model>);
+            }
+
+            /**
+             * @brief Starts projecting a mesh on another thread for a camera pose that is expected in the future.
+             * This version takes an aggregate VisualMesh object
+             *
+             * @tparam Model the mesh model that we are projecting
+             *
+             * @param mesh      the mesh table that we are projecting to pixel coordinates
+             * @param Hoc       the predicted homogenous transformation matrix from the camera to the observation plane
+             * @param lens      the lens parameters that describe the optics of the camera
+             * @param tolerance the largest pixel displacement from the predicted pose for which the result is used
+             */
+            template <template <typename> class Model>
+            void speculate(const VisualMesh<Scalar, Model>& mesh,
+                           const mat4<Scalar>& Hoc,
+                           const Lens<Scalar>& lens,
+                           const Scalar& tolerance) const {
+                speculate(mesh.height(Hoc[2][3]), Hoc, lens, tolerance);
+            }
+
+            /**
+             * @brief Reuse the previous projection of a mesh while the camera moves less than a number of pixels
+             *
+             * @param tolerance the largest pixel displacement for which a projection is reused, 0 disables reuse
+             */
+            void set_projection_tolerance(const Scalar& tolerance) {
+                projection_cache.set_tolerance(tolerance);
+            }
+
+            /**
+             * @brief Choose how closely exp and tanh are approximated when applying activation functions. The
+             * approximations are only used when Scalar is float.
+             *
+             * @param accuracy the accuracy to use, EXACT uses the standard library
+             */
+            void set_activation_accuracy(const ActivationAccuracy& accuracy) {
+                this->accuracy = accuracy;
+            }
+
+            /**
+             * @brief Choose which layers skip their zero weights. Layers where fewer than this fraction of the weights
+             * are non zero only store and multiply the non zero weights, which is how pruned networks run faster.
+             *
+             * @param density the fraction of non zero weights below which a layer is stored sparsely, 0 disables it
+             */
+            void set_sparse_density(const Scalar& density) {
+                sparse_density = density;
+                make_sparse_layers();
+            }
+
+            /**
+             * @brief Choose what is given back for each point. In the label modes the last layer of the network is
+             * reduced to a label as each point is computed, and a final softmax is skipped unless the confidence is
+             * wanted, so the full output of the network is never stored.
+             *
+             * @param mode the output mode to use, CLASSIFICATIONS gives the full output of the network
+             */
+            void set_output_mode(const OutputMode& mode) {
+                output_mode = mode;
+            }
+
+            /**
+             * @brief Reuse the activations of points whose input has barely changed since the last frame of the same
+             * mesh. Only the points that changed and the points whose receptive field includes them are classified
+             * again, which skips most of the network when the camera and the scene are still.
+             *
+             * @param threshold the largest change in a sampled value (from 0 to 1) for which a point is reused, 0
+             *                  disables reuse
+             */
+            void set_change_threshold(const Scalar& threshold) {
+                activation_cache.set_threshold(threshold);
+            }
+
+            /**
+             * @brief Forget the cached projections and the activations kept from the last frame of each mesh, so the
+             * next frame is projected and classified from scratch. Speculative projections that are still running are
+             * waited for.
+             */
+            void clear_cache() {
+                projection_cache.clear();
+                activation_cache.clear();
+            }
+
+            template <typename, int>
+            friend class RowStream;
+
+        private:
+            /**
+             * @brief Loads the image at each point of a projected mesh and runs the network over them
+             *
+             * @tparam N_NEIGHBOURS the number of neighbours that each point has
+             *
+             * @param projected the projected mesh to classify
+             * @param lens      the lens parameters that describe the optics of the camera
+             * @param image     the data that represents the image the network will run from
+             * @param format    the pixel format of this image as a fourcc code
+             * @param mesh      the mesh that was projected, which identifies the points for reusing activations
+             *
+             * @return a classified mesh for the provided arguments
+             */
+            template <int N_NEIGHBOURS>
+            ClassifiedMesh<Scalar, N_NEIGHBOURS> classify_projected(ProjectedMesh<Scalar, N_NEIGHBOURS>&& projected,
+                                                                    const Lens<Scalar>& lens,
+                                                                    const void* image,
+                                                                    const uint32_t& format,
+                                                                    const void* mesh) const {
                 if (projected.global_indices.empty()) { return ClassifiedMesh<Scalar, N_NEIGHBOURS>(); }
 
+                // Load the image at each of the projected points and run the network over them
+                input.clear();
+                load_image(projected.pixel_coordinates, lens, image, format);
+                if (head_names.empty()) {
+                    const unsigned int dimensions =
+                      classify_changes(projected.neighbourhood, projected.global_indices, mesh);
+                    if (output_mode == OutputMode::CLASSIFICATIONS) {
+                        return ClassifiedMesh<Scalar, N_NEIGHBOURS>{std::move(projected.pixel_coordinates),
+                                                                    std::move(projected.neighbourhood),
+                                                                    std::move(projected.global_indices),
+                                                                    std::move(input)};
+                    }
+                    ClassifiedMesh<Scalar, N_NEIGHBOURS> classified{std::move(projected.pixel_coordinates),
+                                                                    std::move(projected.neighbourhood),
+                                                                    std::move(projected.global_indices),
+                                                                    {}};
+                    assign_outputs(0, classified.neighbourhood.size(), dimensions, classified);
+                    return classified;
+                }
+
+                const auto outputs = classify_heads(projected.neighbourhood);
+                ClassifiedMesh<Scalar, N_NEIGHBOURS> classified{std::move(projected.pixel_coordinates),
+                                                                std::move(projected.neighbourhood),
+                                                                std::move(projected.global_indices),
+                                                                {}};
+                assign_heads(head_names, outputs, 0, classified.neighbourhood.size(), classified);
+                assign_labels(output_mode, outputs.front().second, classified);
+                return classified;
+            }
+
+            /**
+             * @brief The number of rings of neighbours the loaded network reads from to classify a single point
+             *
+             * @return the number of graph convolutions between the input and the deepest output
+             */
+            int receptive_field() const {
+                if (!quantised.empty()) { return int(quantised.size()); }
+                if (compiled.classify != nullptr) { return compiled.n_groups; }
+
+                // Independent networks each read their own neighbourhood, so the deepest of them is the furthest read
+                if (head_names.empty()) {
+                    int depth = 0;
+                    for (const auto& network : networks) { depth = std::max(depth, int(network.size())); }
+                    return depth;
+                }
+
+                // The heads of a branching network all continue from the output of the trunk
+                int heads = 0;
+                for (std::size_t i = 1; i < networks.size(); ++i) { heads = std::max(heads, int(networks[i].size())); }
+                return int(networks.front().size()) + heads;
+            }
+
+            /**
+             * @brief Samples the image at each of the pixel coordinates and appends them to the input buffer, followed
+             * by the values for the offscreen point
+             *
+             * @param pixels  the pixel coordinates to sample the image at
+             * @param lens    the lens parameters that describe the optics of the camera
+             * @param image   the data that represents the image the network will run from
+             * @param format  the pixel format of this image as a fourcc code
+             */
+            void load_image(const std::vector<std::array<Scalar, 2>>& pixels,
+                            const Lens<Scalar>& lens,
+                            const void* image,
+                            const uint32_t& format) const {
                 // Based on the fourcc code, load the data from the image into input
-                input.reserve(n_points * 4);
-                const int R     = ('R' == (format & 0xFF) ? 0 : 2);
-                const int B     = ('R' == (format & 0xFF) ? 2 : 0);
-                const int depth = ('A' == ((format >> 24) & 0xFF) ? 4 : 3);
+                input.reserve(input.size() + (pixels.size() + 1) * 4);
+                const uint8_t* const im = reinterpret_cast<const uint8_t*>(image);
+                const vec2<int>& d      = lens.dimensions;
                 switch (format) {
                     case fourcc("RGB8"):
-                    case fourcc("RGB3"):
+                    case fourcc("RGB3"): load_rgb(pixels, im, d, 3, 0, 2); break;
                     case fourcc("BGR8"):
-                    case fourcc("BGR3"):
-                    case fourcc("RGBA"):
-                    case fourcc("BGRA"): break;
+                    case fourcc("BGR3"): load_rgb(pixels, im, d, 3, 2, 0); break;
+                    case fourcc("RGBA"): load_rgb(pixels, im, d, 4, 0, 2); break;
+                    case fourcc("BGRA"): load_rgb(pixels, im, d, 4, 2, 0); break;
+                    case fourcc("GREY"): load_interpolated(pixels, Grey<Scalar>{im, d}, d); break;
+                    case fourcc("YUYV"): load_interpolated(pixels, PackedYUV<Scalar>{im, d, 0, 1, 3}, d); break;
+                    case fourcc("UYVY"): load_interpolated(pixels, PackedYUV<Scalar>{im, d, 1, 0, 2}, d); break;
+                    case fourcc("NV12"): load_interpolated(pixels, NV12<Scalar>{im, d}, d); break;
+                    // Bayer formats are demosaiced at the nearest pixel to each point like the OpenCL engine
+                    case fourcc("GRBG"): load_bayer(pixels, im, d, vec2<Scalar>{1, 0}); break;
+                    case fourcc("RGGB"): load_bayer(pixels, im, d, vec2<Scalar>{0, 0}); break;
+                    case fourcc("GBRG"): load_bayer(pixels, im, d, vec2<Scalar>{0, 1}); break;
+                    case fourcc("BGGR"): load_bayer(pixels, im, d, vec2<Scalar>{1, 1}); break;
                     default:
                         throw std::runtime_error("The CPU classifier is unable to decode the format "
                                                  + fourcc_text(format));
                 }
 
-                for (const auto& px : projected.pixel_coordinates) {
-                    const uint8_t* const im = reinterpret_cast<const uint8_t*>(image);
+                // Four -1 values for the offscreen point
+                input.insert(input.end(), {Scalar(-1.0), Scalar(-1.0), Scalar(-1.0), Scalar(-1.0)});
+            }
 
-                    const vec4<Scalar> p = interpolate(px, im, lens.dimensions, depth);
+            /**
+             * @brief Appends the bilinearly sampled value of an 8 bit RGB image at each pixel coordinate to the input
+             * buffer using the fixed point sampler
+             *
+             * @param pixels     the pixel coordinates to sample the image at
+             * @param image      the image to sample from
+             * @param dimensions the dimensions of the image
+             * @param depth      the number of bytes in each pixel, 3 for RGB or 4 for RGBA
+             * @param R          the byte offset of the red channel in each pixel
+             * @param B          the byte offset of the blue channel in each pixel
+             */
+            void load_rgb(const std::vector<std::array<Scalar, 2>>& pixels,
+                          const uint8_t* const image,
+                          const vec2<int>& dimensions,
+                          const int& depth,
+                          const int& R,
+                          const int& B) const {
+                const std::size_t start = input.size();
+                input.resize(start + pixels.size() * 4);
+                sample_rgb(pixels, image, dimensions, depth, R, B, input.data() + start);
+            }
 
-                    input.emplace_back(p[R]);
-                    input.emplace_back(p[1]);
-                    input.emplace_back(p[B]);
-                    input.emplace_back(p[3]);
+            /**
+             * @brief Appends the interpolated value of the image at each pixel coordinate to the input buffer
+             *
+             * @tparam Reader the type that reads a single pixel of this image format in RGBA order
+             *
+             * @param pixels     the pixel coordinates to sample the image at
+             * @param read       reads the pixel at an integer coordinate
+             * @param dimensions the dimensions of the image
+             */
+            template <typename Reader>
+            void load_interpolated(const std::vector<std::array<Scalar, 2>>& pixels,
+                                   const Reader& read,
+                                   const vec2<int>& dimensions) const {
+                for (const auto& px : pixels) {
+                    const vec4<Scalar> p = interpolate(px, read, dimensions);
+                    input.insert(input.end(), p.begin(), p.end());
                 }
+            }
 
-                // Four -1 values for the offscreen point
-                input.insert(input.end(), {Scalar(-1.0), Scalar(-1.0), Scalar(-1.0), Scalar(-1.0)});
+            /**
+             * @brief Appends the demosaiced value of a bayer image at each pixel coordinate to the input buffer
+             *
+             * @param pixels     the pixel coordinates to sample the image at
+             * @param image      the raw bayer image
+             * @param dimensions the dimensions of the image
+             * @param first_red  the coordinate for the first red pixel in the bayer pattern
+             */
+            void load_bayer(const std::vector<std::array<Scalar, 2>>& pixels,
+                            const uint8_t* const image,
+                            const vec2<int>& dimensions,
+                            const vec2<Scalar>& first_red) const {
+                for (const auto& px : pixels) {
+                    const vec4<Scalar> p = bayer_to_rgb(px, image, dimensions, first_red);
+                    input.insert(input.end(), p.begin(), p.end());
+                }
+            }
 
-                // We start out with 4d input (RGBAesque)
-                unsigned int input_dimensions  = 4;
+            /**
+             * @brief Runs the network over the points in the input buffer, leaving the result in the input buffer
+             *
+             * @tparam N_NEIGHBOURS the number of neighbours that each point has
+             *
+             * @param neighbourhood the graph of the points in the input buffer, including any offscreen points
+             * @param network       which of the networks loaded into this engine to run
+             * @param calibrate     if true record the range of the values at the input of each layer
+             *
+             * @return the number of values for each point in the output
+             */
+            template <std::size_t N_NEIGHBOURS>
+            unsigned int classify(const std::vector<std::array<int, N_NEIGHBOURS>>& neighbourhood,
+                                  const unsigned int& network = 0,
+                                  const bool& calibrate       = false) const {
+                // Branching networks label the output of their first head once every head has run
+                const bool labelling = output_mode != OutputMode::CLASSIFICATIONS && head_names.empty() && !calibrate;
+
+                // These run the whole network and then label its output
+                unsigned int dimensions = 0;
+                if (!quantised.empty()) { dimensions = classify_quantised(neighbourhood); }
+                else if (compiled.classify != nullptr) {
+                    if (compiled.n_neighbours != int(N_NEIGHBOURS)) {
+                        throw std::runtime_error("The compiled network was made for a mesh with "
+                                                 + std::to_string(compiled.n_neighbours) + " neighbours not "
+                                                 + std::to_string(N_NEIGHBOURS));
+                    }
+                    dimensions = compiled.classify(reinterpret_cast<const int*>(neighbourhood.data()),
+                                                   neighbourhood.size(),
+                                                   input,
+                                                   output,
+                                                   accuracy);
+                }
+                else if (storage != ActivationStorage::FULL && !calibrate) {
+                    dimensions = classify_packed(neighbourhood, network);
+                }
+                if (dimensions != 0) {
+                    if (labelling) { label_outputs(output_mode, input, dimensions, labels, confidence); }
+                    return dimensions;
+                }
+
+                const unsigned int n_points = neighbourhood.size();
+                const auto& structure       = networks[network];
+
+                // We start out with 4d input (RGBAesque), or the trunk output for the heads of a branching network
+                unsigned int input_dimensions  = input.size() / n_points;
                 unsigned int output_dimensions = 0;
 
                 // For each convolutional layer
                 for (unsigned int conv_no = 0; conv_no < structure.size(); ++conv_no) {
                     const auto& conv = structure[conv_no];
 
-                    // Ensure enough space for the convolutional gather
-                    output.resize(0);
-                    output.reserve(input.size() * (N_NEIGHBOURS + 1));
-                    output_dimensions = input_dimensions * (N_NEIGHBOURS + 1);
+                    // Depthwise separable groups sum each channel over the neighbours rather than gathering them all
+                    const bool fuse_gather = conv.front().depthwise.empty();
+                    if (!fuse_gather) {
+                        depthwise_gather(neighbourhood, conv.front().depthwise, input, input_dimensions, output);
+                        std::swap(input, output);
+                    }
+
+                    // Other groups gather each point's neighbourhood just before their first layer multiplies it, so
+                    // the gathered values for the whole mesh are never written out
+                    const unsigned int point_dimensions = input_dimensions;
+                    if (fuse_gather) { input_dimensions *= N_NEIGHBOURS + 1; }
+
+                    // For each network layer
+                    for (unsigned int layer_no = 0; layer_no < conv.size(); ++layer_no) {
+                        const auto& biases = conv[layer_no].biases;
+
+                        // Every point is in its own neighbourhood so the gathered values are the input values
+                        if (calibrate) {
+                            auto& range = calibration_ranges[conv_no][layer_no];
+                            for (const auto& v : input) {
+                                range.first  = std::min(range.first, v);
+                                range.second = std::max(range.second, v);
+                            }
+                        }
+
+                        // Setup the shapes
+                        output_dimensions          = biases.size();
+                        const auto& sparse_weights = sparse[network][conv_no][layer_no];
+                        const bool gather          = fuse_gather && layer_no == 0;
+                        gathered.resize(gather ? input_dimensions : 0);
+
+                        // The last layer can be reduced to labels as each point is computed
+                        if (labelling && conv_no + 1 == structure.size() && layer_no + 1 == conv.size()) {
+                            label_layer(neighbourhood,
+                                        conv[layer_no],
+                                        sparse_weights,
+                                        gather ? point_dimensions : 0,
+                                        input_dimensions);
+                            return output_dimensions;
+                        }
+
+                        // Apply the weights and bias, then the activation function while the point is still in cache
+                        output.resize(n_points * output_dimensions);
+                        Scalar* out_point = output.data();
+                        for (unsigned int i = 0; i < n_points; ++i) {
+                            const Scalar* in_point = input.data() + i * input_dimensions;
+                            if (gather) {
+                                in_point = gather_point(neighbourhood[i], i, input, point_dimensions);
+                            }
+                            apply_layer(conv[layer_no], sparse_weights, in_point, input_dimensions, out_point);
+                            out_point += output_dimensions;
+                        }
+
+                        // Swap our values over
+                        std::swap(input, output);
+                        input_dimensions = output_dimensions;
+                    }
+                }
+
+                // A network without any layers gives back its input
+                if (labelling) { label_outputs(output_mode, input, input_dimensions, labels, confidence); }
+                return input_dimensions;
+            }
+
+            /**
+             * @brief Runs the first network over the points in the input buffer, reusing the activations from the last
+             * frame for the points whose receptive field has not changed. Networks that are quantised, compiled or
+             * stored at reduced precision are always run over every point.
+             *
+             * @tparam N_NEIGHBOURS the number of neighbours that each point has
+             *
+             * @param neighbourhood  the graph of the points in the input buffer, including the offscreen point
+             * @param global_indices the index of each point in the mesh, not including the offscreen point
+             * @param mesh           the mesh that the points come from
+             *
+             * @return the number of values for each point in the output
+             */
+            template <std::size_t N_NEIGHBOURS>
+            unsigned int classify_changes(const std::vector<std::array<int, N_NEIGHBOURS>>& neighbourhood,
+                                          const std::vector<int>& global_indices,
+                                          const void* mesh) const {
+                if (!activation_cache.enabled() || mesh == nullptr || !quantised.empty()
+                    || compiled.classify != nullptr || storage != ActivationStorage::FULL) {
+                    return classify(neighbourhood);
+                }
 
-                    // Gather over each of the neighbours
-                    for (unsigned int i = 0; i < neighbourhood.size(); ++i) {
-                        output.insert(output.end(),
-                                      std::next(input.begin(), i * input_dimensions),
-                                      std::next(input.begin(), (i + 1) * input_dimensions));
+                const unsigned int n_points  = neighbourhood.size();
+                const unsigned int offscreen = n_points - 1;
+                const auto& structure        = networks.front();
+                auto& cache                  = activation_cache;
+
+                // Count the neighbours of each point that are on screen, a change in these changes its output
+                std::vector<uint8_t> onscreen(n_points, 0);
+                for (unsigned int i = 0; i < n_points; ++i) {
+                    for (const auto& n : neighbourhood[i]) {
+                        onscreen[i] += n != int(offscreen);
+                    }
+                }
+
+                // A point's input has changed if it is new or any of its samples moved by more than the threshold,
+                // otherwise it keeps the samples its cached activations were made from. The offscreen point is the
+                // same in every frame so it only changes when there is no previous frame.
+                std::vector<int> rows = cache.rows(mesh, global_indices);
+                rows.push_back(cache.mesh == mesh && !cache.global_indices.empty() ? int(cache.global_indices.size())
+                                                                                   : -1);
+                std::vector<char> changed(n_points, 1);
+                changed[offscreen] = rows[offscreen] < 0;
+                const auto& previous = cache.activations;
+                for (unsigned int i = 0; i < offscreen; ++i) {
+                    const int r = rows[i];
+                    if (r < 0 || cache.onscreen[r] != onscreen[i]) { continue; }
+
+                    Scalar* sample       = input.data() + i * 4;
+                    const Scalar* before = previous.front().data() + r * 4;
+                    changed[i]           = false;
+                    for (unsigned int j = 0; j < 4; ++j) {
+                        changed[i] = changed[i] || std::abs(sample[j] - before[j]) > cache.threshold;
+                    }
+                    if (!changed[i]) { std::copy(before, before + 4, sample); }
+                }
+
+                std::vector<std::vector<Scalar>> activations(structure.size() + 1);
+                activations.front() = input;
+                std::vector<char> spread(n_points);
+                unsigned int input_dimensions = 4;
+                for (unsigned int conv_no = 0; conv_no < structure.size(); ++conv_no) {
+                    // Every group reads the neighbours of a point so changes spread one ring further for each group
+                    for (unsigned int i = 0; i < n_points; ++i) {
+                        spread[i] = changed[i];
                         for (const auto& n : neighbourhood[i]) {
-                            output.insert(output.end(),
-                                          std::next(input.begin(), n * input_dimensions),
-                                          std::next(input.begin(), (n + 1) * input_dimensions));
+                            spread[i] = spread[i] || changed[n];
                         }
                     }
+                    std::swap(changed, spread);
 
-                    // Output becomes input
-                    std::swap(input, output);
+                    const unsigned int output_dimensions = structure[conv_no].back().biases.size();
+                    const auto& in                       = activations[conv_no];
+                    auto& out                            = activations[conv_no + 1];
+                    out.resize(n_points * output_dimensions);
+                    for (unsigned int i = 0; i < n_points; ++i) {
+                        Scalar* out_point = out.data() + i * output_dimensions;
+                        if (changed[i]) {
+                            classify_point(conv_no, neighbourhood[i], i, in, input_dimensions, out_point);
+                        }
+                        else {
+                            const Scalar* cached = previous[conv_no + 1].data() + rows[i] * output_dimensions;
+                            std::copy(cached, cached + output_dimensions, out_point);
+                        }
+                    }
                     input_dimensions = output_dimensions;
+                }
+
+                // Remember this frame for the next one
+                input                = activations.back();
+                cache.mesh           = mesh;
+                cache.global_indices = global_indices;
+                cache.onscreen       = std::move(onscreen);
+                cache.activations    = std::move(activations);
+
+                if (output_mode != OutputMode::CLASSIFICATIONS) {
+                    label_outputs(output_mode, input, input_dimensions, labels, confidence);
+                }
+                return input_dimensions;
+            }
+
+            /**
+             * @brief Applies the last layer of a network to each point and keeps only its label, and its confidence if
+             * that is wanted. A final softmax only changes the confidence and not the label, so it is skipped unless
+             * the confidence is needed.
+             *
+             * @tparam N_NEIGHBOURS the number of neighbours that each point has
+             *
+             * @param neighbourhood    the graph of the points in the input buffer, including any offscreen points
+             * @param layer            the last layer of the network
+             * @param sparse_weights   the compressed weights of the layer, or empty if it is dense
+             * @param point_dimensions the number of values for each point in the input buffer when the layer gathers
+             *                         each point's neighbourhood as the first layer of its group, otherwise 0
+             * @param input_dimensions the number of input values to the layer for each point
+             */
+            template <std::size_t N_NEIGHBOURS>
+            void label_layer(const std::vector<std::array<int, N_NEIGHBOURS>>& neighbourhood,
+                             const Layer<Scalar>& layer,
+                             const SparseWeights<Scalar>& sparse_weights,
+                             const unsigned int& point_dimensions,
+                             const unsigned int& input_dimensions) const {
+                const unsigned int n_points          = neighbourhood.size();
+                const bool gather                    = point_dimensions != 0;
+                const unsigned int output_dimensions = layer.biases.size();
+                const bool logits                    = layer.activation == ActivationFunction::SOFTMAX;
+
+                labels.resize(n_points);
+                confidence.resize(output_mode == OutputMode::LABELS_AND_CONFIDENCE ? n_points : 0);
+                auto& values = point_values.front();
+                values.resize(output_dimensions);
+                for (unsigned int i = 0; i < n_points; ++i) {
+                    const Scalar* in_point = gather ? gather_point(neighbourhood[i], i, input, point_dimensions)
+                                                    : input.data() + i * input_dimensions;
+                    apply_layer(layer, sparse_weights, in_point, input_dimensions, values.data(), !logits);
+                    label_point(values.data(),
+                                output_dimensions,
+                                logits,
+                                labels[i],
+                                confidence.empty() ? nullptr : &confidence[i]);
+                }
+            }
+
+            /**
+             * @brief Copies the output for a range of points into a classified mesh, either the full output of the
+             * network from the input buffer or the labels when only those are being output
+             *
+             * @tparam N_NEIGHBOURS the number of neighbours that each point has
+             *
+             * @param first      the first point to copy
+             * @param last       one past the last point to copy
+             * @param dimensions the number of values for each point in the input buffer
+             * @param classified the classified mesh to fill in
+             */
+            template <int N_NEIGHBOURS>
+            void assign_outputs(const unsigned int& first,
+                                const unsigned int& last,
+                                const unsigned int& dimensions,
+                                ClassifiedMesh<Scalar, N_NEIGHBOURS>& classified) const {
+                if (output_mode == OutputMode::CLASSIFICATIONS) {
+                    classified.classifications.assign(std::next(input.cbegin(), first * dimensions),
+                                                      std::next(input.cbegin(), last * dimensions));
+                    return;
+                }
+                classified.labels.assign(std::next(labels.cbegin(), first), std::next(labels.cbegin(), last));
+                if (!confidence.empty()) {
+                    classified.confidence.assign(std::next(confidence.cbegin(), first),
+                                                 std::next(confidence.cbegin(), last));
+                }
+            }
+
+            /**
+             * @brief Copies a point and each of its neighbours from the input values into the gathered buffer
+             *
+             * @tparam N_NEIGHBOURS the number of neighbours that each point has
+             *
+             * @param neighbours the neighbours of the point
+             * @param point      the index of the point
+             * @param values     the values of every point
+             * @param dimensions the number of values for each point
+             *
+             * @return the start of the gathered buffer, holding dimensions * (N_NEIGHBOURS + 1) values
+             */
+            template <std::size_t N_NEIGHBOURS>
+            const Scalar* gather_point(const std::array<int, N_NEIGHBOURS>& neighbours,
+                                       const unsigned int& point,
+                                       const std::vector<Scalar>& values,
+                                       const unsigned int& dimensions) const {
+                const Scalar* in = values.data();
+                Scalar* out      = std::copy(in + point * dimensions, in + (point + 1) * dimensions, gathered.data());
+                for (const auto& n : neighbours) {
+                    out = std::copy(in + n * dimensions, in + (n + 1) * dimensions, out);
+                }
+                return gathered.data();
+            }
+
+            /**
+             * @brief Applies the weights, bias and activation function of a layer to a single point
+             *
+             * @param layer          the layer to apply
+             * @param sparse_weights the compressed weights of the layer, or empty if it is dense
+             * @param in_point       the input values of the point
+             * @param dimensions     the number of input values
+             * @param out_point      where to write the output values of the point
+             * @param activate       if the activation function should be applied
+             */
+            void apply_layer(const Layer<Scalar>& layer,
+                             const SparseWeights<Scalar>& sparse_weights,
+                             const Scalar* in_point,
+                             const unsigned int& dimensions,
+                             Scalar* out_point,
+                             const bool& activate = true) const {
+                if (!sparse_weights.offsets.empty()) {
+                    sparse_multiply(sparse_weights, layer.biases, in_point, out_point);
+                }
+                else {
+                    for (unsigned int j = 0; j < layer.biases.size(); ++j) {
+                        out_point[j] = std::inner_product(
+                          in_point, in_point + dimensions, layer.weights[j].begin(), layer.biases[j]);
+                    }
+                }
+                if (activate) { apply_activation(layer.activation, out_point, layer.biases.size(), accuracy); }
+            }
+
+            /**
+             * @brief Runs one group of the first network for a single point, reading the group's input for the point
+             * and its neighbours. This lets points be classified as soon as their inputs are ready.
+             *
+             * @tparam N_NEIGHBOURS the number of neighbours that each point has
+             *
+             * @param conv_no    the group of the network to run
+             * @param neighbours the neighbours of the point
+             * @param point      the index of the point
+             * @param in         the input values of every point for this group
+             * @param dimensions the number of input values for each point
+             * @param out_point  where to write the output values of the point
+             */
+            template <std::size_t N_NEIGHBOURS>
+            void classify_point(const unsigned int& conv_no,
+                                const std::array<int, N_NEIGHBOURS>& neighbours,
+                                const unsigned int& point,
+                                const std::vector<Scalar>& in,
+                                const unsigned int& dimensions,
+                                Scalar* out_point) const {
+                const auto& conv = networks.front()[conv_no];
+
+                const Scalar* in_point        = nullptr;
+                unsigned int input_dimensions = dimensions;
+                if (!conv.front().depthwise.empty()) {
+                    gathered.resize(dimensions);
+                    depthwise_point(neighbours, point, conv.front().depthwise, in, dimensions, gathered.data());
+                    in_point = gathered.data();
+                }
+                else {
+                    input_dimensions = dimensions * (N_NEIGHBOURS + 1);
+                    gathered.resize(input_dimensions);
+                    in_point = gather_point(neighbours, point, in, dimensions);
+                }
+
+                // Ping pong the point between the layers and write the last one straight to the output
+                for (unsigned int layer_no = 0; layer_no < conv.size(); ++layer_no) {
+                    auto& values = point_values[layer_no % 2];
+                    values.resize(conv[layer_no].biases.size());
+                    Scalar* out = layer_no + 1 == conv.size() ? out_point : values.data();
+
+                    apply_layer(conv[layer_no], sparse.front()[conv_no][layer_no], in_point, input_dimensions, out);
+                    in_point         = out;
+                    input_dimensions = conv[layer_no].biases.size();
+                }
+            }
+
+            /**
+             * @brief Runs the trunk of a branching network once over the points in the input buffer and then each of
+             * its heads from a copy of the trunk's output
+             *
+             * @tparam N_NEIGHBOURS the number of neighbours that each point has
+             *
+             * @param neighbourhood the graph of the points in the input buffer, including any offscreen points
+             *
+             * @return the output of each head in order, along with the number of values for each point in it
+             */
+            template <std::size_t N_NEIGHBOURS>
+            std::vector<std::pair<std::vector<Scalar>, unsigned int>> classify_heads(
+              const std::vector<std::array<int, N_NEIGHBOURS>>& neighbourhood) const {
+                classify(neighbourhood, 0);
+                const std::vector<Scalar> trunk = input;
+
+                std::vector<std::pair<std::vector<Scalar>, unsigned int>> outputs;
+                for (unsigned int head = 0; head < head_names.size(); ++head) {
+                    input                         = trunk;
+                    const unsigned int dimensions = classify(neighbourhood, head + 1);
+                    outputs.emplace_back(input, dimensions);
+                }
+                return outputs;
+            }
+
+            /**
+             * @brief Compresses the layers with few enough non zero weights and clears the rest
+             */
+            void make_sparse_layers() {
+                sparse.clear();
+                for (const auto& structure : networks) {
+                    sparse.emplace_back();
+                    for (const auto& conv : structure) {
+                        sparse.back().emplace_back(conv.size());
+                        for (unsigned int layer_no = 0; layer_no < conv.size(); ++layer_no) {
+                            if (weight_density(conv[layer_no].weights) < sparse_density) {
+                                sparse.back().back()[layer_no] = make_sparse(conv[layer_no].weights);
+                            }
+                        }
+                    }
+                }
+            }
+
+            /**
+             * @brief Sums each channel over the neighbourhood of every point using the depthwise weights of a depthwise
+             * separable layer. This replaces the gather so the neighbourhood is never copied out in full.
+             *
+             * @tparam N_NEIGHBOURS the number of neighbours that each point has
+             *
+             * @param neighbourhood the graph of the points in the input buffer, including any offscreen points
+             * @param depthwise     the weights for each channel of the point and each of its neighbours
+             * @param in            the values of every point
+             * @param dimensions    the number of values for each point
+             * @param out           filled with the summed channels of every point
+             */
+            template <std::size_t N_NEIGHBOURS>
+            void depthwise_gather(const std::vector<std::array<int, N_NEIGHBOURS>>& neighbourhood,
+                                  const Weights<Scalar>& depthwise,
+                                  const std::vector<Scalar>& in,
+                                  const unsigned int& dimensions,
+                                  std::vector<Scalar>& out) const {
+                if (depthwise.size() != N_NEIGHBOURS + 1) {
+                    throw std::runtime_error("The depthwise separable layer was made for a mesh with "
+                                             + std::to_string(depthwise.size() - 1) + " neighbours not "
+                                             + std::to_string(N_NEIGHBOURS));
+                }
+
+                out.resize(neighbourhood.size() * dimensions);
+                for (unsigned int i = 0; i < neighbourhood.size(); ++i) {
+                    depthwise_point(neighbourhood[i], i, depthwise, in, dimensions, out.data() + i * dimensions);
+                }
+            }
+
+            /**
+             * @brief Sums each channel over the neighbourhood of a single point using the depthwise weights
+             *
+             * @tparam N_NEIGHBOURS the number of neighbours that each point has
+             *
+             * @param neighbours the neighbours of the point
+             * @param point      the index of the point
+             * @param depthwise  the weights for each channel of the point and each of its neighbours
+             * @param in         the values of every point
+             * @param dimensions the number of values for each point
+             * @param out_point  where to write the summed channels of the point
+             */
+            template <std::size_t N_NEIGHBOURS>
+            void depthwise_point(const std::array<int, N_NEIGHBOURS>& neighbours,
+                                 const unsigned int& point,
+                                 const Weights<Scalar>& depthwise,
+                                 const std::vector<Scalar>& in,
+                                 const unsigned int& dimensions,
+                                 Scalar* out_point) const {
+                const Scalar* in_point = in.data() + point * dimensions;
+                for (unsigned int k = 0; k < dimensions; ++k) {
+                    out_point[k] = in_point[k] * depthwise[0][k];
+                }
+                for (unsigned int n = 0; n < N_NEIGHBOURS; ++n) {
+                    in_point      = in.data() + neighbours[n] * dimensions;
+                    const auto& w = depthwise[n + 1];
+                    for (unsigned int k = 0; k < dimensions; ++k) {
+                        out_point[k] += in_point[k] * w[k];
+                    }
+                }
+            }
+
+            /**
+             * @brief Runs the network over the points in the input buffer keeping the activations between layers in 16
+             * bit storage, leaving the result in the input buffer. Each point is unpacked to Scalar precision just
+             * before it is multiplied so only one point's worth of values is ever held at full width.
+             *
+             * @tparam N_NEIGHBOURS the number of neighbours that each point has
+             *
+             * @param neighbourhood the graph of the points in the input buffer, including any offscreen points
+             * @param network       which of the networks loaded into this engine to run
+             *
+             * @return the number of values for each point in the output
+             */
+            template <std::size_t N_NEIGHBOURS>
+            unsigned int classify_packed(const std::vector<std::array<int, N_NEIGHBOURS>>& neighbourhood,
+                                         const unsigned int& network) const {
+                const unsigned int n_points = neighbourhood.size();
+                const auto& structure       = networks[network];
+
+                // We start out with 4d input (RGBAesque), or the trunk output for the heads of a branching network
+                unsigned int input_dimensions  = input.size() / n_points;
+                unsigned int output_dimensions = 0;
+
+                packed_input.resize(input.size());
+                encode(storage, input.data(), packed_input.data(), input.size());
+
+                for (unsigned int conv_no = 0; conv_no < structure.size(); ++conv_no) {
+                    const auto& conv = structure[conv_no];
+
+                    // Depthwise separable groups sum each channel over the neighbours at full precision and repack
+                    if (!conv.front().depthwise.empty()) {
+                        output.resize(packed_input.size());
+                        decode(storage, packed_input.data(), output.data(), output.size());
+                        depthwise_gather(neighbourhood, conv.front().depthwise, output, input_dimensions, input);
+                        packed_input.resize(input.size());
+                        encode(storage, input.data(), packed_input.data(), input.size());
+                    }
+                    else {
+                        // Gather over each of the neighbours
+                        packed_output.resize(0);
+                        packed_output.reserve(packed_input.size() * (N_NEIGHBOURS + 1));
+                        for (unsigned int i = 0; i < n_points; ++i) {
+                            packed_output.insert(packed_output.end(),
+                                                 std::next(packed_input.begin(), i * input_dimensions),
+                                                 std::next(packed_input.begin(), (i + 1) * input_dimensions));
+                            for (const auto& n : neighbourhood[i]) {
+                                packed_output.insert(packed_output.end(),
+                                                     std::next(packed_input.begin(), n * input_dimensions),
+                                                     std::next(packed_input.begin(), (n + 1) * input_dimensions));
+                            }
+                        }
+                        std::swap(packed_input, packed_output);
+                        input_dimensions *= N_NEIGHBOURS + 1;
+                    }
 
-                    // For each network layer
                     for (unsigned int layer_no = 0; layer_no < conv.size(); ++layer_no) {
                         const auto& weights    = conv[layer_no].weights;
                         const auto& biases     = conv[layer_no].biases;
                         const auto& activation = conv[layer_no].activation;
 
-                        // Setup the shapes
-                        output_dimensions = biases.size();
-                        output.resize(0);
-                        output.reserve(n_points * output_dimensions);
-
-                        // Apply the weights and bias
-                        auto in_point = input.begin();
+                        // Apply the weights and bias, then the activation function while the point is still in cache
+                        const auto& sparse_weights = sparse[network][conv_no][layer_no];
+                        output_dimensions          = biases.size();
+                        output.resize(n_points * output_dimensions);
+                        unpacked.resize(input_dimensions);
                         for (unsigned int i = 0; i < n_points; ++i) {
-                            for (unsigned int j = 0; j < output_dimensions; ++j) {
-                                output.emplace_back(std::inner_product(
-                                  in_point, in_point + input_dimensions, weights[j].begin(), biases[j]));
+                            const uint16_t* in_point = packed_input.data() + i * input_dimensions;
+                            decode(storage, in_point, unpacked.data(), input_dimensions);
+                            Scalar* out_point = output.data() + i * output_dimensions;
+                            if (!sparse_weights.offsets.empty()) {
+                                sparse_multiply(sparse_weights, biases, unpacked.data(), out_point);
                             }
-                            in_point += input_dimensions;
+                            else {
+                                for (unsigned int j = 0; j < output_dimensions; ++j) {
+                                    out_point[j] = std::inner_product(
+                                      unpacked.begin(), unpacked.end(), weights[j].begin(), biases[j]);
+                                }
+                            }
+                            apply_activation(activation, out_point, output_dimensions, accuracy);
                         }
-
-                        // Apply the activation function
-                        apply_activation(activation, output, output_dimensions);
-
-                        // Swap our values over
-                        std::swap(input, output);
                         input_dimensions = output_dimensions;
+
+                        // The final layer is returned at full precision, everything else is packed for the next layer
+                        if (conv_no + 1 == structure.size() && layer_no + 1 == conv.size()) {
+                            std::swap(input, output);
+                        }
+                        else {
+                            packed_input.resize(output.size());
+                            encode(storage, output.data(), packed_input.data(), output.size());
+                        }
                     }
                 }
 
-                return ClassifiedMesh<Scalar, N_NEIGHBOURS>{std::move(projected.pixel_coordinates),
-                                                            std::move(projected.neighbourhood),
-                                                            std::move(projected.global_indices),
-                                                            std::move(input)};
+                return input_dimensions;
             }
 
             /**
-             * @brief Project and classify a mesh using the neural network that is loaded into this engine.
-             * This version takes an aggregate VisualMesh object
+             * @brief Runs the quantised network over the points in the input buffer, leaving the result in the input
+             * buffer. Each layer quantises its input to 8 bits, accumulates in 32 bits and then applies its activation
+             * function in floating point.
              *
-             * @tparam Model the mesh model that we are projecting
+             * @tparam N_NEIGHBOURS the number of neighbours that each point has
              *
-             * @param mesh    the mesh table that we are projecting to pixel coordinates
-             * @param Hoc     the homogenous transformation matrix from the camera to the observation plane
-             * @param lens    the lens parameters that describe the optics of the camera
-             * @param image   the data that represents the image the network will run from
-             * @param format  the pixel format of this image as a fourcc code
+             * @param neighbourhood the graph of the points in the input buffer, including any offscreen points
              *
-             * @return a classified mesh for the provided arguments
+             * @return the number of values for each point in the output
              */
-            template <template <typename> class Model>
-            ClassifiedMesh<Scalar, Model<Scalar>::N_NEIGHBOURS> operator()(const VisualMesh<Scalar, Model>& mesh,
-                                                                           const mat4<Scalar>& Hoc,
-                                                                           const Lens<Scalar>& lens,
-                                                                           const void* image,
-                                                                           const uint32_t& format) const {
-                return operator()(mesh.height(Hoc[2][3]), Hoc, lens, image, format);
+            template <std::size_t N_NEIGHBOURS>
+            unsigned int classify_quantised(const std::vector<std::array<int, N_NEIGHBOURS>>& neighbourhood) const {
+                const unsigned int n_points = neighbourhood.size();
+
+                // We start out with 4d input (RGBAesque)
+                unsigned int input_dimensions  = 4;
+                unsigned int output_dimensions = 0;
+
+                for (const auto& conv : quantised) {
+                    for (unsigned int layer_no = 0; layer_no < conv.size(); ++layer_no) {
+                        const auto& layer = conv[layer_no];
+
+                        // Quantise the input using this layer's parameters
+                        const Scalar inverse_scale = Scalar(1) / layer.input.scale;
+                        q_input.resize(input.size());
+                        for (unsigned int i = 0; i < input.size(); ++i) {
+                            const Scalar q = std::round(input[i] * inverse_scale) + layer.input.zero_point;
+                            q_input[i]     = uint8_t(std::min(Scalar(255), std::max(Scalar(0), q)));
+                        }
+
+                        // The first layer of each group gathers over the neighbours
+                        if (layer_no == 0) {
+                            q_output.resize(0);
+                            q_output.reserve(q_input.size() * (N_NEIGHBOURS + 1));
+                            for (unsigned int i = 0; i < n_points; ++i) {
+                                q_output.insert(q_output.end(),
+                                                std::next(q_input.begin(), i * input_dimensions),
+                                                std::next(q_input.begin(), (i + 1) * input_dimensions));
+                                for (const auto& n : neighbourhood[i]) {
+                                    q_output.insert(q_output.end(),
+                                                    std::next(q_input.begin(), n * input_dimensions),
+                                                    std::next(q_input.begin(), (n + 1) * input_dimensions));
+                                }
+                            }
+                            std::swap(q_input, q_output);
+                            input_dimensions *= N_NEIGHBOURS + 1;
+                        }
+
+                        // Scale from the accumulator back to real values for each output
+                        output_dimensions = layer.biases.size();
+                        output_scales.resize(output_dimensions);
+                        for (unsigned int j = 0; j < output_dimensions; ++j) {
+                            output_scales[j] = layer.input.scale * layer.weight_scales[j];
+                        }
+
+                        // Apply the weights and bias, then the activation function while the point is still in cache
+                        output.resize(n_points * output_dimensions);
+                        for (unsigned int i = 0; i < n_points; ++i) {
+                            const uint8_t* in_point = q_input.data() + i * input_dimensions;
+                            Scalar* out_point       = output.data() + i * output_dimensions;
+                            for (unsigned int j = 0; j < output_dimensions; ++j) {
+                                const int32_t acc =
+                                  dot_product(in_point, layer.weights[j].data(), input_dimensions) + layer.biases[j];
+                                out_point[j] = Scalar(acc) * output_scales[j];
+                            }
+                            apply_activation(layer.activation, out_point, output_dimensions, accuracy);
+                        }
+
+                        // Swap our values over
+                        std::swap(input, output);
+                        input_dimensions = output_dimensions;
+                    }
+                }
+
+                return input_dimensions;
             }
 
-        private:
-            /// The network structure used to perform the operations
-            NetworkStructure<Scalar> structure;
+            /// The network structures used to perform the operations, the first is used when classifying a mesh
+            std::vector<NetworkStructure<Scalar>> networks;
+            /// The names of the heads of a branching network, whose trunk is the first network and heads the rest
+            std::vector<std::string> head_names;
+            /// How activations are stored between layers
+            ActivationStorage storage = ActivationStorage::FULL;
+            /// How closely exp and tanh are approximated when applying activation functions
+            ActivationAccuracy accuracy = ActivationAccuracy::EXACT;
+            /// Layers with a smaller fraction of non zero weights than this skip the zero weights
+            Scalar sparse_density = Scalar(0.75);
+            /// What is given back for each point of a classified mesh
+            OutputMode output_mode = OutputMode::CLASSIFICATIONS;
+            /// The non zero weights of each layer of each network that is sparse enough, empty for dense layers
+            std::vector<std::vector<std::vector<SparseWeights<Scalar>>>> sparse;
+            /// The compiled network used to perform the operations, if this engine was made with one
+            CompiledNetwork<Scalar> compiled;
+            /// The quantised network used to perform the operations, if this engine was made with one
+            QuantisedNetwork<Scalar> quantised;
+            /// The range of values seen at the input of each layer while calibrating
+            mutable CalibrationRanges<Scalar> calibration_ranges;
+
+            /// The most recent projection of each mesh so stationary cameras can skip projection
+            mutable ProjectionCache<Scalar> projection_cache;
+            /// The activations of the last frame so points whose input has not changed can skip the network
+            mutable ActivationCache<Scalar> activation_cache;
 
             /// An input buffer used to ping/pong when doing classification so we don't have to remake them
             mutable std::vector<Scalar> input;
             /// An output buffer used to ping/pong when doing classification so we don't have to remake them
             mutable std::vector<Scalar> output;
-
-            vec4<Scalar> get_pixel(const vec2<Scalar>& px,
-                                   const uint8_t* const image,
-                                   const vec2<int>& dimensions,
-                                   const int& depth) const {
-                int c              = (px[1] * dimensions[0] + px[0]) * depth;
-                vec4<Scalar> pixel = {image[c + 0] * Scalar(1.0 / 255.0),
-                                      image[c + 1] * Scalar(1.0 / 255.0),
-                                      image[c + 2] * Scalar(1.0 / 255.0),
-                                      (depth == 3) ? Scalar(0) : image[c + 3] * Scalar(1.0 / 255.0)};
-                return pixel;
-            };
-
-            vec4<Scalar> interpolate(const vec2<Scalar>& P,
-                                     const uint8_t* const image,
-                                     const vec2<int>& dimensions,
-                                     const int& depth) const {
-
-                // (x1, y1) -------------- (x2, y1)
-                //    |                       |
-                //    |                       |
-                //    |                       |
-                //    |           P           |
-                //    |                       |
-                //    |                       |
-                // (x1, y2) -------------- (x2, y2)
-                const Scalar x        = P[0];
-                const Scalar y        = P[1];
-                const Scalar x1       = std::floor(P[0]);
-                const Scalar x2       = std::ceil(P[0]);
-                const Scalar y1       = std::floor(P[1]);
-                const Scalar y2       = std::ceil(P[1]);
-                const vec4<Scalar> Q1 = get_pixel(vec2<Scalar>{x1, y1}, image, dimensions, depth);
-                const vec4<Scalar> Q2 = get_pixel(vec2<Scalar>{x2, y1}, image, dimensions, depth);
-                const vec4<Scalar> Q3 = get_pixel(vec2<Scalar>{x1, y2}, image, dimensions, depth);
-                const vec4<Scalar> Q4 = get_pixel(vec2<Scalar>{x2, y2}, image, dimensions, depth);
-
-                const vec4<Scalar> R1 = add(multiply(Q1, ((x2 - x) / (x2 - x1))), multiply(Q2, ((x - x1) / (x2 - x1))));
-                const vec4<Scalar> R2 = add(multiply(Q3, ((x2 - x) / (x2 - x1))), multiply(Q4, ((x - x1) / (x2 - x1))));
-
-                return add(multiply(R1, ((y2 - y) / (y2 - y1))), multiply(R2, ((y - y1) / (y2 - y1))));
-            };
+            /// Packed 16 bit input buffer used to ping/pong when storing activations at reduced precision
+            mutable std::vector<uint16_t> packed_input;
+            /// Packed 16 bit output buffer used to ping/pong when storing activations at reduced precision
+            mutable std::vector<uint16_t> packed_output;
+            /// A single point unpacked from 16 bit storage ready to be multiplied
+            mutable std::vector<Scalar> unpacked;
+            /// A single point's neighbourhood gathered ready for the first layer of a group
+            mutable std::vector<Scalar> gathered;
+            /// A single point's values between the layers of a group when it is classified on its own
+            mutable std::array<std::vector<Scalar>, 2> point_values;
+            /// The label of each point when only labels are being output
+            mutable std::vector<uint8_t> labels;
+            /// The quantised confidence of each point's label when it is being output
+            mutable std::vector<uint8_t> confidence;
+            /// Quantised input buffer used to ping/pong when running a quantised network
+            mutable std::vector<uint8_t> q_input;
+            /// Quantised output buffer used to ping/pong when running a quantised network
+            mutable std::vector<uint8_t> q_output;
+            /// The scale from the accumulator to real values for each output of the current quantised layer
+            mutable std::vector<Scalar> output_scales;
         };
 
     }  // namespace cpu
@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2017-2020 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef VISUALMESH_ENGINE_CPU_FAST_MATH_HPP
+#define VISUALMESH_ENGINE_CPU_FAST_MATH_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#endif
+
+namespace visualmesh {
+namespace engine {
+    namespace cpu {
+
+        /**
+         * @brief How closely the CPU engine approximates exp and tanh when applying activation functions
+         *
+         * @details
+         *  The approximations are only used for single precision, double precision always uses the standard library.
+         *  They are written to be vectorised with AVX2 and FMA, without those they are about as fast as the standard
+         *  library. The errors are the largest seen over the float inputs to exp in [-87, 88] and tanh in [-20, 20]
+         *  compared with the correctly rounded result. exp clamps its input to [-87, 88] so it never produces
+         *  denormals or infinities.
+         */
+        enum ActivationAccuracy {
+            /// Use std::exp and std::tanh
+            EXACT,
+            /// Degree 7 polynomial for exp and degree 11 for tanh, at most 1 ULP of error
+            ACCURATE,
+            /// Degree 4 polynomial for exp and degree 7 for tanh, at most 70 ULP of error (about 8e-6 relative)
+            FAST,
+        };
+
+        namespace fast_math {
+
+            /**
+             * @brief The minimax polynomials used by each accuracy
+             *
+             * @details
+             *  exp(r) is approximated as 1 + r + r^2 P(r) for r in [-ln(2)/2, ln(2)/2] after removing a power of two.
+             *  tanh(x) is approximated as x + x^3 Q(x^2) for |x| < 0.625 and 1 - 2 / (exp(2|x|) + 1) elsewhere.
+             *  The accurate coefficients are from Cephes.
+             */
+            template <ActivationAccuracy A>
+            struct Polynomial;
+
+            template <>
+            struct Polynomial<ActivationAccuracy::ACCURATE> {
+                static constexpr int EXP_TERMS  = 6;
+                static constexpr int TANH_TERMS = 5;
+                static constexpr float exp(const int& i) {
+                    constexpr float c[] = {1.9875691500e-4f,
+                                           1.3981999507e-3f,
+                                           8.3334519073e-3f,
+                                           4.1665795894e-2f,
+                                           1.6666665459e-1f,
+                                           5.0000001201e-1f};
+                    return c[i];
+                }
+                static constexpr float tanh(const int& i) {
+                    constexpr float c[] = {
+                      -5.70498872745e-3f, 2.06390887954e-2f, -5.37397155531e-2f, 1.33314422036e-1f, -3.33332819422e-1f};
+                    return c[i];
+                }
+            };
+
+            template <>
+            struct Polynomial<ActivationAccuracy::FAST> {
+                static constexpr int EXP_TERMS  = 3;
+                static constexpr int TANH_TERMS = 3;
+                static constexpr float exp(const int& i) {
+                    constexpr float c[] = {4.127774936e-2f, 1.675351530e-1f, 5.000511613e-1f};
+                    return c[i];
+                }
+                static constexpr float tanh(const int& i) {
+                    constexpr float c[] = {-4.051470439e-2f, 1.304827438e-1f, -3.331551147e-1f};
+                    return c[i];
+                }
+            };
+
+            /// The largest and smallest inputs to exp, chosen so that 2^n and the result are normal floats
+            constexpr float EXP_MAX = 88.0f;
+            constexpr float EXP_MIN = -87.0f;
+            /// log2(e) and ln(2) split into a part that is exact when multiplied by small integers and the remainder
+            constexpr float LOG2E  = 1.44269504088896341f;
+            constexpr float LN2_HI = 0.693359375f;
+            constexpr float LN2_LO = -2.12194440e-4f;
+            /// Adding this to a float of magnitude less than 2^22 leaves no bits below the units
+            constexpr float ROUNDER = 12582912.0f;
+            /// Below this tanh uses its odd polynomial, above it is computed from exp
+            constexpr float TANH_SMALL = 0.625f;
+
+            template <ActivationAccuracy A>
+            inline float exp(float x) {
+                x = std::min(EXP_MAX, std::max(EXP_MIN, x));
+
+                // Adding and removing 1.5 * 2^23 rounds to the nearest integer without a call to a rounding function
+                const float n = (x * LOG2E + ROUNDER) - ROUNDER;
+                const float r = (x - n * LN2_HI) - n * LN2_LO;
+
+                float p = Polynomial<A>::exp(0);
+                for (int i = 1; i < Polynomial<A>::EXP_TERMS; ++i) {
+                    p = p * r + Polynomial<A>::exp(i);
+                }
+                p = (p * r * r + r) + 1.0f;
+
+                // Multiply by 2^n by building its exponent directly
+                const uint32_t bits = uint32_t(int32_t(n) + 127) << 23;
+                float scale;
+                std::memcpy(&scale, &bits, sizeof(scale));
+                return p * scale;
+            }
+
+            template <ActivationAccuracy A>
+            inline float tanh(const float& x) {
+                const float a = std::abs(x);
+                if (a < TANH_SMALL) {
+                    const float x2 = x * x;
+                    float q        = Polynomial<A>::tanh(0);
+                    for (int i = 1; i < Polynomial<A>::TANH_TERMS; ++i) {
+                        q = q * x2 + Polynomial<A>::tanh(i);
+                    }
+                    return x + x * x2 * q;
+                }
+                return std::copysign(1.0f - 2.0f / (exp<A>(2.0f * a) + 1.0f), x);
+            }
+
+#if defined(__AVX2__) && defined(__FMA__)
+            template <ActivationAccuracy A>
+            inline __m256 exp(__m256 x) {
+                x              = _mm256_min_ps(_mm256_set1_ps(EXP_MAX), _mm256_max_ps(_mm256_set1_ps(EXP_MIN), x));
+                const __m256 n = _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(LOG2E)),
+                                                 _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+                const __m256 r =
+                  _mm256_fnmadd_ps(n, _mm256_set1_ps(LN2_LO), _mm256_fnmadd_ps(n, _mm256_set1_ps(LN2_HI), x));
+
+                __m256 p = _mm256_set1_ps(Polynomial<A>::exp(0));
+                for (int i = 1; i < Polynomial<A>::EXP_TERMS; ++i) {
+                    p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(Polynomial<A>::exp(i)));
+                }
+                p = _mm256_add_ps(_mm256_fmadd_ps(_mm256_mul_ps(p, r), r, r), _mm256_set1_ps(1.0f));
+
+                // Multiply by 2^n by building its exponent directly
+                const __m256i bits =
+                  _mm256_slli_epi32(_mm256_add_epi32(_mm256_cvtps_epi32(n), _mm256_set1_epi32(127)), 23);
+                return _mm256_mul_ps(p, _mm256_castsi256_ps(bits));
+            }
+
+            template <ActivationAccuracy A>
+            inline __m256 tanh(const __m256& x) {
+                const __m256 sign = _mm256_and_ps(x, _mm256_set1_ps(-0.0f));
+                const __m256 a    = _mm256_xor_ps(x, sign);
+
+                // Odd polynomial for small values
+                const __m256 x2 = _mm256_mul_ps(x, x);
+                __m256 q        = _mm256_set1_ps(Polynomial<A>::tanh(0));
+                for (int i = 1; i < Polynomial<A>::TANH_TERMS; ++i) {
+                    q = _mm256_fmadd_ps(q, x2, _mm256_set1_ps(Polynomial<A>::tanh(i)));
+                }
+                const __m256 small = _mm256_fmadd_ps(_mm256_mul_ps(x, x2), q, x);
+
+                // From exp for everything else
+                const __m256 e     = exp<A>(_mm256_add_ps(a, a));
+                const __m256 large = _mm256_sub_ps(
+                  _mm256_set1_ps(1.0f), _mm256_div_ps(_mm256_set1_ps(2.0f), _mm256_add_ps(e, _mm256_set1_ps(1.0f))));
+
+                return _mm256_blendv_ps(
+                  _mm256_or_ps(large, sign), small, _mm256_cmp_ps(a, _mm256_set1_ps(TANH_SMALL), _CMP_LT_OQ));
+            }
+#endif
+
+        }  // namespace fast_math
+
+    }  // namespace cpu
+}  // namespace engine
+}  // namespace visualmesh
+
+#endif  // VISUALMESH_ENGINE_CPU_FAST_MATH_HPP
@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2017-2020 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef VISUALMESH_ENGINE_CPU_HALF_HPP
+#define VISUALMESH_ENGINE_CPU_HALF_HPP
+
+#include <cstdint>
+#include <cstring>
+
+#include "visualmesh/activation_storage.hpp"
+
+#if defined(__F16C__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace visualmesh {
+namespace engine {
+    namespace cpu {
+
+        namespace half {
+
+            inline uint32_t bits(const float& f) {
+                uint32_t u;
+                std::memcpy(&u, &f, sizeof(u));
+                return u;
+            }
+
+            inline float from_bits(const uint32_t& u) {
+                float f;
+                std::memcpy(&f, &u, sizeof(f));
+                return f;
+            }
+
+            /**
+             * @brief Convert a single precision float to half precision rounding to nearest even
+             */
+            inline uint16_t from_float(const float& value) {
+                uint32_t f          = bits(value);
+                const uint32_t sign = (f >> 16) & 0x8000;
+                f &= 0x7FFFFFFF;
+
+                // Too large for a half becomes infinity, NaN stays NaN
+                if (f >= 0x47800000) { return sign | (f > 0x7F800000 ? 0x7E00 : 0x7C00); }
+
+                // Small enough to be a subnormal half, adding 0.5 lines the mantissa up with the half's last place
+                if (f < 0x38800000) { return sign | (bits(from_bits(f) + 0.5f) - 0x3F000000); }
+
+                // Rebias the exponent and round the 13 bits that are dropped
+                f += 0xC8000FFF + ((f >> 13) & 1);
+                return sign | (f >> 13);
+            }
+
+            /**
+             * @brief Convert a half precision float to single precision
+             */
+            inline float to_float(const uint16_t& h) {
+                const uint32_t sign     = uint32_t(h & 0x8000) << 16;
+                const uint32_t exponent = (h >> 10) & 0x1F;
+                const uint32_t mantissa = h & 0x3FF;
+
+                if (exponent == 0) {
+                    const float f = float(mantissa) * 5.9604644775390625e-8f;  // 2^-24
+                    return sign ? -f : f;
+                }
+                if (exponent == 31) { return from_bits(sign | 0x7F800000 | (mantissa << 13)); }
+                return from_bits(sign | ((exponent + 112) << 23) | (mantissa << 13));
+            }
+
+        }  // namespace half
+
+        namespace bfloat16 {
+
+            /**
+             * @brief Convert a single precision float to bfloat16 rounding to nearest even
+             */
+            inline uint16_t from_float(const float& value) {
+                const uint32_t f = half::bits(value);
+                // Keep NaNs quiet rather than letting rounding carry them into infinity
+                if ((f & 0x7FFFFFFF) > 0x7F800000) { return (f >> 16) | 0x40; }
+                return (f + 0x7FFF + ((f >> 16) & 1)) >> 16;
+            }
+
+            /**
+             * @brief Convert a bfloat16 to single precision
+             */
+            inline float to_float(const uint16_t& b) {
+                return half::from_bits(uint32_t(b) << 16);
+            }
+
+        }  // namespace bfloat16
+
+        /**
+         * @brief Packs values into 16 bit storage using either half precision or bfloat16
+         *
+         * @param storage the 16 bit format to pack the values into
+         * @param in      the values to pack
+         * @param out     where to write the packed values
+         * @param n       the number of values to pack
+         */
+        inline void encode(const ActivationStorage& storage, const float* in, uint16_t* out, const int& n) {
+            int i = 0;
+            if (storage == ActivationStorage::HALF) {
+#if defined(__F16C__)
+                for (; i + 8 <= n; i += 8) {
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                                     _mm256_cvtps_ph(_mm256_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT));
+                }
+#endif
+                for (; i < n; ++i) {
+                    out[i] = half::from_float(in[i]);
+                }
+            }
+            else {
+#if defined(__AVX2__)
+                const __m256i one      = _mm256_set1_epi32(1);
+                const __m256i rounding = _mm256_set1_epi32(0x7FFF);
+                const __m256i quiet    = _mm256_set1_epi32(0x400000);
+                for (; i + 8 <= n; i += 8) {
+                    const __m256 v     = _mm256_loadu_ps(in + i);
+                    const __m256i f    = _mm256_castps_si256(v);
+                    const __m256i nan  = _mm256_castps_si256(_mm256_cmp_ps(v, v, _CMP_UNORD_Q));
+                    const __m256i lsb  = _mm256_and_si256(_mm256_srli_epi32(f, 16), one);
+                    const __m256i even = _mm256_add_epi32(f, _mm256_add_epi32(rounding, lsb));
+                    const __m256i r = _mm256_srli_epi32(_mm256_blendv_epi8(even, _mm256_or_si256(f, quiet), nan), 16);
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i),
+                                     _mm_packus_epi32(_mm256_castsi256_si128(r), _mm256_extracti128_si256(r, 1)));
+                }
+#endif
+                for (; i < n; ++i) {
+                    out[i] = bfloat16::from_float(in[i]);
+                }
+            }
+        }
+
+        /**
+         * @brief Unpacks values from 16 bit storage using either half precision or bfloat16
+         *
+         * @param storage the 16 bit format the values are packed in
+         * @param in      the packed values
+         * @param out     where to write the unpacked values
+         * @param n       the number of values to unpack
+         */
+        inline void decode(const ActivationStorage& storage, const uint16_t* in, float* out, const int& n) {
+            int i = 0;
+            if (storage == ActivationStorage::HALF) {
+#if defined(__F16C__)
+                for (; i + 8 <= n; i += 8) {
+                    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+                    _mm256_storeu_ps(out + i, _mm256_cvtph_ps(v));
+                }
+#endif
+                for (; i < n; ++i) {
+                    out[i] = half::to_float(in[i]);
+                }
+            }
+            else {
+#if defined(__AVX2__)
+                for (; i + 8 <= n; i += 8) {
+                    const __m256i v = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)));
+                    _mm256_storeu_ps(out + i, _mm256_castsi256_ps(_mm256_slli_epi32(v, 16)));
+                }
+#endif
+                for (; i < n; ++i) {
+                    out[i] = bfloat16::to_float(in[i]);
+                }
+            }
+        }
+
+        /**
+         * @brief Packs values of any other scalar type into 16 bit storage by way of single precision
+         */
+        template <typename Scalar>
+        void encode(const ActivationStorage& storage, const Scalar* in, uint16_t* out, const int& n) {
+            for (int i = 0; i < n; ++i) {
+                out[i] = storage == ActivationStorage::HALF ? half::from_float(float(in[i]))
+                                                            : bfloat16::from_float(float(in[i]));
+            }
+        }
+
+        /**
+         * @brief Unpacks values from 16 bit storage into any other scalar type by way of single precision
+         */
+        template <typename Scalar>
+        void decode(const ActivationStorage& storage, const uint16_t* in, Scalar* out, const int& n) {
+            for (int i = 0; i < n; ++i) {
+                out[i] = storage == ActivationStorage::HALF ? half::to_float(in[i]) : bfloat16::to_float(in[i]);
+            }
+        }
+
+    }  // namespace cpu
+}  // namespace engine
+}  // namespace visualmesh
+
+#endif  // VISUALMESH_ENGINE_CPU_HALF_HPP
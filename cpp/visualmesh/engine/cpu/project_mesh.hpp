@@ -0,0 +1,261 @@
+/*
+ * Copyright (C) 2017-2020 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef VISUALMESH_ENGINE_CPU_PROJECT_MESH_HPP
+#define VISUALMESH_ENGINE_CPU_PROJECT_MESH_HPP
+
+#include <algorithm>
+#include <array>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+#include "visualmesh/lens.hpp"
+#include "visualmesh/mesh.hpp"
+#include "visualmesh/projected_mesh.hpp"
+#include "visualmesh/region_of_interest.hpp"
+#include "visualmesh/utility/math.hpp"
+#include "visualmesh/utility/projection.hpp"
+
+namespace visualmesh {
+namespace engine {
+    namespace cpu {
+
+        /**
+         * @brief Builds the local neighbourhood graph for the projected points of a mesh, where neighbours that were
+         * not projected are replaced with an extra offscreen point at the end
+         *
+         * @tparam Scalar the scalar type used for calculations and storage (normally one of float or double)
+         * @tparam Model  the mesh model that was projected
+         *
+         * @param mesh           the mesh table that was projected
+         * @param global_indices the index of each projected point in the mesh
+         * @param pixels         the pixel coordinates of each projected point
+         *
+         * @return the projected mesh made from these points
+         */
+        template <typename Scalar, template <typename> class Model>
+        ProjectedMesh<Scalar, Model<Scalar>::N_NEIGHBOURS> make_projected_mesh(const Mesh<Scalar, Model>& mesh,
+                                                                               std::vector<int>&& global_indices,
+                                                                               std::vector<vec2<Scalar>>&& pixels) {
+            static constexpr int N_NEIGHBOURS = Model<Scalar>::N_NEIGHBOURS;
+            const auto& nodes                 = mesh.nodes;
+            const unsigned int n_points       = pixels.size();
+
+            // Build our reverse lookup, the default point goes to the null point
+            std::vector<int> r_lookup(nodes.size() + 1, n_points);
+            for (unsigned int i = 0; i < n_points; ++i) {
+                r_lookup[global_indices[i]] = i;
+            }
+
+            // Build our local neighbourhood map
+            std::vector<std::array<int, N_NEIGHBOURS>> neighbourhood(n_points + 1);  // +1 for the null point
+            for (unsigned int i = 0; i < n_points; ++i) {
+                const Node<Scalar, N_NEIGHBOURS>& node = nodes[global_indices[i]];
+                for (unsigned int j = 0; j < node.neighbours.size(); ++j) {
+                    const auto& n       = node.neighbours[j];
+                    neighbourhood[i][j] = r_lookup[n];
+                }
+            }
+            // Last point is the null point
+            neighbourhood[n_points].fill(n_points);
+
+            return ProjectedMesh<Scalar, N_NEIGHBOURS>{
+              std::move(pixels), std::move(neighbourhood), std::move(global_indices)};
+        }
+
+        /**
+         * @brief Projects the points of a mesh that a lookup found to pixel coordinates on the CPU.
+         *
+         * @details
+         *  This lets a caller that has already looked up a mesh, for example to count its on screen points, project it
+         *  without looking it up again.
+         *
+         * @tparam Scalar the scalar type used for calculations and storage (normally one of float or double)
+         * @tparam Model  the mesh model that we are projecting
+         *
+         * @param mesh   the mesh table that we are projecting to pixel coordinates
+         * @param Hoc    the homogenous transformation matrix from the camera to the observation plane
+         * @param lens   the lens parameters that describe the optics of the camera
+         * @param ranges the on screen ranges of the mesh, as returned by looking it up with Hoc and lens
+         *
+         * @return a projected mesh for the provided arguments
+         */
+        template <typename Scalar, template <typename> class Model>
+        ProjectedMesh<Scalar, Model<Scalar>::N_NEIGHBOURS> project_ranges(
+          const Mesh<Scalar, Model>& mesh,
+          const mat4<Scalar>& Hoc,
+          const Lens<Scalar>& lens,
+          const std::vector<std::pair<int, int>>& ranges) {
+            // Convenience variables
+            const auto& nodes = mesh.nodes;
+            const mat3<Scalar> Rco(block<3, 3>(transpose(Hoc)));
+
+            // Work out how many points total there are in the ranges
+            unsigned int n_points = 0;
+            for (auto& r : ranges) {
+                n_points += r.second - r.first;
+            }
+
+            // Output variables
+            std::vector<int> global_indices;
+            global_indices.reserve(n_points);
+            std::vector<vec2<Scalar>> pixels;
+            pixels.reserve(n_points);
+
+            // Loop through adding global indices and pixel coordinates
+            for (const auto& range : ranges) {
+                for (int i = range.first; i < range.second; ++i) {
+                    // Even though we have already gone through a bsp to remove out of range points, sometimes it's
+                    // not perfect and misses by a few pixels. So as we are projecting the points here we also need
+                    // to check that they are on screen
+                    auto px = project(multiply(Rco, nodes[i].ray), lens);
+                    if (0 <= px[0] && px[0] + 1 < lens.dimensions[0] && 0 <= px[1]
+                        && px[1] + 1 < lens.dimensions[1]) {
+                        global_indices.emplace_back(i);
+                        pixels.emplace_back(px);
+                    }
+                }
+            }
+
+            return make_projected_mesh(mesh, std::move(global_indices), std::move(pixels));
+        }
+
+        /**
+         * @brief Projects a mesh to pixel coordinates on the CPU.
+         *
+         * @details
+         *  This only reads from the mesh so it is safe to call from several threads at once, which allows a projection
+         *  to be prepared on another thread while an engine is busy.
+         *
+         * @tparam Scalar the scalar type used for calculations and storage (normally one of float or double)
+         * @tparam Model  the mesh model that we are projecting
+         *
+         * @param mesh the mesh table that we are projecting to pixel coordinates
+         * @param Hoc  the homogenous transformation matrix from the camera to the observation plane
+         * @param lens the lens parameters that describe the optics of the camera
+         *
+         * @return a projected mesh for the provided arguments
+         */
+        template <typename Scalar, template <typename> class Model>
+        ProjectedMesh<Scalar, Model<Scalar>::N_NEIGHBOURS> project_mesh(const Mesh<Scalar, Model>& mesh,
+                                                                        const mat4<Scalar>& Hoc,
+                                                                        const Lens<Scalar>& lens) {
+            return project_ranges(mesh, Hoc, lens, mesh.lookup(Hoc, lens));
+        }
+
+        /**
+         * @brief Projects the part of a mesh that is inside a region of interest to pixel coordinates on the CPU.
+         *
+         * @details
+         *  The points inside the region are found by looking up the mesh with the region, and then the rings of
+         *  neighbours around them that are on screen are added so a network sees the same neighbourhood for the points
+         *  in the region as it would for the whole image. A network with n convolutional groups reads from n rings of
+         *  neighbours. The points stay in the same order that they are in the mesh.
+         *
+         * @tparam Scalar the scalar type used for calculations and storage (normally one of float or double)
+         * @tparam Model  the mesh model that we are projecting
+         *
+         * @param mesh   the mesh table that we are projecting to pixel coordinates
+         * @param Hoc    the homogenous transformation matrix from the camera to the observation plane
+         * @param lens   the lens parameters that describe the optics of the camera
+         * @param region the part of the image to project
+         * @param rings  the number of rings of neighbours to add around the points in the region
+         *
+         * @return a projected mesh of the points in the region and the rings around them
+         */
+        template <typename Scalar, template <typename> class Model>
+        ProjectedMesh<Scalar, Model<Scalar>::N_NEIGHBOURS> project_region(const Mesh<Scalar, Model>& mesh,
+                                                                          const mat4<Scalar>& Hoc,
+                                                                          const Lens<Scalar>& lens,
+                                                                          const RegionOfInterest<Scalar>& region,
+                                                                          const int& rings) {
+            // A region that is the whole image is the same as projecting the whole mesh
+            if (region.covers(lens)) { return project_mesh(mesh, Hoc, lens); }
+
+            const auto& nodes = mesh.nodes;
+            const mat3<Scalar> Rco(block<3, 3>(transpose(Hoc)));
+            const vec3<Scalar>& rXCo = Rco[0];  // Camera x in world space
+            const Scalar cos_fov     = std::cos(lens.fov * Scalar(0.5));
+
+            // The lookup can miss points within a pixel or so of the edges of the rectangle, so look up a slightly
+            // larger one and keep the points that pass the same check as RegionOfInterest::contains
+            RegionOfInterest<Scalar> padded = region;
+            for (int i = 0; i < 2; ++i) {
+                padded.top_left[i] -= Scalar(2.0);
+                padded.bottom_right[i] += Scalar(2.0);
+            }
+
+            // Find the points in the region
+            std::vector<int> indices;
+            std::vector<vec2<Scalar>> px;
+            std::vector<bool> added(nodes.size() + 1, false);
+            added[nodes.size()] = true;  // The null point is never projected
+            for (const auto& range : mesh.lookup(Hoc, lens, padded)) {
+                for (int i = range.first; i < range.second; ++i) {
+                    auto p = project(multiply(Rco, nodes[i].ray), lens);
+                    if (0 <= p[0] && p[0] + 1 < lens.dimensions[0] && 0 <= p[1] && p[1] + 1 < lens.dimensions[1]
+                        && region.contains(p, Hoc, lens)) {
+                        indices.emplace_back(i);
+                        px.emplace_back(p);
+                        added[i] = true;
+                    }
+                }
+            }
+
+            // Grow the region a ring of neighbours at a time, keeping the neighbours that the whole screen would keep
+            std::size_t ring_start = 0;
+            for (int ring = 0; ring < rings; ++ring) {
+                const std::size_t ring_end = indices.size();
+                for (std::size_t k = ring_start; k < ring_end; ++k) {
+                    for (const auto& n : nodes[indices[k]].neighbours) {
+                        if (added[n]) { continue; }
+                        added[n] = true;
+                        auto p   = project(multiply(Rco, nodes[n].ray), lens);
+                        if (dot(rXCo, nodes[n].ray) > cos_fov && 0 <= p[0] && p[0] + 1 < lens.dimensions[0] && 0 <= p[1]
+                            && p[1] + 1 < lens.dimensions[1]) {
+                            indices.emplace_back(n);
+                            px.emplace_back(p);
+                        }
+                    }
+                }
+                ring_start = ring_end;
+            }
+
+            // Put the points back in the order they are in the mesh
+            std::vector<int> order(indices.size());
+            std::iota(order.begin(), order.end(), 0);
+            std::sort(order.begin(), order.end(), [&indices](const int& a, const int& b) {  //
+                return indices[a] < indices[b];
+            });
+            std::vector<int> global_indices;
+            global_indices.reserve(order.size());
+            std::vector<vec2<Scalar>> pixels;
+            pixels.reserve(order.size());
+            for (const auto& o : order) {
+                global_indices.emplace_back(indices[o]);
+                pixels.emplace_back(px[o]);
+            }
+
+            return make_projected_mesh(mesh, std::move(global_indices), std::move(pixels));
+        }
+
+    }  // namespace cpu
+}  // namespace engine
+}  // namespace visualmesh
+
+#endif  // VISUALMESH_ENGINE_CPU_PROJECT_MESH_HPP
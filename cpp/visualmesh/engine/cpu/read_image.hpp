@@ -0,0 +1,212 @@
+/*
+ * Copyright (C) 2017-2020 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef VISUALMESH_ENGINE_CPU_READ_IMAGE_HPP
+#define VISUALMESH_ENGINE_CPU_READ_IMAGE_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "visualmesh/utility/math.hpp"
+
+namespace visualmesh {
+namespace engine {
+    namespace cpu {
+
+        /**
+         * @brief Reads pixels from an 8 bit greyscale image, copying the intensity into each colour channel
+         *
+         * @tparam Scalar the scalar type used for calculations and storage (normally one of float or double)
+         */
+        template <typename Scalar>
+        struct Grey {
+            const uint8_t* image;
+            vec2<int> dimensions;
+
+            vec4<Scalar> operator()(const int& x, const int& y) const {
+                const Scalar v = image[y * dimensions[0] + x] * Scalar(1.0 / 255.0);
+                return vec4<Scalar>{v, v, v, Scalar(0)};
+            }
+        };
+
+        /**
+         * @brief Converts a YUV pixel to RGB using the BT.601 limited range coefficients that V4L2 cameras produce
+         */
+        template <typename Scalar>
+        inline vec4<Scalar> yuv_to_rgb(const int& y, const int& u, const int& v) {
+            const Scalar Y = Scalar(1.164383) * Scalar(y - 16);
+            const Scalar U = Scalar(u - 128);
+            const Scalar V = Scalar(v - 128);
+
+            const auto clamp = [](const Scalar& c) {
+                return std::min(std::max(c * Scalar(1.0 / 255.0), Scalar(0)), Scalar(1));
+            };
+            return vec4<Scalar>{clamp(Y + Scalar(1.596027) * V),
+                                clamp(Y - Scalar(0.391762) * U - Scalar(0.812968) * V),
+                                clamp(Y + Scalar(2.017232) * U),
+                                Scalar(0)};
+        }
+
+        /**
+         * @brief Reads pixels from a packed 4:2:2 YUV image (YUYV or UYVY) where each pair of pixels shares its chroma
+         *
+         * @tparam Scalar the scalar type used for calculations and storage (normally one of float or double)
+         */
+        template <typename Scalar>
+        struct PackedYUV {
+            const uint8_t* image;
+            vec2<int> dimensions;
+            /// The byte offsets of the first luma and the two chroma values in each four byte pair of pixels
+            int Y;
+            int U;
+            int V;
+
+            vec4<Scalar> operator()(const int& x, const int& y) const {
+                const uint8_t* const pair = image + (y * dimensions[0] + (x & ~1)) * 2;
+                return yuv_to_rgb<Scalar>(pair[Y + (x & 1) * 2], pair[U], pair[V]);
+            }
+        };
+
+        /**
+         * @brief Reads pixels from an NV12 image, a full resolution luma plane followed by a half resolution plane of
+         * interleaved U and V values
+         *
+         * @tparam Scalar the scalar type used for calculations and storage (normally one of float or double)
+         */
+        template <typename Scalar>
+        struct NV12 {
+            const uint8_t* image;
+            vec2<int> dimensions;
+
+            vec4<Scalar> operator()(const int& x, const int& y) const {
+                const uint8_t* const uv = image + dimensions[0] * (dimensions[1] + y / 2) + (x & ~1);
+                return yuv_to_rgb<Scalar>(image[y * dimensions[0] + x], uv[0], uv[1]);
+            }
+        };
+
+        /**
+         * @brief Bilinearly interpolates the image at a point from the four pixels that surround it
+         *
+         * @tparam Scalar the scalar type used for calculations and storage (normally one of float or double)
+         * @tparam Reader the type that reads a single pixel from the image at integer coordinates
+         *
+         * @param P          the pixel coordinates to sample the image at
+         * @param read       reads the pixel at an integer coordinate in RGBA order
+         * @param dimensions the dimensions of the image, neighbours outside of it are clamped to its edge
+         *
+         * @return the interpolated value at P
+         */
+        template <typename Scalar, typename Reader>
+        inline vec4<Scalar> interpolate(const vec2<Scalar>& P, const Reader& read, const vec2<int>& dimensions) {
+
+            // (x1, y1) -------------- (x2, y1)
+            //    |                       |
+            //    |                       |
+            //    |                       |
+            //    |           P           |
+            //    |                       |
+            //    |                       |
+            // (x1, y2) -------------- (x2, y2)
+            // The far pixels are always one further on so a point exactly on a pixel gives all its weight to it
+            const Scalar x1 = std::floor(P[0]);
+            const Scalar y1 = std::floor(P[1]);
+            const Scalar fx = P[0] - x1;
+            const Scalar fy = P[1] - y1;
+
+            const auto cx = [&dimensions](const int& v) { return std::min(std::max(v, 0), dimensions[0] - 1); };
+            const auto cy = [&dimensions](const int& v) { return std::min(std::max(v, 0), dimensions[1] - 1); };
+            const vec4<Scalar> Q1 = read(cx(int(x1)), cy(int(y1)));
+            const vec4<Scalar> Q2 = read(cx(int(x1) + 1), cy(int(y1)));
+            const vec4<Scalar> Q3 = read(cx(int(x1)), cy(int(y1) + 1));
+            const vec4<Scalar> Q4 = read(cx(int(x1) + 1), cy(int(y1) + 1));
+
+            const vec4<Scalar> R1 = add(multiply(Q1, Scalar(1) - fx), multiply(Q2, fx));
+            const vec4<Scalar> R2 = add(multiply(Q3, Scalar(1) - fx), multiply(Q4, fx));
+
+            return add(multiply(R1, Scalar(1) - fy), multiply(R2, fy));
+        }
+
+        /**
+         * @brief Demosaics a single point of an 8 bit bayer image, mirroring bayerToRGB in the OpenCL load_image kernel
+         * so that both engines give the network the same input
+         *
+         * @details Code adapted from http://graphics.cs.williams.edu/papers/BayerJGT09/
+         *
+         * @tparam Scalar the scalar type used for calculations and storage (normally one of float or double)
+         *
+         * @param coord      the coordinate to read from, sampled at the nearest pixel
+         * @param image      the raw bayer image
+         * @param dimensions the dimensions of the image, pixels outside of it read as 0
+         * @param first_red  the coordinate for the first red pixel in the bayer pattern
+         *
+         * @return the RGB pixel at the given location in the bayer image
+         */
+        template <typename Scalar>
+        inline vec4<Scalar> bayer_to_rgb(const vec2<Scalar>& coord,
+                                         const uint8_t* const image,
+                                         const vec2<int>& dimensions,
+                                         const vec2<Scalar>& first_red) {
+
+            const int cx = int(std::floor(coord[0]));
+            const int cy = int(std::floor(coord[1]));
+            const auto fetch = [&](const int& dx, const int& dy) {
+                const int x = cx + dx;
+                const int y = cy + dy;
+                return (x < 0 || y < 0 || x >= dimensions[0] || y >= dimensions[1])
+                         ? Scalar(0)
+                         : image[y * dimensions[0] + x] * Scalar(1.0 / 255.0);
+            };
+
+            const Scalar C = fetch(0, 0);
+
+            // Determine which of four types of pixels we are on.
+            const bool alternate_x = std::fmod(std::floor(coord[0] + first_red[0]), Scalar(2)) != Scalar(0);
+            const bool alternate_y = std::fmod(std::floor(coord[1] + first_red[1]), Scalar(2)) != Scalar(0);
+
+            const Scalar D = fetch(-1, -1) + fetch(-1, 1) + fetch(1, -1) + fetch(1, 1);
+
+            // The same taps as the OpenCL kernel, which sums the 2 away taps into E and the 1 away taps into F
+            const Scalar A = fetch(0, -2) + fetch(0, 2);
+            const Scalar B = fetch(0, -1) + fetch(0, 1);
+            const Scalar E = fetch(-2, 0) + fetch(2, 0);
+            const Scalar F = fetch(-1, 0) + fetch(1, 0);
+
+            // There are five filter patterns (identity, cross, checker, theta, phi).
+            //   x       cross   (e.g., EE G)
+            //   y       checker (e.g., EE B)
+            //   z       theta   (e.g., EO R)
+            //   w       phi     (e.g., EO R)
+            const Scalar px = Scalar(0.5) * C - Scalar(0.125) * A - Scalar(0.125) * E + Scalar(0.25) * B
+                              + Scalar(0.25) * F;
+            const Scalar py = Scalar(0.75) * C + Scalar(0.25) * D - Scalar(0.1875) * A - Scalar(0.1875) * E;
+            const Scalar pz = Scalar(0.625) * C - Scalar(0.125) * D + Scalar(0.0625) * A - Scalar(0.125) * E
+                              + Scalar(0.5) * F;
+            const Scalar pw = Scalar(0.625) * C - Scalar(0.125) * D - Scalar(0.125) * A + Scalar(0.0625) * E
+                              + Scalar(0.5) * B;
+
+            if (!alternate_y) {
+                return alternate_x ? vec4<Scalar>{pz, C, pw, Scalar(1)} : vec4<Scalar>{C, px, py, Scalar(1)};
+            }
+            return alternate_x ? vec4<Scalar>{py, px, C, Scalar(1)} : vec4<Scalar>{pw, C, pz, Scalar(1)};
+        }
+
+    }  // namespace cpu
+}  // namespace engine
+}  // namespace visualmesh
+
+#endif  // VISUALMESH_ENGINE_CPU_READ_IMAGE_HPP
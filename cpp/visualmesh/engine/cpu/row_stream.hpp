@@ -0,0 +1,242 @@
+/*
+ * Copyright (C) 2017-2020 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef VISUALMESH_ENGINE_CPU_ROW_STREAM_HPP
+#define VISUALMESH_ENGINE_CPU_ROW_STREAM_HPP
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "engine.hpp"
+#include "visualmesh/activation_storage.hpp"
+#include "visualmesh/classified_mesh.hpp"
+#include "visualmesh/engine/label_outputs.hpp"
+#include "visualmesh/lens.hpp"
+#include "visualmesh/projected_mesh.hpp"
+#include "visualmesh/utility/fourcc.hpp"
+
+namespace visualmesh {
+namespace engine {
+    namespace cpu {
+
+        /**
+         * @brief Classifies a projected mesh while its image is still arriving from the camera, one band of rows at a
+         * time
+         *
+         * @details
+         *  Cameras read their images out from top to bottom. Rather than waiting for the whole frame, each point is
+         *  sampled as soon as the rows it interpolates from have arrived, and each group of the network is run for a
+         *  point as soon as that point and its neighbours have been through the previous group. When the last rows
+         *  arrive only the points near the bottom of the image are left to do.
+         *
+         *  The order that points become ready is worked out once when the stream is made, so each push only walks over
+         *  the points that it makes ready. The result is the same as classifying the whole frame at full precision with
+         *  the first network of the engine. Quantised, compiled and branching engines can't be streamed, nor can
+         *  engines that don't keep full activation storage.
+         *
+         * @tparam Scalar       the scalar type used for calculations and storage (normally one of float or double)
+         * @tparam N_NEIGHBOURS the number of neighbours that each point has
+         */
+        template <typename Scalar, int N_NEIGHBOURS>
+        class RowStream {
+        public:
+            /**
+             * @brief Start streaming a frame
+             *
+             * @param engine    the engine to classify with, which must outlive the stream and not be used elsewhere
+             *                  until the stream is finished
+             * @param projected the projected mesh to classify, as made by projecting a mesh with the engine
+             * @param lens      the lens parameters that describe the optics of the camera
+             * @param format    the pixel format of the image as a fourcc code
+             */
+            RowStream(const Engine<Scalar>& engine,
+                      ProjectedMesh<Scalar, N_NEIGHBOURS> projected,
+                      const Lens<Scalar>& lens,
+                      const uint32_t& format)
+              : engine(engine), projected(std::move(projected)), lens(lens), format(format) {
+
+                if (!engine.quantised.empty() || engine.compiled.classify != nullptr || !engine.head_names.empty()
+                    || engine.networks.empty() || engine.storage != ActivationStorage::FULL) {
+                    throw std::runtime_error(
+                      "Only an engine running a single floating point network with full storage can be streamed");
+                }
+
+                const auto& structure = engine.networks.front();
+                const auto& graph     = this->projected.neighbourhood;
+                const int n_points    = graph.size();
+                if (n_points == 0) { return; }
+
+                // The rows each point needs before it can be sampled, the offscreen point is always ready
+                ready.assign(structure.size() + 1, std::vector<int>(n_points, 0));
+                for (int i = 0; i + 1 < n_points; ++i) {
+                    ready[0][i] = rows_needed(this->projected.pixel_coordinates[i][1]);
+                }
+
+                // A point is ready for a group once it and its neighbours have been through the group before it
+                for (unsigned int g = 1; g < ready.size(); ++g) {
+                    for (int i = 0; i < n_points; ++i) {
+                        int r = ready[g - 1][i];
+                        for (const auto& n : graph[i]) {
+                            r = std::max(r, ready[g - 1][n]);
+                        }
+                        ready[g][i] = r;
+                    }
+                }
+
+                // Sort the points of each group by when they are ready so each push can pick up where the last stopped
+                order.resize(ready.size());
+                cursor.assign(ready.size(), 0);
+                for (unsigned int g = 0; g < ready.size(); ++g) {
+                    order[g].resize(n_points);
+                    std::iota(order[g].begin(), order[g].end(), 0);
+                    std::stable_sort(order[g].begin(), order[g].end(), [&](const int& a, const int& b) {
+                        return ready[g][a] < ready[g][b];
+                    });
+                }
+
+                // The image is four values for each point, then each group has the width of its last layer
+                dimensions.push_back(4);
+                for (const auto& conv : structure) {
+                    dimensions.push_back(conv.back().biases.size());
+                }
+                values.resize(ready.size());
+                for (unsigned int g = 0; g < ready.size(); ++g) {
+                    values[g].resize(n_points * dimensions[g]);
+                }
+
+                // Four -1 values for the offscreen point
+                std::fill(values[0].end() - 4, values[0].end(), Scalar(-1.0));
+            }
+
+            /**
+             * @brief Tell the stream that more of the image has arrived and classify every point that now can be
+             *
+             * @param image the image being received, which must hold the rows that have arrived so far
+             * @param rows  how many rows from the top of the image have arrived
+             */
+            void push(const void* image, const int& rows) {
+                if (ready.empty()) { return; }
+
+                // Sample the points whose rows have all arrived
+                std::vector<std::array<Scalar, 2>> pixels;
+                const std::size_t first = cursor[0];
+                for (auto& c = cursor[0]; c < order[0].size() && ready[0][order[0][c]] <= rows; ++c) {
+                    const int i = order[0][c];
+                    if (i + 1 < int(order[0].size())) { pixels.push_back(projected.pixel_coordinates[i]); }
+                }
+                if (!pixels.empty()) {
+                    engine.input.clear();
+                    engine.load_image(pixels, lens, image, format);
+                    const Scalar* sample = engine.input.data();
+                    for (std::size_t c = first; c < cursor[0]; ++c) {
+                        const int i = order[0][c];
+                        if (i + 1 < int(order[0].size())) {
+                            std::copy(sample, sample + 4, values[0].begin() + i * 4);
+                            sample += 4;
+                        }
+                    }
+                }
+
+                // Run each group for the points whose neighbours are now through the group before it
+                for (unsigned int g = 1; g < ready.size(); ++g) {
+                    for (auto& c = cursor[g]; c < order[g].size() && ready[g][order[g][c]] <= rows; ++c) {
+                        const int i = order[g][c];
+                        engine.classify_point(g - 1,
+                                              projected.neighbourhood[i],
+                                              i,
+                                              values[g - 1],
+                                              dimensions[g - 1],
+                                              values[g].data() + i * dimensions[g]);
+                    }
+                }
+            }
+
+            /**
+             * @brief Classify the points that are left now the whole image has arrived
+             *
+             * @param image the complete image
+             *
+             * @return the classified mesh, the same as classifying the whole frame at once
+             */
+            ClassifiedMesh<Scalar, N_NEIGHBOURS> finish(const void* image) {
+                if (ready.empty()) { return ClassifiedMesh<Scalar, N_NEIGHBOURS>(); }
+
+                push(image, lens.dimensions[1]);
+                ClassifiedMesh<Scalar, N_NEIGHBOURS> classified{std::move(projected.pixel_coordinates),
+                                                                std::move(projected.neighbourhood),
+                                                                std::move(projected.global_indices),
+                                                                std::move(values.back())};
+                assign_labels(engine.output_mode, dimensions.back(), classified);
+                return classified;
+            }
+
+        private:
+            /**
+             * @brief Works out how many rows of the image have to arrive before a point can be sampled
+             *
+             * @param y the row coordinate of the point
+             *
+             * @return the number of rows from the top of the image that the sampler reads from
+             */
+            int rows_needed(const Scalar& y) const {
+                const int height = lens.dimensions[1];
+                switch (format) {
+                    // The chroma plane comes after the whole luma plane
+                    case fourcc("NV12"): return height;
+                    // Demosaicing reads two rows past the point
+                    case fourcc("GRBG"):
+                    case fourcc("RGGB"):
+                    case fourcc("GBRG"):
+                    case fourcc("BGGR"): return std::min(std::max(int(std::floor(y)) + 3, 0), height);
+                    // Interpolation reads the row past the point
+                    default: return std::min(std::max(int(std::floor(y)) + 2, 0), height);
+                }
+            }
+
+            /// The engine that classifies the points
+            const Engine<Scalar>& engine;
+            /// The projected mesh being classified
+            ProjectedMesh<Scalar, N_NEIGHBOURS> projected;
+            /// The lens the image is coming from
+            Lens<Scalar> lens;
+            /// The pixel format of the image as a fourcc code
+            uint32_t format;
+
+            /// The number of rows that must have arrived for each point to be ready for each group, the image is 0
+            std::vector<std::vector<int>> ready;
+            /// The points of each group in the order they become ready
+            std::vector<std::vector<int>> order;
+            /// How far through the order of each group the stream has classified
+            std::vector<std::size_t> cursor;
+            /// The number of values for each point after each group
+            std::vector<unsigned int> dimensions;
+            /// The values of every point after each group
+            std::vector<std::vector<Scalar>> values;
+        };
+
+    }  // namespace cpu
+}  // namespace engine
+}  // namespace visualmesh
+
+#endif  // VISUALMESH_ENGINE_CPU_ROW_STREAM_HPP
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2017-2020 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef VISUALMESH_ENGINE_CPU_SPARSE_WEIGHTS_HPP
+#define VISUALMESH_ENGINE_CPU_SPARSE_WEIGHTS_HPP
+
+#include <vector>
+
+#include "visualmesh/network_structure.hpp"
+
+namespace visualmesh {
+namespace engine {
+    namespace cpu {
+
+        /**
+         * @brief The non zero weights of a layer stored as compressed rows, one row for each output.
+         *
+         * @details
+         *  Pruned networks have their zero weights scattered through the matrix rather than in whole blocks, so each
+         *  non zero weight is kept with the index of the input it multiplies.
+         */
+        template <typename Scalar>
+        struct SparseWeights {
+            /// Where the weights of each output start in indices and values, with an extra entry for the end
+            std::vector<unsigned int> offsets;
+            /// The input that each non zero weight multiplies
+            std::vector<unsigned int> indices;
+            /// The non zero weights
+            std::vector<Scalar> values;
+        };
+
+        /**
+         * @brief Finds the fraction of weights that are not zero
+         *
+         * @param weights the weights of a layer
+         *
+         * @return the fraction of the weights that are not zero, 1 for an empty layer
+         */
+        template <typename Scalar>
+        Scalar weight_density(const Weights<Scalar>& weights) {
+            unsigned int total    = 0;
+            unsigned int non_zero = 0;
+            for (const auto& row : weights) {
+                for (const auto& w : row) {
+                    non_zero += w != Scalar(0) ? 1 : 0;
+                }
+                total += row.size();
+            }
+            return total == 0 ? Scalar(1) : Scalar(non_zero) / Scalar(total);
+        }
+
+        /**
+         * @brief Compresses a weights matrix down to its non zero weights
+         *
+         * @param weights the weights of a layer stored as weights[output][input]
+         *
+         * @return the non zero weights of each output
+         */
+        template <typename Scalar>
+        SparseWeights<Scalar> make_sparse(const Weights<Scalar>& weights) {
+            SparseWeights<Scalar> sparse;
+            sparse.offsets.reserve(weights.size() + 1);
+            sparse.offsets.push_back(0);
+            for (const auto& row : weights) {
+                for (unsigned int i = 0; i < row.size(); ++i) {
+                    if (row[i] != Scalar(0)) {
+                        sparse.indices.push_back(i);
+                        sparse.values.push_back(row[i]);
+                    }
+                }
+                sparse.offsets.push_back(sparse.indices.size());
+            }
+            return sparse;
+        }
+
+        /**
+         * @brief Applies the weights and biases of a layer to a single point skipping all of the zero weights. The
+         * terms are summed in the same order as a dense product so the result only differs if an input is not finite.
+         *
+         * @param weights the non zero weights of the layer
+         * @param biases  the biases of the layer
+         * @param input   the values of the point
+         * @param output  where to write the value of each output
+         */
+        template <typename Scalar>
+        inline void sparse_multiply(const SparseWeights<Scalar>& weights,
+                                    const Biases<Scalar>& biases,
+                                    const Scalar* input,
+                                    Scalar* output) {
+            const unsigned int* index = weights.indices.data();
+            const Scalar* value       = weights.values.data();
+            for (unsigned int j = 0; j + 1 < weights.offsets.size(); ++j) {
+                const unsigned int* end = weights.indices.data() + weights.offsets[j + 1];
+
+                Scalar sum = biases[j];
+                for (; index != end; ++index, ++value) {
+                    sum += input[*index] * *value;
+                }
+                output[j] = sum;
+            }
+        }
+
+    }  // namespace cpu
+}  // namespace engine
+}  // namespace visualmesh
+
+#endif  // VISUALMESH_ENGINE_CPU_SPARSE_WEIGHTS_HPP
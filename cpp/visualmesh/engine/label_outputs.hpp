@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2017-2020 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef VISUALMESH_ENGINE_LABEL_OUTPUTS_HPP
+#define VISUALMESH_ENGINE_LABEL_OUTPUTS_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "visualmesh/classified_mesh.hpp"
+#include "visualmesh/output_mode.hpp"
+
+namespace visualmesh {
+namespace engine {
+
+    /**
+     * @brief Works out the label of a single point and, if it is wanted, how confident the network is in it
+     *
+     * @details
+     *  The label is the first class with the largest value. When the values are the logits from before a softmax the
+     *  label is the same as it would be after one, so the exponentials are only needed when the confidence is wanted.
+     *  Otherwise the largest value is taken to already be a probability.
+     *
+     * @tparam Scalar the scalar type used for calculations and storage (normally one of float or double)
+     *
+     * @param values     the output values of the point
+     * @param dimensions the number of values in the point
+     * @param logits     if the values are logits that a softmax has not been applied to
+     * @param label      where to write the label of the point
+     * @param confidence where to write the confidence of the point, or nullptr if it is not wanted
+     */
+    template <typename Scalar>
+    inline void label_point(const Scalar* values,
+                            const unsigned int& dimensions,
+                            const bool& logits,
+                            uint8_t& label,
+                            uint8_t* confidence) {
+        const Scalar* largest = std::max_element(values, values + dimensions);
+        label                 = uint8_t(largest - values);
+        if (confidence == nullptr) { return; }
+
+        Scalar p = *largest;
+        if (logits) {
+            Scalar total = Scalar(0.0);
+            for (unsigned int i = 0; i < dimensions; ++i) {
+                total += std::exp(values[i] - *largest);
+            }
+            p = Scalar(1.0) / total;
+        }
+        *confidence = uint8_t(std::round(std::min(std::max(p, Scalar(0.0)), Scalar(1.0)) * Scalar(255.0)));
+    }
+
+    /**
+     * @brief Labels every point of a network output
+     *
+     * @tparam Scalar the scalar type used for calculations and storage (normally one of float or double)
+     *
+     * @param mode       whether the confidence of each label is wanted as well
+     * @param values     the output of the network, dimensions values for each point
+     * @param dimensions the number of values for each point
+     * @param labels     filled with the label of each point
+     * @param confidence filled with the confidence of each point, or left empty if it is not wanted
+     */
+    template <typename Scalar>
+    void label_outputs(const OutputMode& mode,
+                       const std::vector<Scalar>& values,
+                       const unsigned int& dimensions,
+                       std::vector<uint8_t>& labels,
+                       std::vector<uint8_t>& confidence) {
+        const unsigned int n_points = dimensions == 0 ? 0 : values.size() / dimensions;
+        labels.resize(n_points);
+        confidence.resize(mode == OutputMode::LABELS_AND_CONFIDENCE ? n_points : 0);
+        for (unsigned int i = 0; i < n_points; ++i) {
+            label_point(values.data() + i * dimensions,
+                        dimensions,
+                        false,
+                        labels[i],
+                        confidence.empty() ? nullptr : &confidence[i]);
+        }
+    }
+
+    /**
+     * @brief Replaces the classifications of a classified mesh with their labels when the mode asks for them
+     *
+     * @tparam Scalar       the scalar type used for calculations and storage (normally one of float or double)
+     * @tparam N_NEIGHBOURS the number of neighbours that each point has
+     *
+     * @param mode       the output mode of the engine, nothing changes for CLASSIFICATIONS
+     * @param dimensions the number of values for each point in the classifications
+     * @param classified the classified mesh to label
+     */
+    template <typename Scalar, int N_NEIGHBOURS>
+    void assign_labels(const OutputMode& mode,
+                       const unsigned int& dimensions,
+                       ClassifiedMesh<Scalar, N_NEIGHBOURS>& classified) {
+        if (mode == OutputMode::CLASSIFICATIONS) { return; }
+        label_outputs(mode, classified.classifications, dimensions, classified.labels, classified.confidence);
+        classified.classifications = std::vector<Scalar>();
+    }
+
+}  // namespace engine
+}  // namespace visualmesh
+
+#endif  // VISUALMESH_ENGINE_LABEL_OUTPUTS_HPP
@@ -22,10 +22,19 @@
 #if !defined(VISUALMESH_DISABLE_OPENCL)
 
 #include <iomanip>
+#include <memory>
 #include <numeric>
 #include <sstream>
+#include <string>
 #include <tuple>
-
+#include <utility>
+#include <vector>
+
+#include "visualmesh/activation_storage.hpp"
+#include "visualmesh/engine/branching.hpp"
+#include "visualmesh/engine/cpu/project_mesh.hpp"
+#include "visualmesh/engine/label_outputs.hpp"
+#include "visualmesh/engine/opencl/kernels/label_outputs.cl.hpp"
 #include "visualmesh/engine/opencl/kernels/load_image.cl.hpp"
 #include "visualmesh/engine/opencl/kernels/project_equidistant.cl.hpp"
 #include "visualmesh/engine/opencl/kernels/project_equisolid.cl.hpp"
@@ -36,9 +45,14 @@
 #include "visualmesh/engine/opencl/operation/opencl_error_category.hpp"
 #include "visualmesh/engine/opencl/operation/scalar_defines.hpp"
 #include "visualmesh/engine/opencl/operation/wrapper.hpp"
+#include "visualmesh/engine/projection_cache.hpp"
+#include "visualmesh/frame.hpp"
 #include "visualmesh/mesh.hpp"
 #include "visualmesh/network_structure.hpp"
+#include "visualmesh/optimise_network.hpp"
+#include "visualmesh/output_mode.hpp"
 #include "visualmesh/projected_mesh.hpp"
+#include "visualmesh/region_of_interest.hpp"
 #include "visualmesh/utility/math.hpp"
 #include "visualmesh/utility/projection.hpp"
 #include "visualmesh/visualmesh.hpp"
@@ -63,9 +77,58 @@ namespace engine {
             /**
              * @brief Construct a new OpenCL Engine object
              *
-             * @param structure the network structure to use classification
+             * @param structure the network structure to use classification, simplified with optimise
+             * @param storage   how to store activations between convolutional groups, 16 bit storage halves the memory
+             *                  traffic of the gather while the arithmetic stays at Scalar precision
+             */
+            Engine(const NetworkStructure<Scalar>& structure = {},
+                   const ActivationStorage& storage          = ActivationStorage::FULL)
+              : Engine(std::vector<NetworkStructure<Scalar>>{structure}, storage) {}
+
+            /**
+             * @brief Construct a new OpenCL Engine object that runs several networks over the same projection and image
+             *
+             * @param structures the network structures to use for classification, each simplified with optimise. The
+             *                   first is the one used when classifying a mesh directly
+             * @param storage    how to store activations between convolutional groups
              */
-            Engine(const NetworkStructure<Scalar>& structure = {}) : max_width(4) {
+            Engine(const std::vector<NetworkStructure<Scalar>>& structures,
+                   const ActivationStorage& storage = ActivationStorage::FULL)
+              : Engine(structures, storage, {}) {}
+
+            /**
+             * @brief Construct a new OpenCL Engine object that runs a branching network, running its trunk once and
+             * then each of its heads
+             *
+             * @param network the branching network to use for classification, each part simplified with optimise
+             * @param storage how to store activations between convolutional groups
+             */
+            Engine(const BranchingNetwork<Scalar>& network, const ActivationStorage& storage = ActivationStorage::FULL)
+              : Engine(trunk_and_heads(network), storage, head_names_of(network)) {}
+
+        private:
+            /**
+             * @brief Construct a new OpenCL Engine object from a list of networks
+             *
+             * @param structures the network structures to use for classification, each simplified with optimise
+             * @param storage    how to store activations between convolutional groups
+             * @param heads      the names of the heads if the first network is the trunk of a branching network and
+             *                   the rest are its heads, otherwise empty
+             */
+            Engine(const std::vector<NetworkStructure<Scalar>>& structures,
+                   const ActivationStorage& storage,
+                   const std::vector<std::string>& heads)
+              : head_names(heads), max_width(4) {
+
+                // Simplify the networks before generating the kernels for them
+                std::vector<NetworkStructure<Scalar>> networks;
+                for (const auto& structure : structures) {
+                    networks.push_back(optimise(structure));
+                }
+
+                // The heads of a branching network start from the output of the trunk rather than the image
+                const unsigned int trunk_dimensions =
+                  networks.front().empty() ? 4 : networks.front().back().back().biases.size();
 
                 // Create the OpenCL context and command queue
                 cl_int error = CL_SUCCESS;
@@ -80,7 +143,12 @@ namespace engine {
                 sources << PROJECT_EQUISOLID_CL;
                 sources << PROJECT_RECTILINEAR_CL;
                 sources << LOAD_IMAGE_CL;
-                sources << operation::make_network(structure);
+                sources << LABEL_OUTPUTS_CL;
+                for (unsigned int n = 0; n < networks.size(); ++n) {
+                    const unsigned int dimensions = n > 0 && !head_names.empty() ? trunk_dimensions : 4;
+                    sources << operation::make_network(
+                      networks[n], storage, "net" + std::to_string(n) + "_", dimensions);
+                }
 
                 std::string source = sources.str();
                 const char* cstr   = source.c_str();
@@ -120,21 +188,28 @@ namespace engine {
                 throw_cl_error(error, "Error getting project_equisolid kernel");
                 load_image = cl::kernel(::clCreateKernel(program, "load_image", &error), ::clReleaseKernel);
                 throw_cl_error(error, "Failed to create kernel load_image");
+                label_outputs = cl::kernel(::clCreateKernel(program, "label_outputs", &error), ::clReleaseKernel);
+                throw_cl_error(error, "Failed to create kernel label_outputs");
 
                 // Grab all the kernels that were generated
-                for (unsigned int i = 0; i < structure.size(); ++i) {
-                    std::string kernel       = "conv" + std::to_string(i);
-                    unsigned int output_size = structure[i].back().biases.size();
-
-                    cl::kernel k(::clCreateKernel(program, kernel.c_str(), &error), ::clReleaseKernel);
-                    throw_cl_error(error, "Failed to create kernel " + kernel);
-                    conv_layers.emplace_back(k, output_size);
+                for (unsigned int n = 0; n < networks.size(); ++n) {
+                    conv_layers.emplace_back();
+                    for (unsigned int i = 0; i < networks[n].size(); ++i) {
+                        std::string kernel       = "net" + std::to_string(n) + "_conv" + std::to_string(i);
+                        unsigned int output_size = networks[n][i].back().biases.size();
+
+                        cl::kernel k(::clCreateKernel(program, kernel.c_str(), &error), ::clReleaseKernel);
+                        throw_cl_error(error, "Failed to create kernel " + kernel);
+                        conv_layers.back().emplace_back(k, output_size);
+                    }
                 }
 
                 // Work out what the widest network layer is
                 max_width = 4;
-                for (const auto& k : conv_layers) {
-                    max_width = std::max(max_width, k.second);
+                for (const auto& network : conv_layers) {
+                    for (const auto& k : network) {
+                        max_width = std::max(max_width, k.second);
+                    }
                 }
 
                 // Function to get the preferred workgroup size for a kernel
@@ -151,11 +226,15 @@ namespace engine {
                 workgroup_size = std::max(workgroup_size, workgroup_size_for_kernel(project_equisolid));
                 workgroup_size = std::max(workgroup_size, workgroup_size_for_kernel(project_equidistant));
                 workgroup_size = std::max(workgroup_size, workgroup_size_for_kernel(load_image));
-                for (const auto& k : conv_layers) {
-                    workgroup_size = std::max(workgroup_size, workgroup_size_for_kernel(k.first));
+                workgroup_size = std::max(workgroup_size, workgroup_size_for_kernel(label_outputs));
+                for (const auto& network : conv_layers) {
+                    for (const auto& k : network) {
+                        workgroup_size = std::max(workgroup_size, workgroup_size_for_kernel(k.first));
+                    }
                 }
             }
 
+        public:
             /**
              * @brief Projects a provided mesh to pixel coordinates
              *
@@ -173,6 +252,9 @@ namespace engine {
                                                                                  const Lens<Scalar>& lens) const {
                 static constexpr int N_NEIGHBOURS = Model<Scalar>::N_NEIGHBOURS;
 
+                // If the camera has barely moved since we last projected this mesh reuse that projection
+                if (auto cached = projection_cache.template find<N_NEIGHBOURS>(mesh, Hoc, lens)) { return *cached; }
+
                 // Perform the projection
                 std::vector<std::array<int, N_NEIGHBOURS>> neighbourhood;
                 std::vector<int> indices;
@@ -197,8 +279,10 @@ namespace engine {
                                                      nullptr);
                 throw_cl_error(error, "Failed reading projected pixels from the device");
 
-                return ProjectedMesh<Scalar, N_NEIGHBOURS>{
+                ProjectedMesh<Scalar, N_NEIGHBOURS> projected_mesh{
                   std::move(pixels), std::move(neighbourhood), std::move(indices)};
+                projection_cache.store(mesh, Hoc, lens, projected_mesh);
+                return projected_mesh;
             }
 
             /**
@@ -219,6 +303,50 @@ namespace engine {
                 return operator()(mesh.height(Hoc[2][3]), Hoc, lens);
             }
 
+            /**
+             * @brief Projects the part of a mesh inside a region of interest to pixel coordinates, along with the rings
+             * of neighbours around it that the network reads from when classifying the points in the region
+             *
+             * @tparam Model the mesh model that we are projecting
+             *
+             * @param mesh   the mesh table that we are projecting to pixel coordinates
+             * @param Hoc    the homogenous transformation matrix from the camera to the observation plane
+             * @param lens   the lens parameters that describe the optics of the camera
+             * @param region the part of the image to project
+             *
+             * @return a projected mesh for the provided arguments
+             */
+            template <template <typename> class Model>
+            inline ProjectedMesh<Scalar, Model<Scalar>::N_NEIGHBOURS> operator()(
+              const Mesh<Scalar, Model>& mesh,
+              const mat4<Scalar>& Hoc,
+              const Lens<Scalar>& lens,
+              const RegionOfInterest<Scalar>& region) const {
+                return cpu::project_region(mesh, Hoc, lens, region, receptive_field());
+            }
+
+            /**
+             * @brief Projects the part of a mesh inside a region of interest to pixel coordinates from an aggregate
+             * VisualMesh object
+             *
+             * @tparam Model the mesh model that we are projecting
+             *
+             * @param mesh   the mesh table that we are projecting to pixel coordinates
+             * @param Hoc    the homogenous transformation matrix from the camera to the observation plane
+             * @param lens   the lens parameters that describe the optics of the camera
+             * @param region the part of the image to project
+             *
+             * @return a projected mesh for the provided arguments
+             */
+            template <template <typename> class Model>
+            inline ProjectedMesh<Scalar, Model<Scalar>::N_NEIGHBOURS> operator()(
+              const VisualMesh<Scalar, Model>& mesh,
+              const mat4<Scalar>& Hoc,
+              const Lens<Scalar>& lens,
+              const RegionOfInterest<Scalar>& region) const {
+                return operator()(mesh.height(Hoc[2][3]), Hoc, lens, region);
+            }
+
             /**
              * @brief Project and classify a mesh using the neural network that is loaded into this engine
              *
@@ -238,6 +366,580 @@ namespace engine {
                                                                            const Lens<Scalar>& lens,
                                                                            const void* image,
                                                                            const uint32_t& format) const {
+                // Reuse the last projection of this mesh if the camera has barely moved
+                return classify_mesh(mesh,
+                                     Hoc,
+                                     lens,
+                                     image,
+                                     format,
+                                     projection_cache.template find<Model<Scalar>::N_NEIGHBOURS>(mesh, Hoc, lens));
+            }
+
+            /**
+             * @brief Project and classify a mesh using the neural network that is loaded into this engine.
+             * This version takes an aggregate VisualMesh object
+             *
+             * @tparam Model the mesh model that we are projecting
+             *
+             * @param mesh    the mesh table that we are projecting to pixel coordinates
+             * @param Hoc     the homogenous transformation matrix from the camera to the observation plane
+             * @param lens    the lens parameters that describe the optics of the camera
+             * @param image   the data that represents the image the network will run from
+             * @param format  the pixel format of this image as a fourcc code
+             *
+             * @return a classified mesh for the provided arguments
+             */
+            template <template <typename> class Model>
+            ClassifiedMesh<Scalar, Model<Scalar>::N_NEIGHBOURS> operator()(const VisualMesh<Scalar, Model>& mesh,
+                                                                           const mat4<Scalar>& Hoc,
+                                                                           const Lens<Scalar>& lens,
+                                                                           const void* image,
+                                                                           const uint32_t& format) const {
+                return operator()(mesh.height(Hoc[2][3]), Hoc, lens, image, format);
+            }
+
+            /**
+             * @brief Project and classify only the part of a mesh inside a region of interest
+             *
+             * @details
+             *  The points in the region are classified along with the rings of neighbours around them that the network
+             *  reads from, so the points in the region get the same classifications as they would from the whole
+             *  image. The rings are kept in the classified mesh, and can be told apart with
+             *  RegionOfInterest::contains(px, Hoc, lens), which checks the distance band as well as the rectangle.
+             *
+             * @tparam Model the mesh model that we are projecting
+             *
+             * @param mesh    the mesh table that we are projecting to pixel coordinates
+             * @param Hoc     the homogenous transformation matrix from the camera to the observation plane
+             * @param lens    the lens parameters that describe the optics of the camera
+             * @param image   the data that represents the image the network will run from
+             * @param format  the pixel format of this image as a fourcc code
+             * @param region  the part of the image to classify
+             *
+             * @return a classified mesh for the provided arguments
+             */
+            template <template <typename> class Model>
+            ClassifiedMesh<Scalar, Model<Scalar>::N_NEIGHBOURS> operator()(
+              const Mesh<Scalar, Model>& mesh,
+              const mat4<Scalar>& Hoc,
+              const Lens<Scalar>& lens,
+              const void* image,
+              const uint32_t& format,
+              const RegionOfInterest<Scalar>& region) const {
+                return classify_mesh(mesh,
+                                     Hoc,
+                                     lens,
+                                     image,
+                                     format,
+                                     std::make_shared<const ProjectedMesh<Scalar, Model<Scalar>::N_NEIGHBOURS>>(
+                                       operator()(mesh, Hoc, lens, region)));
+            }
+
+            /**
+             * @brief Project and classify only the part of a mesh inside a region of interest.
+             * This version takes an aggregate VisualMesh object
+             *
+             * @tparam Model the mesh model that we are projecting
+             *
+             * @param mesh    the mesh table that we are projecting to pixel coordinates
+             * @param Hoc     the homogenous transformation matrix from the camera to the observation plane
+             * @param lens    the lens parameters that describe the optics of the camera
+             * @param image   the data that represents the image the network will run from
+             * @param format  the pixel format of this image as a fourcc code
+             * @param region  the part of the image to classify
+             *
+             * @return a classified mesh for the provided arguments
+             */
+            template <template <typename> class Model>
+            ClassifiedMesh<Scalar, Model<Scalar>::N_NEIGHBOURS> operator()(
+              const VisualMesh<Scalar, Model>& mesh,
+              const mat4<Scalar>& Hoc,
+              const Lens<Scalar>& lens,
+              const void* image,
+              const uint32_t& format,
+              const RegionOfInterest<Scalar>& region) const {
+                return operator()(mesh.height(Hoc[2][3]), Hoc, lens, image, format, region);
+            }
+
+            /**
+             * @brief Classify a projected mesh with every network that is loaded into this engine
+             *
+             * @details
+             *  The image and the projection are uploaded and the image is sampled once into its own device buffer.
+             *  Each network then starts from a copy of those samples in the shared ping pong buffers, so running
+             *  several networks on the same camera frame only uploads and samples it once. An engine running a
+             *  branching network gives a single classified mesh holding the output of each head.
+             *
+             * @tparam N_NEIGHBOURS the number of neighbours that each point has
+             *
+             * @param projected the projected mesh to classify, as made by projecting a mesh with this engine
+             * @param lens      the lens parameters that describe the optics of the camera
+             * @param image     the data that represents the image the networks will run from
+             * @param format    the pixel format of this image as a fourcc code
+             *
+             * @return a classified mesh for each of the networks in the order they were given
+             */
+            template <int N_NEIGHBOURS>
+            std::vector<ClassifiedMesh<Scalar, N_NEIGHBOURS>> operator()(
+              const ProjectedMesh<Scalar, N_NEIGHBOURS>& projected,
+              const Lens<Scalar>& lens,
+              const void* image,
+              const uint32_t& format) const {
+                cl_int error = CL_SUCCESS;
+                cl_event ev  = nullptr;
+
+                // If there were no points, nothing to classify
+                if (projected.global_indices.empty()) {
+                    return std::vector<ClassifiedMesh<Scalar, N_NEIGHBOURS>>(conv_layers.size());
+                }
+
+                // This includes the offscreen point at the end
+                const int n_points = projected.neighbourhood.size();
+
+                // Map our image into device memory
+                cl::mem cl_image             = get_image_memory(lens.dimensions, format);
+                std::array<size_t, 3> origin = {{0, 0, 0}};
+                std::array<size_t, 3> region = {{size_t(lens.dimensions[0]), size_t(lens.dimensions[1]), 1}};
+                cl::event cl_image_loaded;
+                ev    = nullptr;
+                error = clEnqueueWriteImage(
+                  queue, cl_image, false, origin.data(), region.data(), 0, 0, image, 0, nullptr, &ev);
+                if (ev) cl_image_loaded = cl::event(ev, ::clReleaseEvent);
+                throw_cl_error(error, "Error mapping image onto device");
+
+                // Upload the pixels and the graph of the projection
+                cl::mem cl_pixels = get_pixel_coordinates_memory(n_points);
+                cl::event cl_pixels_loaded;
+                ev    = nullptr;
+                error = ::clEnqueueWriteBuffer(queue,
+                                               cl_pixels,
+                                               false,
+                                               0,
+                                               projected.pixel_coordinates.size() * sizeof(std::array<Scalar, 2>),
+                                               projected.pixel_coordinates.data(),
+                                               0,
+                                               nullptr,
+                                               &ev);
+                if (ev) cl_pixels_loaded = cl::event(ev, ::clReleaseEvent);
+                throw_cl_error(error, "Error writing pixel coordinates to the device");
+
+                cl::mem cl_neighbourhood = get_neighbourhood_memory(n_points, N_NEIGHBOURS);
+                cl::event cl_neighbourhood_loaded;
+                ev    = nullptr;
+                error = ::clEnqueueWriteBuffer(queue,
+                                               cl_neighbourhood,
+                                               false,
+                                               0,
+                                               n_points * sizeof(std::array<int, N_NEIGHBOURS>),
+                                               projected.neighbourhood.data(),
+                                               0,
+                                               nullptr,
+                                               &ev);
+                if (ev) cl_neighbourhood_loaded = cl::event(ev, ::clReleaseEvent);
+                throw_cl_error(error, "Error writing neighbourhood points to the device");
+
+                // Sample the image into a buffer that the networks leave alone, while the trunk of a branching network
+                // is only run once so it can sample straight into the network input
+                auto cl_conv_buffers = get_network_memory(max_width * n_points);
+                cl::mem cl_sampled   = head_names.empty() ? get_shared_memory(n_points * 4) : cl_conv_buffers[0];
+                cl::event img_load_event;
+
+                cl_mem arg;
+                arg   = cl_image;
+                error = ::clSetKernelArg(load_image, 0, sizeof(arg), &arg);
+                throw_cl_error(error, "Error setting kernel argument 0 for image load kernel");
+                error = ::clSetKernelArg(load_image, 1, sizeof(format), &format);
+                throw_cl_error(error, "Error setting kernel argument 1 for image load kernel");
+                arg   = cl_pixels;
+                error = ::clSetKernelArg(load_image, 2, sizeof(arg), &arg);
+                throw_cl_error(error, "Error setting kernel argument 2 for image load kernel");
+                arg   = cl_sampled;
+                error = ::clSetKernelArg(load_image, 3, sizeof(arg), &arg);
+                throw_cl_error(error, "Error setting kernel argument 3 for image load kernel");
+
+                // When calculating global_size we round to the nearest workgroup size
+                size_t offset[1]       = {0};
+                size_t global_size[1]  = {(((n_points - 1) / workgroup_size) + 1) * workgroup_size};
+                cl_event event_list[2] = {cl_pixels_loaded, cl_image_loaded};
+                ev                     = nullptr;
+                error                  = ::clEnqueueNDRangeKernel(
+                  queue, load_image, 1, offset, global_size, &workgroup_size, 2, event_list, &ev);
+                if (ev) img_load_event = cl::event(ev, ::clReleaseEvent);
+                throw_cl_error(error, "Error queueing the image load kernel");
+
+                // The offscreen point gets a value of -1.0 to make it easy to distinguish
+                cl_event img_loaded = img_load_event;
+                cl::event offscreen_fill_event;
+                Scalar minus_one(-1.0);
+                ev    = nullptr;
+                error = ::clEnqueueFillBuffer(queue,
+                                              cl_sampled,
+                                              &minus_one,
+                                              sizeof(Scalar),
+                                              (n_points - 1) * sizeof(std::array<Scalar, 4>),
+                                              sizeof(std::array<Scalar, 4>),
+                                              1,
+                                              &img_loaded,
+                                              &ev);
+                if (ev) offscreen_fill_event = cl::event(ev, ::clReleaseEvent);
+                throw_cl_error(error, "Error setting the offscreen pixel values");
+
+                // Run each network from the samples, or the trunk of a branching network and then each of its heads
+                std::vector<cl::event> events({offscreen_fill_event, cl_neighbourhood_loaded});
+                std::vector<ClassifiedMesh<Scalar, N_NEIGHBOURS>> classified;
+                if (head_names.empty()) {
+                    auto outputs =
+                      run_networks(0, conv_layers.size(), cl_neighbourhood, cl_sampled, 4, n_points, events);
+                    for (auto& output : outputs) {
+                        classified.push_back(ClassifiedMesh<Scalar, N_NEIGHBOURS>{projected.pixel_coordinates,
+                                                                                  projected.neighbourhood,
+                                                                                  projected.global_indices,
+                                                                                  std::move(output.first)});
+                        assign_labels(output_mode, output.second, classified.back());
+                    }
+                }
+                else {
+                    const auto outputs =
+                      classify_heads(cl_neighbourhood, cl_sampled, cl_conv_buffers[1], n_points, events);
+                    classified.push_back(ClassifiedMesh<Scalar, N_NEIGHBOURS>{
+                      projected.pixel_coordinates, projected.neighbourhood, projected.global_indices, {}});
+                    assign_heads(head_names, outputs, 0, n_points, classified.back());
+                    assign_labels(output_mode, outputs.front().second, classified.back());
+                }
+
+                return classified;
+            }
+
+            void clear_cache() {
+                device_points_cache.clear();
+                indices_map_memory.memory         = nullptr;
+                indices_map_memory.n_points       = 0;
+                pixel_coordinates_memory.memory   = nullptr;
+                pixel_coordinates_memory.n_points = 0;
+                shared_memory.memory              = nullptr;
+                shared_memory.n_values            = 0;
+                label_memory.memory               = nullptr;
+                label_memory.n_values             = 0;
+                neighbourhood_memory.memory       = nullptr;
+                neighbourhood_memory.n_points     = 0;
+                network_memory.memory             = {nullptr, nullptr};
+                network_memory.n_points           = 0;
+                image_memory.memory               = nullptr;
+                image_memory.dimensions           = {0, 0};
+                image_memory.format               = 0;
+                projection_cache.clear();
+            }
+
+            /**
+             * @brief Project and classify several frames, running the network once over all of them
+             *
+             * @details
+             *  The projected points of every frame are joined into a single graph where each frame keeps its own
+             *  offscreen point. Each frame's image is sampled into its own range of the network input, and then every
+             *  layer of the network is launched once for the whole batch. The results are then split back out into one
+             *  classified mesh per frame in the order they were given.
+             *
+             * @tparam Model the mesh model that we are projecting
+             *
+             * @param frames the frames to classify
+             *
+             * @return a classified mesh for each of the frames
+             */
+            template <template <typename> class Model>
+            std::vector<ClassifiedMesh<Scalar, Model<Scalar>::N_NEIGHBOURS>> operator()(
+              const std::vector<Frame<Scalar, Model>>& frames) const {
+                static constexpr int N_NEIGHBOURS = Model<Scalar>::N_NEIGHBOURS;
+                cl_int error                      = CL_SUCCESS;
+                cl_event ev                       = nullptr;
+
+                // Project each frame and append it to the combined graph
+                std::vector<ProjectedMesh<Scalar, N_NEIGHBOURS>> projected;
+                projected.reserve(frames.size());
+                std::vector<int> offsets;
+                offsets.reserve(frames.size());
+                std::vector<std::array<int, N_NEIGHBOURS>> neighbourhood;
+                std::vector<std::array<Scalar, 2>> pixels;
+                for (const auto& frame : frames) {
+                    projected.push_back(operator()(*frame.mesh, frame.Hoc, frame.lens));
+                    offsets.push_back(neighbourhood.size());
+                    const auto& p = projected.back();
+                    if (p.global_indices.empty()) { continue; }
+
+                    // Shift this frame's graph to where its points start in the combined graph
+                    for (const auto& n : p.neighbourhood) {
+                        std::array<int, N_NEIGHBOURS> shifted;
+                        for (int j = 0; j < N_NEIGHBOURS; ++j) {
+                            shifted[j] = n[j] + offsets.back();
+                        }
+                        neighbourhood.push_back(shifted);
+                    }
+
+                    // The offscreen point has no pixel, but keeping a slot for it lines the pixels up with the points
+                    pixels.insert(pixels.end(), p.pixel_coordinates.begin(), p.pixel_coordinates.end());
+                    pixels.push_back({{Scalar(0.0), Scalar(0.0)}});
+                }
+
+                // This includes the offscreen point of every frame
+                const int n_points = neighbourhood.size();
+                if (n_points == 0) { return std::vector<ClassifiedMesh<Scalar, N_NEIGHBOURS>>(frames.size()); }
+
+                // Upload the pixels and the graph for the whole batch
+                cl::mem cl_pixels = get_pixel_coordinates_memory(n_points);
+                cl::event cl_pixels_loaded;
+                ev    = nullptr;
+                error = ::clEnqueueWriteBuffer(queue,
+                                               cl_pixels,
+                                               false,
+                                               0,
+                                               n_points * sizeof(std::array<Scalar, 2>),
+                                               pixels.data(),
+                                               0,
+                                               nullptr,
+                                               &ev);
+                if (ev) cl_pixels_loaded = cl::event(ev, ::clReleaseEvent);
+                throw_cl_error(error, "Error writing batch pixel coordinates to the device");
+
+                cl::mem cl_neighbourhood = get_neighbourhood_memory(n_points, N_NEIGHBOURS);
+                cl::event cl_neighbourhood_loaded;
+                ev    = nullptr;
+                error = ::clEnqueueWriteBuffer(queue,
+                                               cl_neighbourhood,
+                                               false,
+                                               0,
+                                               n_points * sizeof(std::array<int, N_NEIGHBOURS>),
+                                               neighbourhood.data(),
+                                               0,
+                                               nullptr,
+                                               &ev);
+                if (ev) cl_neighbourhood_loaded = cl::event(ev, ::clReleaseEvent);
+                throw_cl_error(error, "Error writing batch neighbourhood points to the device");
+
+                // Grab our ping pong buffers from the cache
+                auto cl_conv_buffers   = get_network_memory(max_width * n_points);
+                cl::mem cl_conv_input  = cl_conv_buffers[0];
+                cl::mem cl_conv_output = cl_conv_buffers[1];
+
+                // Sample each frame's image into its range of the network input
+                std::vector<cl::event> events({cl_neighbourhood_loaded});
+                cl::event img_load_event;
+                for (unsigned int i = 0; i < frames.size(); ++i) {
+                    const auto& frame = frames[i];
+                    const int n_frame = projected[i].global_indices.size();
+                    if (n_frame == 0) { continue; }
+
+                    // The frames share the cached image memory, so each upload waits until the last frame is sampled
+                    cl::mem cl_image             = get_image_memory(frame.lens.dimensions, frame.format);
+                    std::array<size_t, 3> origin = {{0, 0, 0}};
+                    std::array<size_t, 3> region = {
+                      {size_t(frame.lens.dimensions[0]), size_t(frame.lens.dimensions[1]), 1}};
+                    cl_event previous = img_load_event;
+                    cl::event cl_image_loaded;
+                    ev    = nullptr;
+                    error = clEnqueueWriteImage(queue,
+                                                cl_image,
+                                                false,
+                                                origin.data(),
+                                                region.data(),
+                                                0,
+                                                0,
+                                                frame.image,
+                                                previous ? 1 : 0,
+                                                previous ? &previous : nullptr,
+                                                &ev);
+                    if (ev) cl_image_loaded = cl::event(ev, ::clReleaseEvent);
+                    throw_cl_error(error, "Error mapping image onto device");
+
+                    cl_mem arg;
+                    arg   = cl_image;
+                    error = ::clSetKernelArg(load_image, 0, sizeof(arg), &arg);
+                    throw_cl_error(error, "Error setting kernel argument 0 for image load kernel");
+                    error = ::clSetKernelArg(load_image, 1, sizeof(frame.format), &frame.format);
+                    throw_cl_error(error, "Error setting kernel argument 1 for image load kernel");
+                    arg   = cl_pixels;
+                    error = ::clSetKernelArg(load_image, 2, sizeof(arg), &arg);
+                    throw_cl_error(error, "Error setting kernel argument 2 for image load kernel");
+                    arg   = cl_conv_input;
+                    error = ::clSetKernelArg(load_image, 3, sizeof(arg), &arg);
+                    throw_cl_error(error, "Error setting kernel argument 3 for image load kernel");
+
+                    // The kernel has no bounds check, so the range must be exact to leave the other frames alone
+                    size_t offset[1]       = {size_t(offsets[i])};
+                    size_t global_size[1]  = {size_t(n_frame)};
+                    cl_event event_list[2] = {cl_pixels_loaded, cl_image_loaded};
+                    ev                     = nullptr;
+                    error                  = ::clEnqueueNDRangeKernel(
+                      queue, load_image, 1, offset, global_size, nullptr, 2, event_list, &ev);
+                    if (ev) img_load_event = cl::event(ev, ::clReleaseEvent);
+                    throw_cl_error(error, "Error queueing the image load kernel");
+                    events.push_back(img_load_event);
+
+                    // The offscreen point gets a value of -1.0 to make it easy to distinguish
+                    cl::event offscreen_fill_event;
+                    Scalar minus_one(-1.0);
+                    ev    = nullptr;
+                    error = ::clEnqueueFillBuffer(queue,
+                                                  cl_conv_input,
+                                                  &minus_one,
+                                                  sizeof(Scalar),
+                                                  (offsets[i] + n_frame) * sizeof(std::array<Scalar, 4>),
+                                                  sizeof(std::array<Scalar, 4>),
+                                                  0,
+                                                  nullptr,
+                                                  &ev);
+                    if (ev) offscreen_fill_event = cl::event(ev, ::clReleaseEvent);
+                    throw_cl_error(error, "Error setting the offscreen pixel values");
+                    events.push_back(offscreen_fill_event);
+                }
+
+                // Run the network once over the whole batch and read the classifications off the device, for a
+                // branching network this runs the trunk once and then each of the heads
+                std::vector<Scalar> classifications;
+                std::vector<uint8_t> labels;
+                unsigned int dimensions = 0;
+                std::vector<std::pair<std::vector<Scalar>, unsigned int>> outputs;
+                if (head_names.empty()) {
+                    cl::event network_complete;
+                    std::tie(cl_conv_input, network_complete) = run_network(
+                      conv_layers.front(), cl_neighbourhood, cl_conv_input, cl_conv_output, n_points, events);
+
+                    dimensions = conv_layers.front().back().second;
+                    if (output_mode != OutputMode::CLASSIFICATIONS) {
+                        read_labels(cl_conv_input, dimensions, n_points, network_complete, true, labels);
+                    }
+                    else {
+                        classifications.resize(n_points * dimensions);
+                        cl_event iev = network_complete;
+                        error        = ::clEnqueueReadBuffer(queue,
+                                                      cl_conv_input,
+                                                      true,
+                                                      0,
+                                                      classifications.size() * sizeof(Scalar),
+                                                      classifications.data(),
+                                                      1,
+                                                      &iev,
+                                                      nullptr);
+                        throw_cl_error(error, "Error reading classified values");
+                    }
+                }
+                else {
+                    outputs = classify_heads(cl_neighbourhood, cl_conv_input, cl_conv_output, n_points, events);
+                }
+
+                // Split the classifications back up into their frames
+                std::vector<ClassifiedMesh<Scalar, N_NEIGHBOURS>> classified;
+                classified.reserve(frames.size());
+                for (unsigned int i = 0; i < projected.size(); ++i) {
+                    auto& p = projected[i];
+                    if (p.global_indices.empty()) {
+                        classified.emplace_back();
+                        continue;
+                    }
+                    const unsigned int first = offsets[i];
+                    const unsigned int last  = first + p.neighbourhood.size();
+                    classified.push_back(ClassifiedMesh<Scalar, N_NEIGHBOURS>{
+                      std::move(p.pixel_coordinates), std::move(p.neighbourhood), std::move(p.global_indices), {}});
+
+                    // The label modes only read the labels back, so there are no classifications to split
+                    if (head_names.empty() && output_mode == OutputMode::CLASSIFICATIONS) {
+                        classified.back().classifications.assign(
+                          std::next(classifications.begin(), first * dimensions),
+                          std::next(classifications.begin(), last * dimensions));
+                    }
+                    if (!head_names.empty()) {
+                        assign_heads(head_names, outputs, first, last, classified.back());
+                        assign_labels(output_mode, outputs.front().second, classified.back());
+                    }
+                    else if (!labels.empty()) {
+                        split_labels(labels, first, last, n_points, classified.back());
+                    }
+                }
+
+                return classified;
+            }
+
+            /**
+             * @brief Starts projecting a mesh on another thread for a camera pose that is expected in the future.
+             * The next projection or classification of this mesh uses this result if the actual pose is within the
+             * tolerance of the prediction, otherwise the projection is recomputed.
+             * The mesh must stay alive until the speculation has been used.
+             *
+             * @tparam Model the mesh model that we are projecting
+             *
+             * @param mesh      the mesh table that we are projecting to pixel coordinates
+             * @param Hoc       the predicted homogenous transformation matrix from the camera to the observation plane
+             * @param lens      the lens parameters that describe the optics of the camera
+             * @param tolerance the largest pixel displacement from the predicted pose for which the result is used
+             */
+            template <template <typename> class Model>
+            void speculate(const Mesh<Scalar, Model>& mesh,
+                           const mat4<Scalar>& Hoc,
+                           const Lens<Scalar>& lens,
+                           const Scalar& tolerance) const {
+                projection_cache.template speculate<Model<Scalar>::N_NEIGHBOURS>(
+                  mesh, Hoc, lens, tolerance, &cpu::project_mesh<Scalar, Model>);
+            }
+
+            /**
+             * @brief Starts projecting a mesh on another thread for a camera pose that is expected in the future.
+             * This version takes an aggregate VisualMesh object
+             *
+             * @tparam Model the mesh model that we are projecting
+             *
+             * @param mesh      the mesh table that we are projecting to pixel coordinates
+             * @param Hoc       the predicted homogenous transformation matrix from the camera to the observation plane
+             * @param lens      the lens parameters that describe the optics of the camera
+             * @param tolerance the largest pixel displacement from the predicted pose for which the result is used
+             */
+            template <template <typename> class Model>
+            void speculate(const VisualMesh<Scalar, Model>& mesh,
+                           const mat4<Scalar>& Hoc,
+                           const Lens<Scalar>& lens,
+                           const Scalar& tolerance) const {
+                speculate(mesh.height(Hoc[2][3]), Hoc, lens, tolerance);
+            }
+
+            /**
+             * @brief Reuse the previous projection of a mesh while the camera moves less than a number of pixels
+             *
+             * @param tolerance the largest pixel displacement for which a projection is reused, 0 disables reuse
+             */
+            void set_projection_tolerance(const Scalar& tolerance) {
+                projection_cache.set_tolerance(tolerance);
+            }
+
+            /**
+             * @brief Choose what is given back for each point. In the label modes the output of the network is
+             * reduced to labels on the device so only a byte or two for each point is read back.
+             *
+             * @param mode the output mode to use, CLASSIFICATIONS gives the full output of the network
+             */
+            void set_output_mode(const OutputMode& mode) {
+                output_mode = mode;
+            }
+
+        private:
+            /**
+             * @brief Classify a mesh using the neural network that is loaded into this engine
+             *
+             * @tparam Model the mesh model that we are projecting
+             *
+             * @param mesh        the mesh table that we are projecting to pixel coordinates
+             * @param Hoc         the homogenous transformation matrix from the camera to the observation plane
+             * @param lens        the lens parameters that describe the optics of the camera
+             * @param image       the data that represents the image the network will run from
+             * @param format      the pixel format of this image as a fourcc code
+             * @param projection  an existing projection of the mesh to use, or null to project it on the device
+             *
+             * @return a classified mesh for the provided arguments
+             */
+            template <template <typename> class Model>
+            ClassifiedMesh<Scalar, Model<Scalar>::N_NEIGHBOURS> classify_mesh(
+              const Mesh<Scalar, Model>& mesh,
+              const mat4<Scalar>& Hoc,
+              const Lens<Scalar>& lens,
+              const void* image,
+              const uint32_t& format,
+              const std::shared_ptr<const ProjectedMesh<Scalar, Model<Scalar>::N_NEIGHBOURS>>& projection) const {
                 static constexpr int N_NEIGHBOURS = Model<Scalar>::N_NEIGHBOURS;
                 cl_int error                      = CL_SUCCESS;
 
@@ -255,12 +957,13 @@ namespace engine {
                 if (ev) cl_image_loaded = cl::event(ev, ::clReleaseEvent);
                 throw_cl_error(error, "Error mapping image onto device");
 
-                // Project our visual mesh
+                // Project our visual mesh, or use the projection we were given
                 std::vector<std::array<int, N_NEIGHBOURS>> neighbourhood;
                 std::vector<int> indices;
                 cl::mem cl_pixels;
                 cl::event cl_pixels_loaded;
-                std::tie(neighbourhood, indices, cl_pixels, cl_pixels_loaded) = do_project(mesh, Hoc, lens);
+                std::tie(neighbourhood, indices, cl_pixels, cl_pixels_loaded) =
+                  projection ? upload_projection(*projection) : do_project(mesh, Hoc, lens);
 
                 // If there were no points, nothing to project
                 if (indices.empty()) { return ClassifiedMesh<Scalar, N_NEIGHBOURS>(); }
@@ -293,7 +996,6 @@ namespace engine {
 
                 // Read the pixels into the buffer
                 cl::event img_load_event;
-                cl::event network_complete;
 
                 cl_mem arg;
                 arg   = cl_image;
@@ -339,7 +1041,221 @@ namespace engine {
                 // These events are required for our first convolution
                 std::vector<cl::event> events({img_load_event, offscreen_fill_event, cl_neighbourhood_loaded});
 
-                for (auto& conv : conv_layers) {
+                // A branching network runs its trunk and then each head, reading back their outputs as it goes
+                std::vector<std::pair<std::vector<Scalar>, unsigned int>> outputs;
+                cl::event network_complete;
+                if (head_names.empty()) {
+                    std::tie(cl_conv_input, network_complete) = run_network(
+                      conv_layers.front(), cl_neighbourhood, cl_conv_input, cl_conv_output, n_points, events);
+                }
+                else {
+                    outputs = classify_heads(cl_neighbourhood, cl_conv_input, cl_conv_output, n_points, events);
+                }
+
+                // Read the pixel coordinates off the device
+                cl::event pixels_read;
+                ev = nullptr;
+                std::vector<std::array<Scalar, 2>> pixels(neighbourhood.size() - 1);
+                cl_event iev = cl_pixels_loaded;
+                error        = ::clEnqueueReadBuffer(queue,
+                                              cl_pixels,
+                                              false,
+                                              0,
+                                              pixels.size() * sizeof(std::array<Scalar, 2>),
+                                              pixels.data(),
+                                              1,
+                                              &iev,
+                                              &ev);
+                if (ev) pixels_read = cl::event(ev, ::clReleaseEvent);
+                throw_cl_error(error, "Error reading projected pixels");
+
+                // Read the classifications off the device (they'll be in input), or only their labels
+                cl::event classes_read;
+                std::vector<Scalar> classifications;
+                std::vector<uint8_t> labels;
+                if (head_names.empty() && output_mode != OutputMode::CLASSIFICATIONS) {
+                    classes_read = read_labels(
+                      cl_conv_input, conv_layers.front().back().second, n_points, network_complete, false, labels);
+                }
+                else if (head_names.empty()) {
+                    ev  = nullptr;
+                    iev = network_complete;
+                    classifications.resize(neighbourhood.size() * conv_layers.front().back().second);
+                    error = ::clEnqueueReadBuffer(queue,
+                                                  cl_conv_input,
+                                                  false,
+                                                  0,
+                                                  classifications.size() * sizeof(Scalar),
+                                                  classifications.data(),
+                                                  1,
+                                                  &iev,
+                                                  &ev);
+                    if (ev) classes_read = cl::event(ev, ::clReleaseEvent);
+                    throw_cl_error(error, "Error reading classified values");
+                }
+
+                // Flush the queue to ensure all the commands have been issued
+                ::clFlush(queue);
+
+                // Wait for the chain to finish up to where we care about it
+                std::vector<cl_event> end_events({pixels_read});
+                if (classes_read) { end_events.push_back(classes_read); }
+                ::clWaitForEvents(end_events.size(), end_events.data());
+
+                // Remember this projection so it can be reused while the camera is still
+                if (!projection && projection_cache.enabled()) {
+                    projection_cache.store(
+                      mesh, Hoc, lens, ProjectedMesh<Scalar, N_NEIGHBOURS>{pixels, neighbourhood, indices});
+                }
+
+                ClassifiedMesh<Scalar, N_NEIGHBOURS> classified{
+                  std::move(pixels), std::move(neighbourhood), std::move(indices), std::move(classifications)};
+                if (!head_names.empty()) {
+                    assign_heads(head_names, outputs, 0, classified.neighbourhood.size(), classified);
+                    assign_labels(output_mode, outputs.front().second, classified);
+                }
+                else if (output_mode != OutputMode::CLASSIFICATIONS) {
+                    split_labels(labels, 0, n_points, n_points, classified);
+                }
+                return classified;
+            }
+
+            /**
+             * @brief The number of rings of neighbours the loaded network reads from to classify a single point
+             *
+             * @return the number of graph convolutions between the input and the deepest output
+             */
+            int receptive_field() const {
+                // Independent networks each read their own neighbourhood, so the deepest of them is the furthest read
+                if (head_names.empty()) {
+                    int depth = 0;
+                    for (const auto& network : conv_layers) {
+                        depth = std::max(depth, int(network.size()));
+                    }
+                    return depth;
+                }
+
+                // The heads of a branching network all continue from the output of the trunk
+                int heads = 0;
+                for (std::size_t i = 1; i < conv_layers.size(); ++i) {
+                    heads = std::max(heads, int(conv_layers[i].size()));
+                }
+                return int(conv_layers.front().size()) + heads;
+            }
+
+            /**
+             * @brief Enqueues the kernel that labels the output of a network and reads the labels off the device
+             *
+             * @param cl_values  the buffer holding the output of the network
+             * @param dimensions the number of values for each point in the output
+             * @param n_points   the number of points being classified, including any offscreen points
+             * @param complete   the event that completes once the output of the network is ready
+             * @param blocking   if this should wait for the labels to be read
+             * @param labels     filled with the label of each point, followed by the confidence of each point if the
+             *                   output mode asks for it
+             *
+             * @return the event that completes once the labels have been read
+             */
+            cl::event read_labels(const cl::mem& cl_values,
+                                  const cl_int& dimensions,
+                                  const cl_int& n_points,
+                                  const cl::event& complete,
+                                  const bool& blocking,
+                                  std::vector<uint8_t>& labels) const {
+                const cl_int confidence = output_mode == OutputMode::LABELS_AND_CONFIDENCE ? 1 : 0;
+                labels.resize(n_points * (confidence + 1));
+                cl::mem cl_labels = get_label_memory(labels.size());
+
+                cl_mem arg;
+                arg          = cl_values;
+                cl_int error = ::clSetKernelArg(label_outputs, 0, sizeof(arg), &arg);
+                throw_cl_error(error, "Error setting kernel argument 0 for label kernel");
+                error = ::clSetKernelArg(label_outputs, 1, sizeof(dimensions), &dimensions);
+                throw_cl_error(error, "Error setting kernel argument 1 for label kernel");
+                error = ::clSetKernelArg(label_outputs, 2, sizeof(n_points), &n_points);
+                throw_cl_error(error, "Error setting kernel argument 2 for label kernel");
+                error = ::clSetKernelArg(label_outputs, 3, sizeof(confidence), &confidence);
+                throw_cl_error(error, "Error setting kernel argument 3 for label kernel");
+                arg   = cl_labels;
+                error = ::clSetKernelArg(label_outputs, 4, sizeof(arg), &arg);
+                throw_cl_error(error, "Error setting kernel argument 4 for label kernel");
+
+                // When calculating global_size we round to the nearest workgroup size
+                size_t offset[1]      = {0};
+                size_t global_size[1] = {(((n_points - 1) / workgroup_size) + 1) * workgroup_size};
+                cl_event iev          = complete;
+                cl_event ev           = nullptr;
+                cl::event labelled;
+                error = ::clEnqueueNDRangeKernel(queue,
+                                                 label_outputs,
+                                                 1,
+                                                 offset,
+                                                 global_size,
+                                                 &workgroup_size,
+                                                 iev ? 1 : 0,
+                                                 iev ? &iev : nullptr,
+                                                 &ev);
+                if (ev) labelled = cl::event(ev, ::clReleaseEvent);
+                throw_cl_error(error, "Error queueing the label kernel");
+
+                cl::event labels_read;
+                iev   = labelled;
+                ev    = nullptr;
+                error = ::clEnqueueReadBuffer(
+                  queue, cl_labels, blocking, 0, labels.size(), labels.data(), 1, &iev, blocking ? nullptr : &ev);
+                if (ev) labels_read = cl::event(ev, ::clReleaseEvent);
+                throw_cl_error(error, "Error reading labels");
+
+                return labels_read;
+            }
+
+            /**
+             * @brief Copies the labels for a range of points that were read by read_labels into a classified mesh
+             *
+             * @tparam N_NEIGHBOURS the number of neighbours that each point has
+             *
+             * @param labels     the labels of every point, followed by their confidences if they were read
+             * @param first      the first point to copy
+             * @param last       one past the last point to copy
+             * @param n_points   the number of points that were labelled
+             * @param classified the classified mesh to fill in
+             */
+            template <int N_NEIGHBOURS>
+            void split_labels(const std::vector<uint8_t>& labels,
+                              const unsigned int& first,
+                              const unsigned int& last,
+                              const unsigned int& n_points,
+                              ClassifiedMesh<Scalar, N_NEIGHBOURS>& classified) const {
+                classified.labels.assign(std::next(labels.begin(), first), std::next(labels.begin(), last));
+                if (labels.size() > n_points) {
+                    classified.confidence.assign(std::next(labels.begin(), n_points + first),
+                                                 std::next(labels.begin(), n_points + last));
+                }
+            }
+
+            /**
+             * @brief Enqueues each of the network's convolution kernels over the points in the input buffer
+             *
+             * @param network          the convolution kernels of the network to run and the width of their outputs
+             * @param cl_neighbourhood the graph of the points being classified, including any offscreen points
+             * @param cl_conv_input    the buffer holding the input values for each point
+             * @param cl_conv_output   a buffer of the same size used to ping pong between layers
+             * @param n_points         the number of points being classified, including any offscreen points
+             * @param events           the events that must complete before the first layer can run
+             *
+             * @return the buffer that will hold the output of the network and the event that completes once it does
+             */
+            std::pair<cl::mem, cl::event> run_network(const std::vector<std::pair<cl::kernel, size_t>>& network,
+                                                      const cl::mem& cl_neighbourhood,
+                                                      cl::mem cl_conv_input,
+                                                      cl::mem cl_conv_output,
+                                                      const int& n_points,
+                                                      std::vector<cl::event> events) const {
+                cl_int error = CL_SUCCESS;
+                cl_event ev  = nullptr;
+                cl::event network_complete;
+
+                for (auto& conv : network) {
                     cl_mem arg;
                     arg   = cl_neighbourhood;
                     error = ::clSetKernelArg(conv.first, 0, sizeof(arg), &arg);
@@ -375,90 +1291,173 @@ namespace engine {
                     std::swap(cl_conv_input, cl_conv_output);
                 }
 
-                // Read the pixel coordinates off the device
-                cl::event pixels_read;
-                ev = nullptr;
-                std::vector<std::array<Scalar, 2>> pixels(neighbourhood.size() - 1);
-                cl_event iev = cl_pixels_loaded;
-                error        = ::clEnqueueReadBuffer(queue,
-                                              cl_pixels,
-                                              false,
-                                              0,
-                                              pixels.size() * sizeof(std::array<Scalar, 2>),
-                                              pixels.data(),
-                                              1,
-                                              &iev,
-                                              &ev);
-                if (ev) pixels_read = cl::event(ev, ::clReleaseEvent);
-                throw_cl_error(error, "Error reading projected pixels");
+                return std::make_pair(cl_conv_input, network_complete);
+            }
 
-                // Read the classifications off the device (they'll be in input)
-                cl::event classes_read;
-                ev  = nullptr;
-                iev = network_complete;
-                std::vector<Scalar> classifications(neighbourhood.size() * conv_layers.back().second);
-                error = ::clEnqueueReadBuffer(queue,
-                                              cl_conv_input,
-                                              false,
-                                              0,
-                                              classifications.size() * sizeof(Scalar),
-                                              classifications.data(),
-                                              1,
-                                              &iev,
-                                              &ev);
-                if (ev) classes_read = cl::event(ev, ::clReleaseEvent);
-                throw_cl_error(error, "Error reading classified values");
+            /**
+             * @brief Runs several networks from the same input, each from a copy of it in the ping pong buffers, and
+             * reads back their outputs. Each network waits for the output of the one before it to be read.
+             *
+             * @param first            the index of the first network to run
+             * @param last             one past the index of the last network to run
+             * @param cl_neighbourhood the graph of the points being classified, including any offscreen points
+             * @param cl_source        the input shared by the networks, which is left unchanged
+             * @param dimensions       the number of values for each point in the shared input
+             * @param n_points         the number of points being classified, including any offscreen points
+             * @param events           the events that must complete before the shared input can be read
+             *
+             * @return the output of each network in order, along with the number of values for each point in it
+             */
+            std::vector<std::pair<std::vector<Scalar>, unsigned int>> run_networks(
+              const unsigned int& first,
+              const unsigned int& last,
+              const cl::mem& cl_neighbourhood,
+              const cl::mem& cl_source,
+              const unsigned int& dimensions,
+              const int& n_points,
+              const std::vector<cl::event>& events) const {
+                cl_int error = CL_SUCCESS;
+                cl_event ev  = nullptr;
+
+                auto cl_conv_buffers = get_network_memory(max_width * n_points);
+                std::vector<std::pair<std::vector<Scalar>, unsigned int>> outputs;
+                cl::event output_read;
+                for (unsigned int n = first; n < last; ++n) {
+                    std::vector<cl_event> copy_after(events.begin(), events.end());
+                    if (output_read) { copy_after.push_back(output_read); }
+                    cl::event source_copied;
+                    ev    = nullptr;
+                    error = ::clEnqueueCopyBuffer(queue,
+                                                  cl_source,
+                                                  cl_conv_buffers[0],
+                                                  0,
+                                                  0,
+                                                  n_points * dimensions * sizeof(Scalar),
+                                                  copy_after.size(),
+                                                  copy_after.data(),
+                                                  &ev);
+                    if (ev) source_copied = cl::event(ev, ::clReleaseEvent);
+                    throw_cl_error(error, "Error copying the shared input to the network input");
+
+                    cl::mem cl_output;
+                    cl::event network_complete;
+                    std::tie(cl_output, network_complete) = run_network(conv_layers[n],
+                                                                        cl_neighbourhood,
+                                                                        cl_conv_buffers[0],
+                                                                        cl_conv_buffers[1],
+                                                                        n_points,
+                                                                        {source_copied});
+
+                    const unsigned int output_dimensions = conv_layers[n].back().second;
+                    outputs.emplace_back(std::vector<Scalar>(n_points * output_dimensions), output_dimensions);
+                    cl_event iev = network_complete;
+                    ev           = nullptr;
+                    error        = ::clEnqueueReadBuffer(queue,
+                                                  cl_output,
+                                                  false,
+                                                  0,
+                                                  outputs.back().first.size() * sizeof(Scalar),
+                                                  outputs.back().first.data(),
+                                                  1,
+                                                  &iev,
+                                                  &ev);
+                    if (ev) output_read = cl::event(ev, ::clReleaseEvent);
+                    throw_cl_error(error, "Error reading classified values");
+                }
 
-                // Flush the queue to ensure all the commands have been issued
+                // Flush the queue and wait for the last read, which follows every other command
                 ::clFlush(queue);
+                if (output_read) {
+                    cl_event last_read = output_read;
+                    ::clWaitForEvents(1, &last_read);
+                }
 
-                // Wait for the chain to finish up to where we care about it
-                cl_event end_events[2] = {pixels_read, classes_read};
-                ::clWaitForEvents(2, end_events);
+                return outputs;
+            }
 
-                return ClassifiedMesh<Scalar, N_NEIGHBOURS>{
-                  std::move(pixels), std::move(neighbourhood), std::move(indices), std::move(classifications)};
+            /**
+             * @brief Runs the trunk of a branching network over the points in the input buffer and then each of its
+             * heads from a copy of the trunk's output
+             *
+             * @param cl_neighbourhood the graph of the points being classified, including any offscreen points
+             * @param cl_conv_input    the buffer holding the input values for each point
+             * @param cl_conv_output   a buffer of the same size used to ping pong between layers
+             * @param n_points         the number of points being classified, including any offscreen points
+             * @param events           the events that must complete before the trunk can run
+             *
+             * @return the output of each head in order, along with the number of values for each point in it
+             */
+            std::vector<std::pair<std::vector<Scalar>, unsigned int>> classify_heads(
+              const cl::mem& cl_neighbourhood,
+              cl::mem cl_conv_input,
+              cl::mem cl_conv_output,
+              const int& n_points,
+              const std::vector<cl::event>& events) const {
+                cl::event trunk_complete;
+                std::tie(cl_conv_input, trunk_complete) =
+                  run_network(conv_layers.front(), cl_neighbourhood, cl_conv_input, cl_conv_output, n_points, events);
+
+                // Keep the trunk's output aside as the heads overwrite the ping pong buffers
+                const unsigned int dimensions = conv_layers.front().empty() ? 4 : conv_layers.front().back().second;
+                cl::mem cl_trunk              = get_shared_memory(n_points * dimensions);
+                std::vector<cl_event> copy_after(events.begin(), events.end());
+                if (trunk_complete) { copy_after = {trunk_complete}; }
+                cl::event trunk_copied;
+                cl_event ev  = nullptr;
+                cl_int error = ::clEnqueueCopyBuffer(queue,
+                                                     cl_conv_input,
+                                                     cl_trunk,
+                                                     0,
+                                                     0,
+                                                     n_points * dimensions * sizeof(Scalar),
+                                                     copy_after.size(),
+                                                     copy_after.data(),
+                                                     &ev);
+                if (ev) trunk_copied = cl::event(ev, ::clReleaseEvent);
+                throw_cl_error(error, "Error copying the output of the trunk");
+
+                return run_networks(
+                  1, conv_layers.size(), cl_neighbourhood, cl_trunk, dimensions, n_points, {trunk_copied});
             }
 
             /**
-             * @brief Project and classify a mesh using the neural network that is loaded into this engine.
-             * This version takes an aggregate VisualMesh object
+             * @brief Uploads the pixel coordinates of a cached projection so it can be used in place of do_project
              *
-             * @tparam Model the mesh model that we are projecting
+             * @tparam N_NEIGHBOURS the number of neighbours that each point has
              *
-             * @param mesh    the mesh table that we are projecting to pixel coordinates
-             * @param Hoc     the homogenous transformation matrix from the camera to the observation plane
-             * @param lens    the lens parameters that describe the optics of the camera
-             * @param image   the data that represents the image the network will run from
-             * @param format  the pixel format of this image as a fourcc code
+             * @param projected the cached projection to upload
              *
-             * @return a classified mesh for the provided arguments
+             * @return the same values as do_project would have returned for this projection
              */
-            template <template <typename> class Model>
-            ClassifiedMesh<Scalar, Model<Scalar>::N_NEIGHBOURS> operator()(const VisualMesh<Scalar, Model>& mesh,
-                                                                           const mat4<Scalar>& Hoc,
-                                                                           const Lens<Scalar>& lens,
-                                                                           const void* image,
-                                                                           const uint32_t& format) const {
-                return operator()(mesh.height(Hoc[2][3]), Hoc, lens, image, format);
-            }
+            template <int N_NEIGHBOURS>
+            std::tuple<std::vector<std::array<int, N_NEIGHBOURS>>, std::vector<int>, cl::mem, cl::event>
+              upload_projection(const ProjectedMesh<Scalar, N_NEIGHBOURS>& projected) const {
 
-            void clear_cache() {
-                device_points_cache.clear();
-                indices_map_memory.memory         = nullptr;
-                indices_map_memory.n_points       = 0;
-                pixel_coordinates_memory.memory   = nullptr;
-                pixel_coordinates_memory.n_points = 0;
-                neighbourhood_memory.memory       = nullptr;
-                neighbourhood_memory.n_points     = 0;
-                network_memory.memory             = {nullptr, nullptr};
-                network_memory.n_points           = 0;
-                image_memory.memory               = nullptr;
-                image_memory.dimensions           = {0, 0};
-                image_memory.format               = 0;
+                const int n_points = projected.global_indices.size();
+                if (n_points == 0) {
+                    return std::make_tuple(
+                      std::vector<std::array<int, N_NEIGHBOURS>>(), std::vector<int>(), cl::mem(), cl::event());
+                }
+
+                // The write is blocking as the cache could replace this projection before the device has read it
+                cl::mem pixel_coordinates = get_pixel_coordinates_memory(n_points);
+                cl::event uploaded;
+                cl_event ev  = nullptr;
+                cl_int error = ::clEnqueueWriteBuffer(queue,
+                                                      pixel_coordinates,
+                                                      true,
+                                                      0,
+                                                      n_points * sizeof(std::array<Scalar, 2>),
+                                                      projected.pixel_coordinates.data(),
+                                                      0,
+                                                      nullptr,
+                                                      &ev);
+                if (ev) uploaded = cl::event(ev, ::clReleaseEvent);
+                throw_cl_error(error, "Error uploading cached pixel coordinates to the device");
+
+                return std::make_tuple(projected.neighbourhood, projected.global_indices, pixel_coordinates, uploaded);
             }
 
-        private:
             template <template <typename> class Model>
             std::tuple<std::vector<std::array<int, Model<Scalar>::N_NEIGHBOURS>>, std::vector<int>, cl::mem, cl::event>
               do_project(const Mesh<Scalar, Model>& mesh, const mat4<Scalar>& Hoc, const Lens<Scalar>& lens) const {
@@ -654,6 +1653,32 @@ namespace engine {
                 return pixel_coordinates_memory.memory;
             }
 
+            cl::mem get_label_memory(const int& n_values) const {
+
+                if (label_memory.n_values < n_values) {
+                    cl_int error;
+                    label_memory.memory = cl::mem(
+                      ::clCreateBuffer(context, CL_MEM_WRITE_ONLY, n_values, nullptr, &error), ::clReleaseMemObject);
+                    throw_cl_error(error, "Error allocating label buffer on device");
+                    label_memory.n_values = n_values;
+                }
+                return label_memory.memory;
+            }
+
+            cl::mem get_shared_memory(const int& n_values) const {
+
+                if (shared_memory.n_values < n_values) {
+                    // Align the size to the nearest workgroup size
+                    size_t size = ((n_values - 1) / workgroup_size + 1) * workgroup_size * sizeof(Scalar);
+                    cl_int error;
+                    shared_memory.memory = cl::mem(
+                      ::clCreateBuffer(context, CL_MEM_READ_WRITE, size, nullptr, &error), ::clReleaseMemObject);
+                    throw_cl_error(error, "Error allocating shared input buffer on device");
+                    shared_memory.n_values = n_values;
+                }
+                return shared_memory.memory;
+            }
+
             std::array<cl::mem, 2> get_network_memory(const int& n_points) const {
                 if (network_memory.n_points < n_points) {
                     // Align the size to the nearest workgroup size
@@ -736,8 +1761,14 @@ namespace engine {
             cl::kernel project_rectilinear;
             /// Kernel for reading projected pixel coordinates from an image into the network input layer
             cl::kernel load_image;
-            /// A list of kernels to run in sequence to run the network
-            std::vector<std::pair<cl::kernel, size_t>> conv_layers;
+            /// Kernel for reducing the output of a network to the label of each point
+            cl::kernel label_outputs;
+            /// A list of kernels to run in sequence for each of the networks
+            std::vector<std::vector<std::pair<cl::kernel, size_t>>> conv_layers;
+            /// The names of the heads of a branching network, whose trunk is the first network and heads the rest
+            std::vector<std::string> head_names;
+            /// What is given back for each point of a classified mesh
+            OutputMode output_mode = OutputMode::CLASSIFICATIONS;
 
             /// A location to cache the GPU memory allocated for indices map so we don't reallocate between runs
             mutable struct {
@@ -751,6 +1782,19 @@ namespace engine {
                 cl::mem memory;
             } pixel_coordinates_memory;
 
+            /// A location to cache the GPU memory allocated for an input shared by several networks so we don't
+            /// reallocate between runs
+            mutable struct {
+                int n_values = 0;
+                cl::mem memory;
+            } shared_memory;
+
+            /// A location to cache the GPU memory allocated for the labels so we don't reallocate between runs
+            mutable struct {
+                int n_values = 0;
+                cl::mem memory;
+            } label_memory;
+
             /// A location to cache the GPU memory allocated for the ping pong network buffers so we don't reallocate
             /// between runs
             mutable struct {
@@ -779,6 +1823,9 @@ namespace engine {
 
             /// Cache of opencl buffers from mesh objects
             mutable std::map<const void*, cl::mem> device_points_cache;
+
+            /// The most recent projection of each mesh so stationary cameras can skip projection
+            mutable ProjectionCache<Scalar> projection_cache;
         };
 
     }  // namespace opencl
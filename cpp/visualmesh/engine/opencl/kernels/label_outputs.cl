@@ -0,0 +1,49 @@
+/*
+ * Copyright (C) 2017-2020 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/**
+ * Reduces the output of a network to the most likely class of each point so only bytes are read off the device
+ *
+ * @param values      the output of the network with dimensions values for each point
+ * @param dimensions  the number of values for each point
+ * @param n_points    the number of points, as the global size is rounded up to the workgroup size
+ * @param confidence  if the probability of each label should be written after all of the labels
+ * @param out         the label of each point, followed by the confidence of each point scaled to 0-255 when wanted
+ */
+kernel void label_outputs(global const Scalar* values,
+                          const int dimensions,
+                          const int n_points,
+                          const int confidence,
+                          global uchar* out) {
+
+    const int index = get_global_id(0);
+    if (index >= n_points) { return; }
+
+    // Find the first class with the largest value
+    global const Scalar* point = values + index * dimensions;
+    int label                  = 0;
+    Scalar largest             = point[0];
+    for (int i = 1; i < dimensions; ++i) {
+        if (point[i] > largest) {
+            label   = i;
+            largest = point[i];
+        }
+    }
+
+    out[index] = (uchar) label;
+    if (confidence) { out[n_points + index] = convert_uchar_sat_rte(largest * (Scalar)(255.0)); }
+}
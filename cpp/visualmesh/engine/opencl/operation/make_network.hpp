@@ -19,9 +19,11 @@
 #define VISUALMESH_OPENCL_OPERATION_MAKE_NETWORK_HPP
 
 #include <iostream>
+#include <string>
 #include <utility>
 #include <vector>
 
+#include "visualmesh/activation_storage.hpp"
 #include "visualmesh/network_structure.hpp"
 #include "wrapper.hpp"
 
@@ -34,38 +36,90 @@ namespace engine {
              * @brief Given a network structure object generate the OpenCL source code for the kernels needed to execute
              * it
              *
+             * @details
+             *  When the activations are stored in 16 bits the buffers between the convolutional groups hold half or
+             *  bfloat16 values, while the image input to the first group and the output of the last group stay as
+             *  Scalar. Half precision uses vload_half and vstore_half_rte which are part of core OpenCL so they work on
+             *  devices without cl_khr_fp16, and bfloat16 is unpacked from ushort with bit shifts.
+             *
+             *  The kernels are named conv0, conv1 and so on after a prefix, so the kernels for several networks can be
+             *  built into the same program by giving each network a different prefix.
+             *
              * @tparam Scalar the scalar type used for calculations and storage (normally one of float or double)
              *
-             * @param structure the network structure to generate the kernels from
+             * @param structure  the network structure to generate the kernels from
+             * @param storage    how activations are stored between the convolutional groups
+             * @param prefix     the prefix for the names of the generated kernels
+             * @param dimensions the number of values for each point at the input of the network, 4 for the image
              *
              * @return the OpenCL source code for the kernels to be built
              */
             template <typename Scalar>
-            std::string make_network(const NetworkStructure<Scalar>& structure) {
+            std::string make_network(const NetworkStructure<Scalar>& structure,
+                                     const ActivationStorage& storage = ActivationStorage::FULL,
+                                     const std::string& prefix        = "",
+                                     const unsigned int& dimensions   = 4) {
                 // Generate the OpenCL kernels for the network
                 std::stringstream code;
 
                 // If our structure has no layers, return empty code
                 if (structure.empty() || structure.front().empty()) { return ""; }
 
-                // First layer has 4 inputs, so that tells us how many neighbours we have (minus ourself)
-                const unsigned int n_neighbours = (structure.front().front().weights.size() / 4) - 1;
+                // The size of the first layer's input tells us how many neighbours we have (minus ourself)
+                const auto& first               = structure.front().front();
+                const unsigned int n_neighbours = first.depthwise.empty() ? (first.weights.size() / dimensions) - 1
+                                                                          : first.depthwise.size() - 1;
 
                 // Set our precision for how many digits our scalar has
                 code << std::setprecision(std::numeric_limits<Scalar>::digits10 + 2);
 
+                // Pack and unpack bfloat16 rounding to nearest even and keeping NaNs quiet, guarded so several
+                // networks can be built into the same program
+                if (storage == ActivationStorage::BFLOAT16) {
+                    code << "#ifndef VISUALMESH_BFLOAT16" << std::endl;
+                    code << "#define VISUALMESH_BFLOAT16" << std::endl;
+                    code << "Scalar load_bfloat16(const int offset, global const ushort* p) {" << std::endl;
+                    code << "  return as_float((uint)p[offset] << 16);" << std::endl;
+                    code << "}" << std::endl << std::endl;
+                    code << "void store_bfloat16(const float v, const int offset, global ushort* p) {" << std::endl;
+                    code << "  const uint f = as_uint(v);" << std::endl;
+                    code << "  p[offset] = (f & 0x7FFFFFFF) > 0x7F800000 ? (f >> 16) | 0x40"
+                         << " : (f + 0x7FFF + ((f >> 16) & 1)) >> 16;" << std::endl;
+                    code << "}" << std::endl;
+                    code << "#endif  // VISUALMESH_BFLOAT16" << std::endl << std::endl;
+                }
+
+                // The type of the buffers between convolutional groups and how to read and write them
+                const std::string packed_type = storage == ActivationStorage::HALF       ? "half"
+                                                : storage == ActivationStorage::BFLOAT16 ? "ushort"
+                                                                                         : "Scalar";
+                auto load = [&](const unsigned int& conv_no, const std::string& offset) {
+                    if (conv_no == 0 || storage == ActivationStorage::FULL) { return "input[" + offset + "]"; }
+                    if (storage == ActivationStorage::HALF) { return "vload_half(" + offset + ", input)"; }
+                    return "load_bfloat16(" + offset + ", input)";
+                };
+                auto store = [&](const unsigned int& conv_no, const std::string& offset, const std::string& value) {
+                    if (conv_no + 1 == structure.size() || storage == ActivationStorage::FULL) {
+                        return "output[" + offset + "] = " + value;
+                    }
+                    if (storage == ActivationStorage::HALF) {
+                        return "vstore_half_rte((float)" + value + ", " + offset + ", output)";
+                    }
+                    return "store_bfloat16(" + value + ", " + offset + ", output)";
+                };
+
                 // Keep track of the input and output size of each layer for building the network
-                // The first layer input is always 4 from the image
-                unsigned int input_dimensions  = 4;
+                unsigned int input_dimensions  = dimensions;
                 unsigned int output_dimensions = 0;
 
                 for (unsigned int conv_no = 0; conv_no < structure.size(); ++conv_no) {
                     auto& conv = structure[conv_no];
 
                     // Write our OpenCL kernel definition
-                    code << "kernel void conv" << conv_no
-                         << "(global const int* neighbourhood, global const Scalar* input, global Scalar* output) {"
-                         << std::endl
+                    code << "kernel void " << prefix << "conv" << conv_no
+                         << "(global const int* neighbourhood, global const "
+                         << (conv_no == 0 ? "Scalar" : packed_type) << "* input, global "
+                         << (conv_no + 1 == structure.size() ? "Scalar" : packed_type) << "* output) {" << std::endl
                          << std::endl;
 
                     code << "  // Get our kernel index" << std::endl;
@@ -75,32 +129,65 @@ namespace engine {
                      *                    GATHER                     *
                      *************************************************/
 
-                    code << "  // Gather from our neighbourhood " << std::endl;
-                    code << "  Scalar in0[" << (input_dimensions * (n_neighbours + 1)) << "] = {" << std::endl;
-
-                    // Read the ones for our own index
-                    for (unsigned int j = 0; j < input_dimensions; ++j) {
-                        code << "    input[idx * " << input_dimensions << " + " << j << "]," << std::endl;
+                    const auto& depthwise = conv.front().depthwise;
+                    if (!depthwise.empty()) {
+                        // Depthwise separable groups sum each channel over the neighbourhood rather than gathering it
+                        code << "  // Sum each channel over our neighbourhood" << std::endl;
+                        code << "  Scalar in0[" << input_dimensions << "] = {" << std::endl;
+                        for (unsigned int j = 0; j < input_dimensions; ++j) {
+                            // Pruned depthwise weights are left out entirely
+                            code << "    ";
+                            bool empty = true;
+                            for (unsigned int i = 0; i < n_neighbours + 1; ++i) {
+                                if (depthwise[i][j] == Scalar(0)) { continue; }
+                                const std::string point = i == 0 ? "idx"
+                                                                 : "neighbourhood[idx * " + std::to_string(n_neighbours)
+                                                                     + " + " + std::to_string(i - 1) + "]";
+                                const std::string offset =
+                                  point + " * " + std::to_string(input_dimensions) + " + " + std::to_string(j);
+                                code << (empty ? "" : " + ") << load(conv_no, offset) << " * " << depthwise[i][j];
+                                empty = false;
+                            }
+                            if (empty) { code << "0"; }
+                            if (j + 1 < input_dimensions) { code << ","; }
+                            code << std::endl;
+                        }
+                        code << "  };" << std::endl << std::endl;
                     }
+                    else {
+                        code << "  // Gather from our neighbourhood " << std::endl;
+                        code << "  Scalar in0[" << (input_dimensions * (n_neighbours + 1)) << "] = {" << std::endl;
 
-                    // Read our neighbourhood
-                    for (unsigned int i = 0; i < n_neighbours; ++i) {
+                        // Read the ones for our own index
                         for (unsigned int j = 0; j < input_dimensions; ++j) {
-                            code << "    input[neighbourhood[idx * " << n_neighbours << " + " << i << "] * "
-                                 << input_dimensions << " + " << j << "]";
+                            code << "    "
+                                 << load(conv_no,
+                                         "idx * " + std::to_string(input_dimensions) + " + " + std::to_string(j))
+                                 << "," << std::endl;
+                        }
 
-                            // Comma separated except for the end
-                            if (i < n_neighbours || j + 1 < input_dimensions) { code << ","; }
-                            code << std::endl;
+                        // Read our neighbourhood
+                        for (unsigned int i = 0; i < n_neighbours; ++i) {
+                            for (unsigned int j = 0; j < input_dimensions; ++j) {
+                                code << "    "
+                                     << load(conv_no,
+                                             "neighbourhood[idx * " + std::to_string(n_neighbours) + " + "
+                                               + std::to_string(i) + "] * " + std::to_string(input_dimensions) + " + "
+                                               + std::to_string(j));
+
+                                // Comma separated except for the end
+                                if (i < n_neighbours || j + 1 < input_dimensions) { code << ","; }
+                                code << std::endl;
+                            }
                         }
-                    }
-                    code << "  };";
+                        code << "  };";
 
 
-                    // We have gathered which increased the size of the input
-                    input_dimensions = input_dimensions * (n_neighbours + 1);
+                        // We have gathered which increased the size of the input
+                        input_dimensions = input_dimensions * (n_neighbours + 1);
 
-                    code << std::endl << std::endl;
+                        code << std::endl << std::endl;
+                    }
 
                     /*************************************************
                      *                WEIGHTS + BIAS                 *
@@ -115,14 +202,16 @@ namespace engine {
                         // Update our output dimensions
                         output_dimensions = biases.size();
 
-                        // Perform the matrix multiplication
+                        // Perform the matrix multiplication, pruned weights are left out entirely
                         code << "  // Perform our matrix multiplication for weights and add bias for layer " << layer_no
                              << std::endl;
                         code << "  Scalar in" << (layer_no + 1) << "[" << output_dimensions << "] = {" << std::endl;
                         for (unsigned int i = 0; i < output_dimensions; ++i) {
                             code << "    ";
                             for (unsigned int j = 0; j < input_dimensions; ++j) {
-                                code << "in" << layer_no << "[" << j << "] * " << weights[j][i] << " + ";
+                                if (weights[j][i] != Scalar(0)) {
+                                    code << "in" << layer_no << "[" << j << "] * " << weights[j][i] << " + ";
+                                }
                             }
                             code << biases[i];
                             if (i + 1 < output_dimensions) { code << ","; }
@@ -187,6 +276,9 @@ namespace engine {
                                     code << "  " << e << " /= exp_sum;" << std::endl;
                                 }
                             } break;
+                            case ActivationFunction::LINEAR: {
+                                code << "  // Linear, no activation" << std::endl;
+                            } break;
                         }
 
                         code << std::endl;
@@ -200,8 +292,11 @@ namespace engine {
                      *************************************************/
                     code << "  // Save our value to the output" << std::endl;
                     for (unsigned int i = 0; i < input_dimensions; ++i) {
-                        code << "  output[idx * " << input_dimensions << " + " << i << "] = in" << conv.size() << "["
-                             << i << "];" << std::endl;
+                        code << "  "
+                             << store(conv_no,
+                                      "idx * " + std::to_string(input_dimensions) + " + " + std::to_string(i),
+                                      "in" + std::to_string(conv.size()) + "[" + std::to_string(i) + "]")
+                             << ";" << std::endl;
                     }
 
                     code << "}" << std::endl << std::endl;
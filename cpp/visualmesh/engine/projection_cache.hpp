@@ -0,0 +1,334 @@
+/*
+ * Copyright (C) 2017-2020 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef VISUALMESH_ENGINE_PROJECTION_CACHE_HPP
+#define VISUALMESH_ENGINE_PROJECTION_CACHE_HPP
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <future>
+#include <limits>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "visualmesh/lens.hpp"
+#include "visualmesh/projected_mesh.hpp"
+#include "visualmesh/utility/math.hpp"
+#include "visualmesh/utility/projection.hpp"
+
+namespace visualmesh {
+namespace engine {
+
+    /**
+     * @brief Remembers the most recent projection of each mesh so it can be reused when the camera barely moves
+     *
+     * @details
+     *  When the camera is stationary consecutive frames have almost identical Hoc matrices, so the lookup, projection
+     *  and neighbourhood remap would produce the same result every frame. This cache stores the last projection of each
+     *  mesh along with the orientation and lens it was made with. When a new projection is requested it estimates how
+     *  far any pixel would move between the stored pose and the requested one and if that is within the tolerance
+     *  returns the stored result instead.
+     *
+     *  The displacement is estimated by unprojecting a grid of probe pixels that cover the image (corners, edge centres
+     *  and the centre) with the cached pose and reprojecting them with the new one. Since the displacement varies
+     *  smoothly over the image this grid finds the largest movement for rotations and lens changes. On fisheye lenses
+     *  the probes that fall outside the field of view are moved in to its edge. The height of the camera does not
+     *  affect projection except to choose a mesh, and different meshes are cached separately.
+     *
+     *  Comparisons are always made against the pose that the cached projection was computed with, so slow drift
+     *  eventually exceeds the tolerance and causes a new projection rather than accumulating error.
+     *
+     *  A projection can also be started ahead of time on another thread from a predicted pose. The next lookup for
+     *  that mesh waits for it and commits it if the real pose is within the tolerance given for the prediction,
+     *  otherwise it is discarded and the projection is recomputed as normal.
+     *
+     * @tparam Scalar the scalar type used for calculations and storage (normally one of float or double)
+     */
+    template <typename Scalar>
+    class ProjectionCache {
+    public:
+        /**
+         * @brief Construct a new Projection Cache
+         *
+         * @param tolerance the maximum pixel displacement for which a cached projection is reused, 0 disables caching
+         */
+        ProjectionCache(const Scalar& tolerance = 0) : tolerance(tolerance) {}
+
+        /**
+         * @brief Set the maximum displacement in pixels for which a cached projection will be reused
+         *
+         * @param tolerance the maximum pixel displacement, 0 disables caching
+         */
+        void set_tolerance(const Scalar& tolerance) {
+            this->tolerance = tolerance;
+            if (!enabled()) { clear(); }
+        }
+
+        /**
+         * @return true if the cache will be used
+         */
+        bool enabled() const {
+            return tolerance > 0;
+        }
+
+        /**
+         * @brief Look for a projection of this mesh that is close enough to the requested pose
+         *
+         * @tparam N_NEIGHBOURS the number of neighbours that each point has
+         * @tparam Mesh         the type of the mesh that is being projected
+         *
+         * @param mesh  the mesh that is being projected
+         * @param Hoc   the homogenous transformation matrix from the camera to the observation plane
+         * @param lens  the lens parameters that describe the optics of the camera
+         *
+         * @return the cached projection, or nullptr if there is no projection within tolerance
+         */
+        template <int N_NEIGHBOURS, typename Mesh>
+        std::shared_ptr<const ProjectedMesh<Scalar, N_NEIGHBOURS>> find(const Mesh& mesh,
+                                                                        const mat4<Scalar>& Hoc,
+                                                                        const Lens<Scalar>& lens) {
+            // A speculative projection for this mesh is consumed by the first lookup after it was made
+            auto spec = speculations.find(&mesh);
+            if (spec != speculations.end()) {
+                Speculation speculation = std::move(spec->second);
+                speculations.erase(spec);
+
+                if (speculation.n_nodes == mesh.nodes.size()
+                    && displacement(speculation.Hoc, speculation.lens, Hoc, lens) <= speculation.tolerance) {
+                    auto projected = speculation.projected.get();
+                    if (enabled()) {
+                        entries[&mesh] = Entry{speculation.Hoc, speculation.lens, mesh.nodes.size(), projected};
+                    }
+                    return std::static_pointer_cast<const ProjectedMesh<Scalar, N_NEIGHBOURS>>(projected);
+                }
+
+                // Let a mispredicted projection finish in the background rather than waiting for it now
+                discard(std::move(speculation.projected));
+            }
+
+            if (!enabled()) { return nullptr; }
+
+            auto it = entries.find(&mesh);
+            if (it == entries.end()) { return nullptr; }
+            const Entry& entry = it->second;
+
+            // A different mesh may have been allocated where an old one used to be
+            if (entry.n_nodes != mesh.nodes.size()) { return nullptr; }
+
+            if (displacement(entry.Hoc, entry.lens, Hoc, lens) > tolerance) { return nullptr; }
+
+            return std::static_pointer_cast<const ProjectedMesh<Scalar, N_NEIGHBOURS>>(entry.projected);
+        }
+
+        /**
+         * @brief Store a projection of a mesh so it can be reused for nearby poses
+         *
+         * @tparam N_NEIGHBOURS the number of neighbours that each point has
+         * @tparam Mesh         the type of the mesh that was projected
+         *
+         * @param mesh       the mesh that was projected
+         * @param Hoc        the homogenous transformation matrix that the projection was made with
+         * @param lens       the lens parameters that the projection was made with
+         * @param projected  the result of the projection
+         */
+        template <int N_NEIGHBOURS, typename Mesh>
+        void store(const Mesh& mesh,
+                   const mat4<Scalar>& Hoc,
+                   const Lens<Scalar>& lens,
+                   const ProjectedMesh<Scalar, N_NEIGHBOURS>& projected) {
+            if (!enabled()) { return; }
+            entries[&mesh] =
+              Entry{Hoc, lens, mesh.nodes.size(), std::make_shared<ProjectedMesh<Scalar, N_NEIGHBOURS>>(projected)};
+        }
+
+        /**
+         * @brief Start projecting a mesh on another thread for a pose that is expected in the future
+         *
+         * @details
+         *  The projection function must only read from the mesh and must not touch the engine, as it runs concurrently
+         *  with whatever the engine is doing. The mesh must stay alive until the speculation has been consumed or the
+         *  cache has been cleared.
+         *
+         * @tparam N_NEIGHBOURS the number of neighbours that each point has
+         * @tparam Mesh         the type of the mesh that is being projected
+         * @tparam Project      a callable taking (mesh, Hoc, lens) and returning a ProjectedMesh
+         *
+         * @param mesh       the mesh to project
+         * @param Hoc        the predicted homogenous transformation matrix from the camera to the observation plane
+         * @param lens       the lens parameters that describe the optics of the camera
+         * @param tolerance  the maximum pixel displacement from the predicted pose for which the result is used
+         * @param project    the function that performs the projection
+         */
+        template <int N_NEIGHBOURS, typename Mesh, typename Project>
+        void speculate(const Mesh& mesh,
+                       const mat4<Scalar>& Hoc,
+                       const Lens<Scalar>& lens,
+                       const Scalar& tolerance,
+                       Project&& project) {
+            const Mesh* m = &mesh;
+            std::future<std::shared_ptr<const void>> projected =
+              std::async(std::launch::async, [m, Hoc, lens, project]() -> std::shared_ptr<const void> {
+                  return std::make_shared<ProjectedMesh<Scalar, N_NEIGHBOURS>>(project(*m, Hoc, lens));
+              });
+
+            // Any previous speculation for this mesh is now stale, but replacing its future would wait for it to finish
+            auto stale = speculations.find(&mesh);
+            if (stale != speculations.end()) {
+                discard(std::move(stale->second.projected));
+                speculations.erase(stale);
+            }
+            speculations.emplace(&mesh, Speculation{Hoc, lens, mesh.nodes.size(), tolerance, std::move(projected)});
+        }
+
+        /**
+         * @brief Remove all of the cached and speculative projections, waiting for any that are still running
+         */
+        void clear() {
+            entries.clear();
+            speculations.clear();
+            discarded.clear();
+        }
+
+        /**
+         * @brief Estimate the largest distance any pixel moves when changing from one pose and lens to another
+         *
+         * @param Hoc_a   the homogenous transformation matrix from the camera to the observation plane for pose a
+         * @param lens_a  the lens parameters for pose a
+         * @param Hoc_b   the homogenous transformation matrix from the camera to the observation plane for pose b
+         * @param lens_b  the lens parameters for pose b
+         *
+         * @return the largest displacement found in pixels, infinity if the two can never be equivalent
+         */
+        static Scalar displacement(const mat4<Scalar>& Hoc_a,
+                                   const Lens<Scalar>& lens_a,
+                                   const mat4<Scalar>& Hoc_b,
+                                   const Lens<Scalar>& lens_b) {
+
+            // Changing the image, the type of lens or the part of it that is cut off invalidates every pixel
+            if (lens_a.dimensions != lens_b.dimensions || lens_a.projection != lens_b.projection
+                || lens_a.fov != lens_b.fov) {
+                return std::numeric_limits<Scalar>::infinity();
+            }
+
+            // Rotations from camera a to the observation plane, and from the observation plane to camera b
+            const mat3<Scalar> Roc_a(block<3, 3>(Hoc_a));
+            const mat3<Scalar> Rco_b(block<3, 3>(transpose(Hoc_b)));
+
+            // Probe a grid of pixels that covers the image, staying one pixel in from the edges
+            const Scalar x[3] = {
+              Scalar(1), Scalar(lens_a.dimensions[0]) * Scalar(0.5), Scalar(lens_a.dimensions[0] - 1)};
+            const Scalar y[3] = {
+              Scalar(1), Scalar(lens_a.dimensions[1]) * Scalar(0.5), Scalar(lens_a.dimensions[1] - 1)};
+
+            // Fisheye lenses don't see the corners of the image, so probes outside the field of view are moved in along
+            // the same direction from the optical centre to the edge of the field of view
+            const Scalar half_fov = std::min(lens_a.fov * Scalar(0.5), Scalar(M_PI));
+            const Scalar cos_fov  = std::cos(half_fov);
+            const Scalar sin_fov  = std::sin(half_fov);
+            const vec2<Scalar> optical_centre =
+              subtract(multiply(cast<Scalar>(lens_a.dimensions), Scalar(0.5)), lens_a.centre);
+
+            Scalar max_displacement = 0;
+            for (const auto& py : y) {
+                for (const auto& px : x) {
+                    vec3<Scalar> ray_a = unproject(vec2<Scalar>{{px, py}}, lens_a);
+
+                    // Pixels past the edge of a fisheye lens can also unproject to NaN, which this comparison rejects
+                    if (!(ray_a[0] >= cos_fov)) {
+                        const vec2<Scalar> screen = subtract(optical_centre, vec2<Scalar>{{px, py}});
+                        const Scalar r            = norm(screen);
+                        ray_a = vec3<Scalar>{{cos_fov, sin_fov * screen[0] / r, sin_fov * screen[1] / r}};
+                    }
+                    const vec2<Scalar> p_a = project(ray_a, lens_a);
+                    const vec3<Scalar> ray = multiply(Rco_b, multiply(Roc_a, ray_a));
+
+                    // A rectilinear lens can't project points that swing behind the camera
+                    if (lens_b.projection == RECTILINEAR && ray[0] <= 0) {
+                        return std::numeric_limits<Scalar>::infinity();
+                    }
+
+                    const vec2<Scalar> d = subtract(project(ray, lens_b), p_a);
+                    max_displacement     = std::max(max_displacement, norm(d));
+                }
+            }
+
+            // NaN from a degenerate lens should never be considered within tolerance
+            return std::isfinite(max_displacement) ? max_displacement : std::numeric_limits<Scalar>::infinity();
+        }
+
+    private:
+        /**
+         * @brief Hold on to a projection that is no longer wanted until its thread has finished
+         *
+         * @details
+         *  The future returned by std::async waits for its thread when it is destroyed, so stale futures are kept
+         *  until they are ready rather than being destroyed while their projection is still running.
+         *
+         * @param projected the future of the unwanted projection
+         */
+        void discard(std::future<std::shared_ptr<const void>>&& projected) {
+            discarded.erase(std::remove_if(discarded.begin(),
+                                           discarded.end(),
+                                           [](const std::future<std::shared_ptr<const void>>& f) {
+                                               return f.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+                                           }),
+                            discarded.end());
+            discarded.push_back(std::move(projected));
+        }
+
+        struct Entry {
+            /// The pose that the projection was made with
+            mat4<Scalar> Hoc;
+            /// The lens that the projection was made with
+            Lens<Scalar> lens;
+            /// The number of nodes in the mesh that was projected
+            size_t n_nodes;
+            /// The projected mesh, its type is determined by the mesh it is stored against
+            std::shared_ptr<const void> projected;
+        };
+
+        struct Speculation {
+            /// The predicted pose that the projection is being made with
+            mat4<Scalar> Hoc;
+            /// The lens that the projection is being made with
+            Lens<Scalar> lens;
+            /// The number of nodes in the mesh that is being projected
+            size_t n_nodes;
+            /// The maximum pixel displacement from the predicted pose for which the projection is used
+            Scalar tolerance;
+            /// The projected mesh once the projection thread has finished
+            std::future<std::shared_ptr<const void>> projected;
+        };
+
+        /// The maximum pixel displacement that will reuse a cached projection
+        Scalar tolerance;
+        /// The most recent projection for each mesh
+        std::map<const void*, Entry> entries;
+        /// Projections for predicted poses that have not been looked up yet
+        std::map<const void*, Speculation> speculations;
+        /// Rejected speculations that may still be running, held so their threads can finish without blocking
+        std::vector<std::future<std::shared_ptr<const void>>> discarded;
+    };
+
+}  // namespace engine
+}  // namespace visualmesh
+
+#endif  // VISUALMESH_ENGINE_PROJECTION_CACHE_HPP
@@ -23,12 +23,20 @@
 
 #include <fstream>
 #include <iomanip>
+#include <memory>
 #include <numeric>
 #include <spirv/unified1/spirv.hpp11>
 #include <sstream>
+#include <string>
 #include <tuple>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
+#include "visualmesh/engine/branching.hpp"
+#include "visualmesh/engine/cpu/project_mesh.hpp"
+#include "visualmesh/engine/label_outputs.hpp"
+#include "visualmesh/engine/projection_cache.hpp"
 #include "visualmesh/engine/vulkan/kernels/load_image.hpp"
 #include "visualmesh/engine/vulkan/kernels/make_network.hpp"
 #include "visualmesh/engine/vulkan/kernels/reprojection.hpp"
@@ -39,9 +47,13 @@
 #include "visualmesh/engine/vulkan/operation/create_image.hpp"
 #include "visualmesh/engine/vulkan/operation/vulkan_error_category.hpp"
 #include "visualmesh/engine/vulkan/operation/wrapper.hpp"
+#include "visualmesh/frame.hpp"
 #include "visualmesh/mesh.hpp"
 #include "visualmesh/network_structure.hpp"
+#include "visualmesh/optimise_network.hpp"
+#include "visualmesh/output_mode.hpp"
 #include "visualmesh/projected_mesh.hpp"
+#include "visualmesh/region_of_interest.hpp"
 #include "visualmesh/utility/math.hpp"
 #include "visualmesh/utility/projection.hpp"
 #include "visualmesh/utility/static_if.hpp"
@@ -67,9 +79,30 @@ namespace engine {
             /**
              * @brief Construct a new Vulkan Engine object
              *
-             * @param structure the network structure to use classification
+             * @param structure the network structure to use classification, simplified with optimise
              */
-            Engine(const NetworkStructure<Scalar>& structure = {}) : max_width(4) {
+            Engine(const NetworkStructure<Scalar>& structure = {})
+              : Engine(std::vector<NetworkStructure<Scalar>>{structure}, {}) {}
+
+            /**
+             * @brief Construct a new Vulkan Engine object that runs a branching network, running its trunk once and
+             * then each of its heads
+             *
+             * @param network the branching network to use for classification, each part simplified with optimise
+             */
+            Engine(const BranchingNetwork<Scalar>& network)
+              : Engine(trunk_and_heads(network), head_names_of(network)) {}
+
+        private:
+            /**
+             * @brief Construct a new Vulkan Engine object from the parts of a network
+             *
+             * @param structures the network structures to use for classification, each simplified with optimise
+             * @param heads      the names of the heads if the first network is the trunk of a branching network and
+             *                   the rest are its heads, otherwise empty
+             */
+            Engine(const std::vector<NetworkStructure<Scalar>>& structures, const std::vector<std::string>& heads)
+              : head_names(heads), max_width(4) {
                 // Get a Vulkan instance
                 const VkApplicationInfo app_info = {
                   VK_STRUCTURE_TYPE_APPLICATION_INFO, 0, "VisualMesh", 0, "", 0, VK_MAKE_VERSION(1, 1, 0)};
@@ -557,57 +590,71 @@ namespace engine {
                   vkCreatePipelineLayout(context.device, &conv_pipeline_layout_info, 0, &conv_pipeline_layout),
                   "Failed to create conv pipeline layout");
 
-                std::vector<std::pair<uint32_t, std::vector<uint32_t>>> conv_sources =
-                  kernels::make_network<Scalar, debug>(structure);
-                for (const auto& conv_source : conv_sources) {
-                    std::string kernel = "conv" + std::to_string(conv_source.first);
-                    if (debug) {
-                        std::ofstream ofs;
-                        ofs.open(kernel + ".spv", std::ios::binary | std::ios::out);
-                        ofs.write(reinterpret_cast<const char*>(conv_source.second.data()),
-                                  conv_source.second.size() * sizeof(uint32_t));
-                        ofs.close();
+                // The heads of a branching network start from the output of the trunk rather than the image
+                uint32_t dimensions = 4;
+                for (unsigned int n = 0; n < structures.size(); ++n) {
+                    // Simplify the network before generating the kernels for it
+                    const NetworkStructure<Scalar> network = optimise(structures[n]);
+                    std::vector<std::pair<uint32_t, std::vector<uint32_t>>> conv_sources =
+                      kernels::make_network<Scalar, debug>(network, dimensions);
+                    conv_layers.emplace_back();
+                    for (const auto& conv_source : conv_sources) {
+                        std::string kernel = "conv" + std::to_string(conv_source.first);
+                        if (debug) {
+                            const std::string file =
+                              structures.size() > 1 ? "net" + std::to_string(n) + "_" + kernel : kernel;
+                            std::ofstream ofs;
+                            ofs.open(file + ".spv", std::ios::binary | std::ios::out);
+                            ofs.write(reinterpret_cast<const char*>(conv_source.second.data()),
+                                      conv_source.second.size() * sizeof(uint32_t));
+                            ofs.close();
+                        }
+
+                        VkShaderModuleCreateInfo conv_info = {
+                          VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+                          nullptr,
+                          0,
+                          static_cast<uint32_t>(conv_source.second.size()) * sizeof(uint32_t),
+                          conv_source.second.data()};
+                        VkShaderModule conv_shader;
+                        throw_vk_error(vkCreateShaderModule(context.device, &conv_info, nullptr, &conv_shader),
+                                       "Failed to create conv shader module");
+                        conv_program.emplace_back(
+                          conv_shader, [this](auto p) { vkDestroyShaderModule(context.device, p, nullptr); });
+
+                        VkComputePipelineCreateInfo conv_pipeline_info = {
+                          VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+                          nullptr,
+                          0,
+                          {VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                           nullptr,
+                           0,
+                           VK_SHADER_STAGE_COMPUTE_BIT,
+                           conv_program.back(),
+                           kernel.c_str(),
+                           0},
+                          conv_pipeline_layout,
+                          0,
+                          0};
+                        VkPipeline pipeline;
+                        throw_vk_error(
+                          vkCreateComputePipelines(context.device, 0, 1, &conv_pipeline_info, 0, &pipeline),
+                          "Failed to create conv pipeline");
+                        conv_layers.back().emplace_back(pipeline, network[conv_source.first].back().biases.size());
                     }
-
-                    VkShaderModuleCreateInfo conv_info = {
-                      VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
-                      nullptr,
-                      0,
-                      static_cast<uint32_t>(conv_source.second.size()) * sizeof(uint32_t),
-                      conv_source.second.data()};
-                    VkShaderModule conv_shader;
-                    throw_vk_error(vkCreateShaderModule(context.device, &conv_info, nullptr, &conv_shader),
-                                   "Failed to create conv shader module");
-                    conv_program.emplace_back(conv_shader,
-                                              [this](auto p) { vkDestroyShaderModule(context.device, p, nullptr); });
-
-                    VkComputePipelineCreateInfo conv_pipeline_info = {
-                      VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
-                      nullptr,
-                      0,
-                      {VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-                       nullptr,
-                       0,
-                       VK_SHADER_STAGE_COMPUTE_BIT,
-                       conv_program.back(),
-                       kernel.c_str(),
-                       0},
-                      conv_pipeline_layout,
-                      0,
-                      0};
-                    VkPipeline pipeline;
-                    throw_vk_error(vkCreateComputePipelines(context.device, 0, 1, &conv_pipeline_info, 0, &pipeline),
-                                   "Failed to create conv pipeline");
-                    conv_layers.emplace_back(pipeline, structure[conv_source.first].back().biases.size());
+                    if (n == 0 && !network.empty()) { dimensions = network.back().back().biases.size(); }
                 }
 
                 // Work out what the widest network layer is
                 max_width = 4;
-                for (const auto& k : conv_layers) {
-                    max_width = std::max(max_width, k.second);
+                for (const auto& network : conv_layers) {
+                    for (const auto& k : network) {
+                        max_width = std::max(max_width, k.second);
+                    }
                 }
             }
 
+        public:
             ~Engine() {
                 vkDestroyDescriptorSetLayout(context.device, reprojection_descriptor_layout, nullptr);
                 vkDestroyPipelineLayout(context.device, reprojection_pipeline_layout, nullptr);
@@ -624,8 +671,10 @@ namespace engine {
 
                 vkDestroyDescriptorSetLayout(context.device, conv_descriptor_layout, nullptr);
                 vkDestroyPipelineLayout(context.device, conv_pipeline_layout, nullptr);
-                for (const auto& layer : conv_layers) {
-                    vkDestroyPipeline(context.device, layer.first, nullptr);
+                for (const auto& network : conv_layers) {
+                    for (const auto& layer : network) {
+                        vkDestroyPipeline(context.device, layer.first, nullptr);
+                    }
                 }
             }
 
@@ -646,6 +695,9 @@ namespace engine {
                                                                                  const Lens<Scalar>& lens) const {
                 static constexpr int N_NEIGHBOURS = Model<Scalar>::N_NEIGHBOURS;
 
+                // If the camera has barely moved since we last projected this mesh reuse that projection
+                if (auto cached = projection_cache.template find<N_NEIGHBOURS>(mesh, Hoc, lens)) { return *cached; }
+
                 std::vector<std::array<int, N_NEIGHBOURS>> neighbourhood;
                 std::vector<int> indices;
                 std::pair<vk::buffer, vk::device_memory> vk_pixels;
@@ -676,8 +728,10 @@ namespace engine {
                 reprojection_descriptor_pool.reset();
                 reprojection_buffers.clear();
 
-                return ProjectedMesh<Scalar, N_NEIGHBOURS>{
+                ProjectedMesh<Scalar, N_NEIGHBOURS> projected{
                   std::move(pixels), std::move(neighbourhood), std::move(indices)};
+                projection_cache.store(mesh, Hoc, lens, projected);
+                return projected;
             }
 
             /**
@@ -698,6 +752,50 @@ namespace engine {
                 return operator()(mesh.height(Hoc[2][3]), Hoc, lens);
             }
 
+            /**
+             * @brief Projects the part of a mesh inside a region of interest to pixel coordinates, along with the rings
+             * of neighbours around it that the network reads from when classifying the points in the region
+             *
+             * @tparam Model the mesh model that we are projecting
+             *
+             * @param mesh   the mesh table that we are projecting to pixel coordinates
+             * @param Hoc    the homogenous transformation matrix from the camera to the observation plane
+             * @param lens   the lens parameters that describe the optics of the camera
+             * @param region the part of the image to project
+             *
+             * @return a projected mesh for the provided arguments
+             */
+            template <template <typename> class Model>
+            inline ProjectedMesh<Scalar, Model<Scalar>::N_NEIGHBOURS> operator()(
+              const Mesh<Scalar, Model>& mesh,
+              const mat4<Scalar>& Hoc,
+              const Lens<Scalar>& lens,
+              const RegionOfInterest<Scalar>& region) const {
+                return cpu::project_region(mesh, Hoc, lens, region, receptive_field());
+            }
+
+            /**
+             * @brief Projects the part of a mesh inside a region of interest to pixel coordinates from an aggregate
+             * VisualMesh object
+             *
+             * @tparam Model the mesh model that we are projecting
+             *
+             * @param mesh   the mesh table that we are projecting to pixel coordinates
+             * @param Hoc    the homogenous transformation matrix from the camera to the observation plane
+             * @param lens   the lens parameters that describe the optics of the camera
+             * @param region the part of the image to project
+             *
+             * @return a projected mesh for the provided arguments
+             */
+            template <template <typename> class Model>
+            inline ProjectedMesh<Scalar, Model<Scalar>::N_NEIGHBOURS> operator()(
+              const VisualMesh<Scalar, Model>& mesh,
+              const mat4<Scalar>& Hoc,
+              const Lens<Scalar>& lens,
+              const RegionOfInterest<Scalar>& region) const {
+                return operator()(mesh.height(Hoc[2][3]), Hoc, lens, region);
+            }
+
             /**
              * @brief Project and classify a mesh using the neural network that is loaded into this engine
              *
@@ -717,6 +815,219 @@ namespace engine {
                                                                            const Lens<Scalar>& lens,
                                                                            const void* image,
                                                                            const uint32_t& format) const {
+                // Reuse the last projection of this mesh if the camera has barely moved
+                return classify_mesh(mesh,
+                                     Hoc,
+                                     lens,
+                                     image,
+                                     format,
+                                     projection_cache.template find<Model<Scalar>::N_NEIGHBOURS>(mesh, Hoc, lens));
+            }
+
+            /**
+             * @brief Project and classify a mesh using the neural network that is loaded into this engine.
+             * This version takes an aggregate VisualMesh object
+             *
+             * @tparam Model the mesh model that we are projecting
+             *
+             * @param mesh    the mesh table that we are projecting to pixel coordinates
+             * @param Hoc     the homogenous transformation matrix from the camera to the observation plane
+             * @param lens    the lens parameters that describe the optics of the camera
+             * @param image   the data that represents the image the network will run from
+             * @param format  the pixel format of this image as a fourcc code
+             *
+             * @return a classified mesh for the provided arguments
+             */
+            template <template <typename> class Model>
+            ClassifiedMesh<Scalar, Model<Scalar>::N_NEIGHBOURS> operator()(const VisualMesh<Scalar, Model>& mesh,
+                                                                           const mat4<Scalar>& Hoc,
+                                                                           const Lens<Scalar>& lens,
+                                                                           const void* image,
+                                                                           const uint32_t& format) const {
+                return operator()(mesh.height(Hoc[2][3]), Hoc, lens, image, format);
+            }
+
+            /**
+             * @brief Project and classify only the part of a mesh inside a region of interest
+             *
+             * @details
+             *  The points in the region are classified along with the rings of neighbours around them that the network
+             *  reads from, so the points in the region get the same classifications as they would from the whole
+             *  image. The rings are kept in the classified mesh, and can be told apart with
+             *  RegionOfInterest::contains(px, Hoc, lens), which checks the distance band as well as the rectangle.
+             *
+             * @tparam Model the mesh model that we are projecting
+             *
+             * @param mesh    the mesh table that we are projecting to pixel coordinates
+             * @param Hoc     the homogenous transformation matrix from the camera to the observation plane
+             * @param lens    the lens parameters that describe the optics of the camera
+             * @param image   the data that represents the image the network will run from
+             * @param format  the pixel format of this image as a fourcc code
+             * @param region  the part of the image to classify
+             *
+             * @return a classified mesh for the provided arguments
+             */
+            template <template <typename> class Model>
+            ClassifiedMesh<Scalar, Model<Scalar>::N_NEIGHBOURS> operator()(
+              const Mesh<Scalar, Model>& mesh,
+              const mat4<Scalar>& Hoc,
+              const Lens<Scalar>& lens,
+              const void* image,
+              const uint32_t& format,
+              const RegionOfInterest<Scalar>& region) const {
+                return classify_mesh(mesh,
+                                     Hoc,
+                                     lens,
+                                     image,
+                                     format,
+                                     std::make_shared<const ProjectedMesh<Scalar, Model<Scalar>::N_NEIGHBOURS>>(
+                                       operator()(mesh, Hoc, lens, region)));
+            }
+
+            /**
+             * @brief Project and classify only the part of a mesh inside a region of interest.
+             * This version takes an aggregate VisualMesh object
+             *
+             * @tparam Model the mesh model that we are projecting
+             *
+             * @param mesh    the mesh table that we are projecting to pixel coordinates
+             * @param Hoc     the homogenous transformation matrix from the camera to the observation plane
+             * @param lens    the lens parameters that describe the optics of the camera
+             * @param image   the data that represents the image the network will run from
+             * @param format  the pixel format of this image as a fourcc code
+             * @param region  the part of the image to classify
+             *
+             * @return a classified mesh for the provided arguments
+             */
+            template <template <typename> class Model>
+            ClassifiedMesh<Scalar, Model<Scalar>::N_NEIGHBOURS> operator()(
+              const VisualMesh<Scalar, Model>& mesh,
+              const mat4<Scalar>& Hoc,
+              const Lens<Scalar>& lens,
+              const void* image,
+              const uint32_t& format,
+              const RegionOfInterest<Scalar>& region) const {
+                return operator()(mesh.height(Hoc[2][3]), Hoc, lens, image, format, region);
+            }
+
+            void clear_cache() {
+                device_points_cache.clear();
+                image_memory.memory           = std::make_pair(nullptr, nullptr);
+                image_memory.dimensions       = {0, 0};
+                image_memory.format           = VK_FORMAT_UNDEFINED;
+                neighbourhood_memory.memory   = std::make_pair(nullptr, nullptr);
+                neighbourhood_memory.max_size = 0;
+                network_memory.memory         = {std::make_pair(nullptr, nullptr), std::make_pair(nullptr, nullptr)};
+                network_memory.max_size       = 0;
+                indices_memory.max_size       = 0;
+                indices_memory.memory         = std::make_pair(nullptr, nullptr);
+                projection_cache.clear();
+            }
+
+            /**
+             * @brief Project and classify several frames.
+             * This engine does not yet join the frames into one network execution, so each frame is run separately
+             *
+             * @tparam Model the mesh model that we are projecting
+             *
+             * @param frames the frames to classify
+             *
+             * @return a classified mesh for each of the frames
+             */
+            template <template <typename> class Model>
+            std::vector<ClassifiedMesh<Scalar, Model<Scalar>::N_NEIGHBOURS>> operator()(
+              const std::vector<Frame<Scalar, Model>>& frames) const {
+                std::vector<ClassifiedMesh<Scalar, Model<Scalar>::N_NEIGHBOURS>> classified;
+                classified.reserve(frames.size());
+                for (const auto& frame : frames) {
+                    classified.push_back(operator()(*frame.mesh, frame.Hoc, frame.lens, frame.image, frame.format));
+                }
+                return classified;
+            }
+
+            /**
+             * @brief Starts projecting a mesh on another thread for a camera pose that is expected in the future.
+             * The next projection or classification of this mesh uses this result if the actual pose is within the
+             * tolerance of the prediction, otherwise the projection is recomputed.
+             * The mesh must stay alive until the speculation has been used.
+             *
+             * @tparam Model the mesh model that we are projecting
+             *
+             * @param mesh      the mesh table that we are projecting to pixel coordinates
+             * @param Hoc       the predicted homogenous transformation matrix from the camera to the observation plane
+             * @param lens      the lens parameters that describe the optics of the camera
+             * @param tolerance the largest pixel displacement from the predicted pose for which the result is used
+             */
+            template <template <typename> class Model>
+            void speculate(const Mesh<Scalar, Model>& mesh,
+                           const mat4<Scalar>& Hoc,
+                           const Lens<Scalar>& lens,
+                           const Scalar& tolerance) const {
+                projection_cache.template speculate<Model<Scalar>::N_NEIGHBOURS>(
+                  mesh, Hoc, lens, tolerance, &cpu::project_mesh<Scalar, Model>);
+            }
+
+            /**
+             * @brief Starts projecting a mesh on another thread for a camera pose that is expected in the future.
+             * This version takes an aggregate VisualMesh object
+             *
+             * @tparam Model the mesh model that we are projecting
+             *
+             * @param mesh      the mesh table that we are projecting to pixel coordinates
+             * @param Hoc       the predicted homogenous transformation matrix from the camera to the observation plane
+             * @param lens      the lens parameters that describe the optics of the camera
+             * @param tolerance the largest pixel displacement from the predicted pose for which the result is used
+             */
+            template <template <typename> class Model>
+            void speculate(const VisualMesh<Scalar, Model>& mesh,
+                           const mat4<Scalar>& Hoc,
+                           const Lens<Scalar>& lens,
+                           const Scalar& tolerance) const {
+                speculate(mesh.height(Hoc[2][3]), Hoc, lens, tolerance);
+            }
+
+            /**
+             * @brief Reuse the previous projection of a mesh while the camera moves less than a number of pixels
+             *
+             * @param tolerance the largest pixel displacement for which a projection is reused, 0 disables reuse
+             */
+            void set_projection_tolerance(const Scalar& tolerance) {
+                projection_cache.set_tolerance(tolerance);
+            }
+
+            /**
+             * @brief Choose what is given back for each point. In the label modes each point is labelled as it is read
+             * from the mapped output of the network, so the full output is never copied.
+             *
+             * @param mode the output mode to use, CLASSIFICATIONS gives the full output of the network
+             */
+            void set_output_mode(const OutputMode& mode) {
+                output_mode = mode;
+            }
+
+        private:
+            /**
+             * @brief Classify a mesh using the neural network that is loaded into this engine
+             *
+             * @tparam Model the mesh model that we are projecting
+             *
+             * @param mesh        the mesh table that we are projecting to pixel coordinates
+             * @param Hoc         the homogenous transformation matrix from the camera to the observation plane
+             * @param lens        the lens parameters that describe the optics of the camera
+             * @param image       the data that represents the image the network will run from
+             * @param format      the pixel format of this image as a fourcc code
+             * @param projection  an existing projection of the mesh to use, or null to project it on the device
+             *
+             * @return a classified mesh for the provided arguments
+             */
+            template <template <typename> class Model>
+            ClassifiedMesh<Scalar, Model<Scalar>::N_NEIGHBOURS> classify_mesh(
+              const Mesh<Scalar, Model>& mesh,
+              const mat4<Scalar>& Hoc,
+              const Lens<Scalar>& lens,
+              const void* image,
+              const uint32_t& format,
+              const std::shared_ptr<const ProjectedMesh<Scalar, Model<Scalar>::N_NEIGHBOURS>>& projection) const {
                 static constexpr int N_NEIGHBOURS = Model<Scalar>::N_NEIGHBOURS;
 
                 std::vector<std::pair<vk::semaphore, VkPipelineStageFlags>> wait_semaphores;
@@ -729,8 +1040,13 @@ namespace engine {
                 std::vector<int> indices;
                 std::pair<vk::buffer, vk::device_memory> vk_pixels;
                 vk::semaphore reprojection_semaphore;
+                // Use the projection we were given, otherwise project the mesh on the device
                 std::tie(neighbourhood, indices, vk_pixels, reprojection_semaphore) =
-                  do_project<Model, vk::semaphore>(mesh, Hoc, lens);
+                  projection ? upload_projection<N_NEIGHBOURS, vk::semaphore>(*projection)
+                             : do_project<Model, vk::semaphore>(mesh, Hoc, lens);
+
+                // If there were no points, nothing to classify
+                if (indices.empty()) { return ClassifiedMesh<Scalar, N_NEIGHBOURS>(); }
 
                 wait_semaphores.push_back(std::make_pair(reprojection_semaphore, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT));
 
@@ -845,172 +1161,350 @@ namespace engine {
                 // *** RUN NETWORK ***
                 // *******************
 
-                // Create a descriptor pool
-                // Descriptor Set 0: {neighbourhood_ptr, input_ptr, output_ptr}
-                std::vector<VkDescriptorPoolSize> conv_pool_size = {
-                  VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3},
-                };
-                vk::descriptor_pool conv_layer_pool =
-                  operation::create_descriptor_pool(context, conv_pool_size, conv_layers.size());
+                vk_conv_input = run_network(
+                  conv_layers.front(), vk_neighbourhood, vk_conv_input, vk_conv_output, n_points, wait_semaphores);
 
-                // Allocate the descriptor set
-                std::vector<VkDescriptorSet> conv_descriptor_sets = operation::create_descriptor_set(
-                  context,
-                  conv_layer_pool,
-                  std::vector<VkDescriptorSetLayout>(conv_layers.size(), conv_descriptor_layout));
-
-                std::vector<std::array<VkDescriptorBufferInfo, 3>> conv_buffer_infos;
-                std::vector<std::array<VkWriteDescriptorSet, 3>> conv_write_descriptors;
-                std::vector<vk::command_buffer> conv_command_buffers;
-                vk::fence fence;
-                for (size_t conv_no = 0; conv_no < conv_layers.size(); ++conv_no) {
-                    auto& conv = conv_layers[conv_no];
-
-                    // Load the arguments
-                    std::array<VkDescriptorBufferInfo, 3> buffer_infos = {
-                      VkDescriptorBufferInfo{vk_neighbourhood.first, 0, VK_WHOLE_SIZE},
-                      VkDescriptorBufferInfo{vk_conv_input.first, 0, VK_WHOLE_SIZE},
-                      VkDescriptorBufferInfo{vk_conv_output.first, 0, VK_WHOLE_SIZE}};
-                    conv_buffer_infos.push_back(buffer_infos);
-
-                    std::array<VkWriteDescriptorSet, 3> write_descriptors;
-                    for (size_t i = 0; i < buffer_infos.size(); ++i) {
-                        write_descriptors[i] = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-                                                nullptr,
-                                                conv_descriptor_sets[conv_no],
-                                                static_cast<uint32_t>(i),
-                                                0,
-                                                1,
-                                                VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
-                                                nullptr,
-                                                &conv_buffer_infos.back()[i],
-                                                nullptr};
+                // ************************
+                // *** RETRIEVE RESULTS ***
+                // ************************
+
+                // Read the pixels off the buffer
+                std::vector<vec2<Scalar>> pixels(neighbourhood.size() - 1);
+                operation::map_memory<void>(context, 0, VK_WHOLE_SIZE, vk_pixels.second, [&pixels](void* payload) {
+                    std::memcpy(pixels.data(), payload, pixels.size() * sizeof(vec2<Scalar>));
+                });
+
+                // Read the classifications off the device (they'll be in input), or run the heads from it if branching
+                ClassifiedMesh<Scalar, N_NEIGHBOURS> classified;
+                if (head_names.empty() && output_mode != OutputMode::CLASSIFICATIONS) {
+                    // Label each point straight out of the mapped memory rather than copying the whole output
+                    const unsigned int dimensions = conv_layers.front().back().second;
+                    classified.labels.resize(neighbourhood.size());
+                    if (output_mode == OutputMode::LABELS_AND_CONFIDENCE) {
+                        classified.confidence.resize(neighbourhood.size());
                     }
-                    conv_write_descriptors.push_back(write_descriptors);
+                    operation::map_memory<void>(
+                      context, 0, VK_WHOLE_SIZE, vk_conv_input.second, [&classified, &dimensions](void* payload) {
+                          const Scalar* values = reinterpret_cast<const Scalar*>(payload);
+                          for (unsigned int i = 0; i < classified.labels.size(); ++i) {
+                              label_point(values + i * dimensions,
+                                          dimensions,
+                                          false,
+                                          classified.labels[i],
+                                          classified.confidence.empty() ? nullptr : &classified.confidence[i]);
+                          }
+                      });
+                }
+                else if (head_names.empty()) {
+                    classified.classifications.resize(neighbourhood.size() * conv_layers.front().back().second);
+                    operation::map_memory<void>(
+                      context, 0, VK_WHOLE_SIZE, vk_conv_input.second, [&classified](void* payload) {
+                          std::memcpy(classified.classifications.data(),
+                                      payload,
+                                      classified.classifications.size() * sizeof(Scalar));
+                      });
+                }
+                else {
+                    const auto outputs = classify_heads(vk_neighbourhood, vk_conv_input, n_points);
+                    assign_heads(head_names, outputs, 0, n_points, classified);
+                    assign_labels(output_mode, outputs.front().second, classified);
+                }
 
-                    vkUpdateDescriptorSets(
-                      context.device, write_descriptors.size(), write_descriptors.data(), 0, nullptr);
+                // Remember this projection so it can be reused while the camera is still
+                if (!projection && projection_cache.enabled()) {
+                    projection_cache.store(
+                      mesh, Hoc, lens, ProjectedMesh<Scalar, N_NEIGHBOURS>{pixels, neighbourhood, indices});
+                }
 
-                    // Project!
-                    conv_command_buffers.push_back(
-                      operation::create_command_buffer(context, context.compute_command_pool, true));
+                classified.pixel_coordinates = std::move(pixels);
+                classified.neighbourhood     = std::move(neighbourhood);
+                classified.global_indices    = std::move(indices);
+                return classified;
+            }
 
-                    vkCmdBindPipeline(conv_command_buffers.back(), VK_PIPELINE_BIND_POINT_COMPUTE, conv.first);
+            /**
+             * @brief The number of rings of neighbours the loaded network reads from to classify a single point
+             *
+             * @return the number of graph convolutions between the input and the deepest output
+             */
+            int receptive_field() const {
+                // Independent networks each read their own neighbourhood, so the deepest of them is the furthest read
+                if (head_names.empty()) {
+                    int depth = 0;
+                    for (const auto& network : conv_layers) {
+                        depth = std::max(depth, int(network.size()));
+                    }
+                    return depth;
+                }
 
-                    vkCmdBindDescriptorSets(conv_command_buffers.back(),
-                                            VK_PIPELINE_BIND_POINT_COMPUTE,
-                                            conv_pipeline_layout,
-                                            0,
-                                            1,
-                                            &conv_descriptor_sets[conv_no],
-                                            0,
-                                            nullptr);
+                // The heads of a branching network all continue from the output of the trunk
+                int heads = 0;
+                for (std::size_t i = 1; i < conv_layers.size(); ++i) {
+                    heads = std::max(heads, int(conv_layers[i].size()));
+                }
+                return int(conv_layers.front().size()) + heads;
+            }
 
-                    vkCmdDispatch(conv_command_buffers.back(), static_cast<uint32_t>(n_points), 1, 1);
+            /**
+             * @brief Runs each of the convolution kernels of a network over the points and waits for them to finish
+             *
+             * @param network          the pipelines for the layers of the network and the width of their outputs
+             * @param vk_neighbourhood the neighbourhood graph of the points, including the offscreen point
+             * @param vk_conv_input    the buffer holding the input values for each point
+             * @param vk_conv_output   a second buffer of the same size to ping pong the layers between
+             * @param n_points         the number of points to classify, including the offscreen point
+             * @param wait_semaphores  the semaphores whose last entry the network must wait on, empty to not wait
+             *
+             * @return the buffer holding the output of the network
+             */
+            std::pair<vk::buffer, vk::device_memory> run_network(
+              const std::vector<std::pair<VkPipeline, size_t>>& network,
+              const std::pair<vk::buffer, vk::device_memory>& vk_neighbourhood,
+              std::pair<vk::buffer, vk::device_memory> vk_conv_input,
+              std::pair<vk::buffer, vk::device_memory> vk_conv_output,
+              const int& n_points,
+              std::vector<std::pair<vk::semaphore, VkPipelineStageFlags>> wait_semaphores) const {
+
+                if (network.empty()) { return vk_conv_input; }
+
+                // Only the most recent semaphore needs to be waited on, and the heads don't wait on anything
+                auto wait_for = [](const std::vector<std::pair<vk::semaphore, VkPipelineStageFlags>>& semaphores) {
+                    return semaphores.empty() ? std::vector<std::pair<vk::semaphore, VkPipelineStageFlags>>{}
+                                              : std::vector<std::pair<vk::semaphore, VkPipelineStageFlags>>{
+                                                semaphores.back()};
+                };
 
-                    VkSemaphoreCreateInfo semaphore_info = {VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO, nullptr, 0};
-                    VkSemaphore semaphore;
-                    throw_vk_error(vkCreateSemaphore(context.device, &semaphore_info, nullptr, &semaphore),
-                                   "Failed to create conv layer semaphore");
-                    vk::semaphore conv_layer_semaphore =
-                      vk::semaphore(semaphore, [this](auto p) { vkDestroySemaphore(context.device, p, nullptr); });
+                    // Create a descriptor pool
+                    // Descriptor Set 0: {neighbourhood_ptr, input_ptr, output_ptr}
+                    std::vector<VkDescriptorPoolSize> conv_pool_size = {
+                      VkDescriptorPoolSize{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3},
+                    };
+                    vk::descriptor_pool conv_layer_pool =
+                      operation::create_descriptor_pool(context, conv_pool_size, network.size());
 
-                    if (conv_no + 1 == conv_layers.size()) {
-                        VkFence f;
-                        VkFenceCreateInfo fence_info = {VK_STRUCTURE_TYPE_FENCE_CREATE_INFO, nullptr, 0};
-                        throw_vk_error(vkCreateFence(context.device, &fence_info, nullptr, &f),
-                                       "Failed to create reprojection semaphore");
-                        fence = vk::fence(f, [this](auto p) { vkDestroyFence(context.device, p, nullptr); });
-                        operation::submit_command_buffer(
-                          context.compute_queue, conv_command_buffers.back(), fence, {wait_semaphores.back()});
-                    }
-                    else {
-                        operation::submit_command_buffer(context.compute_queue,
-                                                         conv_command_buffers.back(),
-                                                         {wait_semaphores.back()},
-                                                         {conv_layer_semaphore});
+                    // Allocate the descriptor set
+                    std::vector<VkDescriptorSet> conv_descriptor_sets = operation::create_descriptor_set(
+                      context,
+                      conv_layer_pool,
+                      std::vector<VkDescriptorSetLayout>(network.size(), conv_descriptor_layout));
+
+                    std::vector<std::array<VkDescriptorBufferInfo, 3>> conv_buffer_infos;
+                    std::vector<std::array<VkWriteDescriptorSet, 3>> conv_write_descriptors;
+                    std::vector<vk::command_buffer> conv_command_buffers;
+                    vk::fence fence;
+                    for (size_t conv_no = 0; conv_no < network.size(); ++conv_no) {
+                        auto& conv = network[conv_no];
+
+                        // Load the arguments
+                        std::array<VkDescriptorBufferInfo, 3> buffer_infos = {
+                          VkDescriptorBufferInfo{vk_neighbourhood.first, 0, VK_WHOLE_SIZE},
+                          VkDescriptorBufferInfo{vk_conv_input.first, 0, VK_WHOLE_SIZE},
+                          VkDescriptorBufferInfo{vk_conv_output.first, 0, VK_WHOLE_SIZE}};
+                        conv_buffer_infos.push_back(buffer_infos);
+
+                        std::array<VkWriteDescriptorSet, 3> write_descriptors;
+                        for (size_t i = 0; i < buffer_infos.size(); ++i) {
+                            write_descriptors[i] = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                                                    nullptr,
+                                                    conv_descriptor_sets[conv_no],
+                                                    static_cast<uint32_t>(i),
+                                                    0,
+                                                    1,
+                                                    VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                                                    nullptr,
+                                                    &conv_buffer_infos.back()[i],
+                                                    nullptr};
+                        }
+                        conv_write_descriptors.push_back(write_descriptors);
+
+                        vkUpdateDescriptorSets(
+                          context.device, write_descriptors.size(), write_descriptors.data(), 0, nullptr);
+
+                        // Project!
+                        conv_command_buffers.push_back(
+                          operation::create_command_buffer(context, context.compute_command_pool, true));
+
+                        vkCmdBindPipeline(conv_command_buffers.back(), VK_PIPELINE_BIND_POINT_COMPUTE, conv.first);
+
+                        vkCmdBindDescriptorSets(conv_command_buffers.back(),
+                                                VK_PIPELINE_BIND_POINT_COMPUTE,
+                                                conv_pipeline_layout,
+                                                0,
+                                                1,
+                                                &conv_descriptor_sets[conv_no],
+                                                0,
+                                                nullptr);
+
+                        vkCmdDispatch(conv_command_buffers.back(), static_cast<uint32_t>(n_points), 1, 1);
+
+                        VkSemaphoreCreateInfo semaphore_info = {VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO, nullptr, 0};
+                        VkSemaphore semaphore;
+                        throw_vk_error(vkCreateSemaphore(context.device, &semaphore_info, nullptr, &semaphore),
+                                       "Failed to create conv layer semaphore");
+                        vk::semaphore conv_layer_semaphore =
+                          vk::semaphore(semaphore, [this](auto p) { vkDestroySemaphore(context.device, p, nullptr); });
+
+                        if (conv_no + 1 == network.size()) {
+                            VkFence f;
+                            VkFenceCreateInfo fence_info = {VK_STRUCTURE_TYPE_FENCE_CREATE_INFO, nullptr, 0};
+                            throw_vk_error(vkCreateFence(context.device, &fence_info, nullptr, &f),
+                                           "Failed to create reprojection semaphore");
+                            fence = vk::fence(f, [this](auto p) { vkDestroyFence(context.device, p, nullptr); });
+                            operation::submit_command_buffer(
+                              context.compute_queue, conv_command_buffers.back(), fence, wait_for(wait_semaphores));
+                        }
+                        else {
+                            operation::submit_command_buffer(context.compute_queue,
+                                                             conv_command_buffers.back(),
+                                                             wait_for(wait_semaphores),
+                                                             {conv_layer_semaphore});
+                        }
+
+                        wait_semaphores.push_back(
+                          std::make_pair(conv_layer_semaphore, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT));
+
+                        // Convert our events into a vector of events and ping pong our buffers
+                        std::swap(vk_conv_input, vk_conv_output);
                     }
 
-                    wait_semaphores.push_back(std::make_pair(conv_layer_semaphore, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT));
+                    // Wait 10,000 * 1,000 nanoseconds = 10,000 * 1us = 10ms
+                    VkResult res;
+                    VkFence vk_fence = fence;
+                    for (uint32_t timeout_count = 0; timeout_count < 10000; ++timeout_count) {
+                        res = vkWaitForFences(context.device, 1, &vk_fence, VK_TRUE, static_cast<uint64_t>(1e3));
+                        if (res == VK_SUCCESS) { break; }
+                        else if (res == VK_ERROR_DEVICE_LOST) {
+                            throw_vk_error(VK_ERROR_DEVICE_LOST, "Lost device while waiting for network to complete");
+                        }
+                    }
+                    if (res != VK_SUCCESS) { throw_vk_error(res, "Timed out waiting for network to complete"); }
 
-                    // Convert our events into a vector of events and ping pong our buffers
-                    std::swap(vk_conv_input, vk_conv_output);
-                }
+                return vk_conv_input;
+            }
 
-                // ***************************
-                // *** WAIT FOR COMPLETION ***
-                // ***************************
+            /**
+             * @brief Runs each head of a branching network from the output of its trunk
+             *
+             * @details The ping pong buffers are reused by every head, so the trunk output is kept in host memory and
+             * copied back in before each head runs
+             *
+             * @param vk_neighbourhood the neighbourhood graph of the points, including the offscreen point
+             * @param vk_trunk_output  the buffer holding the output of the trunk
+             * @param n_points         the number of points to classify, including the offscreen point
+             *
+             * @return the output of each head along with how many values each point has in it
+             */
+            std::vector<std::pair<std::vector<Scalar>, unsigned int>> classify_heads(
+              const std::pair<vk::buffer, vk::device_memory>& vk_neighbourhood,
+              const std::pair<vk::buffer, vk::device_memory>& vk_trunk_output,
+              const int& n_points) const {
+
+                const size_t trunk_dimensions = conv_layers.front().empty() ? 4 : conv_layers.front().back().second;
+                std::vector<Scalar> trunk(n_points * trunk_dimensions);
+                operation::map_memory<void>(context, 0, VK_WHOLE_SIZE, vk_trunk_output.second, [&trunk](void* payload) {
+                    std::memcpy(trunk.data(), payload, trunk.size() * sizeof(Scalar));
+                });
 
-                // Wait 10,000 * 1,000 nanoseconds = 10,000 * 1us = 10ms
-                VkResult res;
-                VkFence vk_fence = fence;
-                for (uint32_t timeout_count = 0; timeout_count < 10000; ++timeout_count) {
-                    res = vkWaitForFences(context.device, 1, &vk_fence, VK_TRUE, static_cast<uint64_t>(1e3));
-                    if (res == VK_SUCCESS) { break; }
-                    else if (res == VK_ERROR_DEVICE_LOST) {
-                        throw_vk_error(VK_ERROR_DEVICE_LOST, "Lost device while waiting for network to complete");
-                    }
+                auto vk_conv_mem = get_network_memory(max_width * n_points);
+                std::vector<std::pair<std::vector<Scalar>, unsigned int>> outputs;
+                for (unsigned int head = 1; head < conv_layers.size(); ++head) {
+                    operation::map_memory<void>(
+                      context, 0, VK_WHOLE_SIZE, vk_conv_mem[0].second, [&trunk](void* payload) {
+                          std::memcpy(payload, trunk.data(), trunk.size() * sizeof(Scalar));
+                      });
+                    auto vk_output =
+                      run_network(conv_layers[head], vk_neighbourhood, vk_conv_mem[0], vk_conv_mem[1], n_points, {});
+
+                    const unsigned int dimensions = conv_layers[head].back().second;
+                    std::vector<Scalar> output(n_points * dimensions);
+                    operation::map_memory<void>(context, 0, VK_WHOLE_SIZE, vk_output.second, [&output](void* payload) {
+                        std::memcpy(output.data(), payload, output.size() * sizeof(Scalar));
+                    });
+                    outputs.emplace_back(std::move(output), dimensions);
                 }
-                if (res != VK_SUCCESS) { throw_vk_error(res, "Timed out waiting for network to complete"); }
+                return outputs;
+            }
 
-                // ************************
-                // *** RETRIEVE RESULTS ***
-                // ************************
+            /**
+             * @brief Uploads the pixel coordinates of a cached projection so it can be used in place of do_project
+             *
+             * @tparam N_NEIGHBOURS   the number of neighbours that each point has
+             * @tparam CheckpointType either vk::fence or vk::semaphore, as for do_project
+             *
+             * @param projected the cached projection to upload
+             *
+             * @return the same values as do_project would have returned for this projection
+             */
+            template <int N_NEIGHBOURS, typename CheckpointType>
+            std::tuple<std::vector<std::array<int, N_NEIGHBOURS>>,
+                       std::vector<int>,
+                       std::pair<vk::buffer, vk::device_memory>,
+                       CheckpointType>
+              upload_projection(const ProjectedMesh<Scalar, N_NEIGHBOURS>& projected) const {
 
-                // Read the pixels off the buffer
-                std::vector<vec2<Scalar>> pixels(neighbourhood.size() - 1);
-                operation::map_memory<void>(context, 0, VK_WHOLE_SIZE, vk_pixels.second, [&pixels](void* payload) {
-                    std::memcpy(pixels.data(), payload, pixels.size() * sizeof(vec2<Scalar>));
-                });
+                const int points = projected.global_indices.size();
+                if (points == 0) {
+                    return std::make_tuple(std::vector<std::array<int, N_NEIGHBOURS>>(),
+                                           std::vector<int>(),
+                                           std::pair<vk::buffer, vk::device_memory>(),
+                                           CheckpointType());
+                }
 
-                // Read the classifications off the device (they'll be in input)
-                std::vector<Scalar> classifications(neighbourhood.size() * conv_layers.back().second);
+                // The pixel buffer is host coherent so the cached pixels are visible as soon as they are copied
+                std::pair<vk::buffer, vk::device_memory> vk_pixels =
+                  operation::create_buffer(context,
+                                           sizeof(vec2<Scalar>) * points,
+                                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                           VK_SHARING_MODE_EXCLUSIVE,
+                                           {context.transfer_queue_family},
+                                           VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
                 operation::map_memory<void>(
-                  context, 0, VK_WHOLE_SIZE, vk_conv_input.second, [&classifications](void* payload) {
-                      std::memcpy(classifications.data(), payload, classifications.size() * sizeof(Scalar));
+                  context, 0, VK_WHOLE_SIZE, vk_pixels.second, [&projected](void* payload) {
+                      std::memcpy(payload,
+                                  projected.pixel_coordinates.data(),
+                                  projected.pixel_coordinates.size() * sizeof(vec2<Scalar>));
                   });
+                operation::bind_buffer(context, vk_pixels.first, vk_pixels.second, 0);
 
-                return ClassifiedMesh<Scalar, N_NEIGHBOURS>{
-                  std::move(pixels), std::move(neighbourhood), std::move(indices), std::move(classifications)};
+                // Submit an empty command buffer so the checkpoint is signalled the same way as a real projection
+                reprojection_command_buffer =
+                  operation::create_command_buffer(context, context.compute_command_pool, true);
+                CheckpointType checkpoint = submit_reprojection<CheckpointType>();
+
+                return std::make_tuple(
+                  projected.neighbourhood, projected.global_indices, std::move(vk_pixels), std::move(checkpoint));
             }
 
             /**
-             * @brief Project and classify a mesh using the neural network that is loaded into this engine.
-             * This version takes an aggregate VisualMesh object
+             * @brief Submits the reprojection command buffer to the compute queue
              *
-             * @tparam Model the mesh model that we are projecting
+             * @tparam CheckpointType vk::fence if the CPU will wait on the result, vk::semaphore if the GPU will
              *
-             * @param mesh    the mesh table that we are projecting to pixel coordinates
-             * @param Hoc     the homogenous transformation matrix from the camera to the observation plane
-             * @param lens    the lens parameters that describe the optics of the camera
-             * @param image   the data that represents the image the network will run from
-             * @param format  the pixel format of this image as a fourcc code
-             *
-             * @return a classified mesh for the provided arguments
+             * @return the checkpoint that is signalled when the reprojection command buffer has completed
              */
-            template <template <typename> class Model>
-            ClassifiedMesh<Scalar, Model<Scalar>::N_NEIGHBOURS> operator()(const VisualMesh<Scalar, Model>& mesh,
-                                                                           const mat4<Scalar>& Hoc,
-                                                                           const Lens<Scalar>& lens,
-                                                                           const void* image,
-                                                                           const uint32_t& format) const {
-                return operator()(mesh.height(Hoc[2][3]), Hoc, lens, image, format);
-            }
-
-            void clear_cache() {
-                device_points_cache.clear();
-                image_memory.memory           = std::make_pair(nullptr, nullptr);
-                image_memory.dimensions       = {0, 0};
-                image_memory.format           = VK_FORMAT_UNDEFINED;
-                neighbourhood_memory.memory   = std::make_pair(nullptr, nullptr);
-                neighbourhood_memory.max_size = 0;
-                network_memory.memory         = {std::make_pair(nullptr, nullptr), std::make_pair(nullptr, nullptr)};
-                network_memory.max_size       = 0;
-                indices_memory.max_size       = 0;
-                indices_memory.memory         = std::make_pair(nullptr, nullptr);
+            template <typename CheckpointType>
+            CheckpointType submit_reprojection() const {
+                CheckpointType checkpoint;
+                static_if<std::is_same<CheckpointType, vk::semaphore>::value>([&](auto f) {
+                    VkSemaphore semaphore;
+                    VkSemaphoreCreateInfo semaphore_info = {VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO, nullptr, 0};
+                    throw_vk_error(vkCreateSemaphore(context.device, &semaphore_info, nullptr, &semaphore),
+                                   "Failed to create reprojection semaphore");
+                    f(checkpoint) =
+                      vk::semaphore(semaphore, [this](auto p) { vkDestroySemaphore(context.device, p, nullptr); });
+                    operation::submit_command_buffer(
+                      context.compute_queue, reprojection_command_buffer, {}, {f(checkpoint)});
+                }).else_([&](auto f) {
+                    VkFence fence;
+                    VkFenceCreateInfo fence_info = {VK_STRUCTURE_TYPE_FENCE_CREATE_INFO, nullptr, 0};
+                    throw_vk_error(vkCreateFence(context.device, &fence_info, nullptr, &fence),
+                                   "Failed to create reprojection semaphore");
+                    f(checkpoint) = vk::fence(fence, [this](auto p) { vkDestroyFence(context.device, p, nullptr); });
+                    operation::submit_command_buffer(context.compute_queue, reprojection_command_buffer, f(checkpoint));
+                });
+                return checkpoint;
             }
 
-        private:
             template <template <typename> class Model, typename CheckpointType>
             std::tuple<std::vector<std::array<int, Model<Scalar>::N_NEIGHBOURS>>,
                        std::vector<int>,
@@ -1273,24 +1767,7 @@ namespace engine {
 
                 vkCmdDispatch(reprojection_command_buffer, static_cast<int32_t>(points), 1, 1);
 
-                CheckpointType checkpoint;
-                static_if<std::is_same<CheckpointType, vk::semaphore>::value>([&](auto f) {
-                    VkSemaphore semaphore;
-                    VkSemaphoreCreateInfo semaphore_info = {VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO, nullptr, 0};
-                    throw_vk_error(vkCreateSemaphore(context.device, &semaphore_info, nullptr, &semaphore),
-                                   "Failed to create reprojection semaphore");
-                    f(checkpoint) =
-                      vk::semaphore(semaphore, [this](auto p) { vkDestroySemaphore(context.device, p, nullptr); });
-                    operation::submit_command_buffer(
-                      context.compute_queue, reprojection_command_buffer, {}, {f(checkpoint)});
-                }).else_([&](auto f) {
-                    VkFence fence;
-                    VkFenceCreateInfo fence_info = {VK_STRUCTURE_TYPE_FENCE_CREATE_INFO, nullptr, 0};
-                    throw_vk_error(vkCreateFence(context.device, &fence_info, nullptr, &fence),
-                                   "Failed to create reprojection semaphore");
-                    f(checkpoint) = vk::fence(fence, [this](auto p) { vkDestroyFence(context.device, p, nullptr); });
-                    operation::submit_command_buffer(context.compute_queue, reprojection_command_buffer, f(checkpoint));
-                });
+                CheckpointType checkpoint = submit_reprojection<CheckpointType>();
 
                 // This can happen on the CPU while the Vulkan device is busy
                 // Build the reverse lookup map where the offscreen point is one past the end
@@ -1509,6 +1986,9 @@ namespace engine {
             mutable vk::descriptor_pool reprojection_descriptor_pool;
             /// Reusable command buffer for the reprojection pipelines
             mutable vk::command_buffer reprojection_command_buffer;
+
+            /// The most recent projection of each mesh so stationary cameras can skip projection
+            mutable ProjectionCache<Scalar> projection_cache;
             /// Memory buffers for the reprojection pipelines
             mutable std::map<std::string, std::pair<vk::buffer, vk::device_memory>> reprojection_buffers;
 
@@ -1538,8 +2018,12 @@ namespace engine {
             VkPipelineLayout conv_pipeline_layout;
             /// Shader module for the network
             std::vector<vk::shader_module> conv_program;
-            /// A list of kernels to run in sequence to run the network
-            std::vector<std::pair<VkPipeline, size_t>> conv_layers;
+            /// A list of kernels to run in sequence for each network, the trunk and then the heads when branching
+            std::vector<std::vector<std::pair<VkPipeline, size_t>>> conv_layers;
+            /// The names of the heads of a branching network, empty when the engine runs a single network
+            std::vector<std::string> head_names;
+            /// What is given back for each point of a classified mesh
+            OutputMode output_mode = OutputMode::CLASSIFICATIONS;
 
             mutable struct {
                 vec2<int> dimensions = {0, 0};
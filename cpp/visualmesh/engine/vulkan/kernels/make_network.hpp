@@ -37,25 +37,30 @@ namespace engine {
              *
              * @tparam Scalar the scalar type used for calculations and storage (normally one of float or double)
              *
-             * @param structure the network structure to generate the kernels from
+             * @param structure  the network structure to generate the kernels from
+             * @param dimensions the number of values each point starts with, 4 for the image or the output width of
+             *                   the trunk for the head of a branching network
              *
              * @return the SPIRV source code for the kernels to be built
              */
             template <typename Scalar, bool debug>
             std::vector<std::pair<uint32_t, std::vector<uint32_t>>> make_network(
-              const NetworkStructure<Scalar>& structure) {
+              const NetworkStructure<Scalar>& structure,
+              const uint32_t& dimensions = 4) {
                 std::vector<std::pair<uint32_t, std::vector<uint32_t>>> programs;
 
                 // If our structure has no layers, return empty code
                 if (structure.empty() || structure.front().empty()) { return programs; }
 
                 // Keep track of the input and output size of each layer for building the network
-                // The first layer input is always 4 from the image
-                uint32_t input_dimensions  = 4;
+                // The first layer input is 4 from the image, or the output of the trunk for a head
+                uint32_t input_dimensions  = dimensions;
                 uint32_t output_dimensions = 0;
 
-                // First layer has 4 inputs, so that tells us how many neighbours we have (minus ourself)
-                const uint32_t n_neighbours = (structure.front().front().weights.size() / 4) - 1;
+                // First layer has dimensions inputs, so that tells us how many neighbours we have (minus ourself)
+                const auto& first           = structure.front().front();
+                const uint32_t n_neighbours = first.depthwise.empty() ? (first.weights.size() / dimensions) - 1
+                                                                      : first.depthwise.size() - 1;
 
                 for (uint32_t conv_no = 0; conv_no < structure.size(); ++conv_no) {
                     auto& conv = structure[conv_no];
@@ -140,6 +145,19 @@ namespace engine {
                         spv::StorageClass::Function),
                       compose_string<debug>("in0[{}]", input_dimensions * (n_neighbours + 1))));
 
+                    // Depthwise separable groups sum each channel of in0 over the neighbourhood into another array
+                    const auto& depthwise = conv.front().depthwise;
+                    uint32_t summed       = 0;
+                    if (!depthwise.empty()) {
+                        summed = program.add_name(
+                          program.add_variable(
+                            program.add_pointer(
+                              program.add_array_type(float_type, program.add_constant(uint_type, {input_dimensions})),
+                              spv::StorageClass::Function),
+                            spv::StorageClass::Function),
+                          compose_string<debug>("summed[{}]", input_dimensions));
+                    }
+
                     program.add_source_line(__FILE__, __LINE__, conv_no);
 
                     for (uint32_t layer_no = 0; layer_no < conv.size(); ++layer_no) {
@@ -265,8 +283,50 @@ namespace engine {
 
                     program.add_source_line(__FILE__, __LINE__, conv_no);
 
-                    // We have gathered which increased the size of the input
-                    input_dimensions = input_dimensions * (n_neighbours + 1);
+                    if (!depthwise.empty()) {
+                        // summed[j] = sum over i of in0[i * input_dimensions + j] * depthwise[i][j]
+                        for (uint32_t j = 0; j < input_dimensions; ++j) {
+                            uint32_t total_val = program.add_constant(float_type, {Scalar(0)});
+                            for (uint32_t i = 0; i < n_neighbours + 1; ++i) {
+                                // Pruned depthwise weights are left out entirely
+                                if (depthwise[i][j] == Scalar(0)) { continue; }
+
+                                uint32_t current_val = program.add_name(
+                                  program.load_variable(
+                                    program.member_access(layers[0],
+                                                          {program.add_constant(uint_type, {i * input_dimensions + j})},
+                                                          float_ptr_func),
+                                    float_type),
+                                  compose_string<debug>("in0[{}]", i * input_dimensions + j));
+
+                                program.add_source_line(__FILE__, __LINE__, conv_no);
+
+                                current_val = program.add_name(
+                                  program.fmul(
+                                    current_val, program.add_constant(float_type, {depthwise[i][j]}), float_type),
+                                  "current_mul_depthwise");
+                                total_val = program.add_name(program.fadd(total_val, current_val, float_type),
+                                                             "total_peq_current");
+
+                                program.add_source_line(__FILE__, __LINE__, conv_no);
+                            }
+
+                            program.store_variable(
+                              program.add_name(
+                                program.member_access(summed, {program.add_constant(uint_type, {j})}, float_ptr_func),
+                                compose_string<debug>("summed[{}]", j)),
+                              total_val);
+
+                            program.add_source_line(__FILE__, __LINE__, conv_no);
+                        }
+
+                        // The layers now read the summed channels rather than the whole neighbourhood
+                        layers[0] = summed;
+                    }
+                    else {
+                        // We have gathered which increased the size of the input
+                        input_dimensions = input_dimensions * (n_neighbours + 1);
+                    }
 
                     // selu constants
                     uint32_t lambda = program.add_name(
@@ -289,7 +349,8 @@ namespace engine {
 
                         program.add_source_line(__FILE__, __LINE__, conv_no);
 
-                        // Perform our matrix multiplication for weights and add bias for layer
+                        // Perform our matrix multiplication for weights and add bias for layer, pruned weights are left
+                        // out entirely
                         for (uint32_t i = 0; i < output_dimensions; ++i) {
                             uint32_t total_val =
                               program.add_name(program.add_constant(float_type, {biases[i]}),
@@ -298,6 +359,8 @@ namespace engine {
                             program.add_source_line(__FILE__, __LINE__, conv_no);
 
                             for (uint32_t j = 0; j < input_dimensions; ++j) {
+                                if (weights[j][i] == Scalar(0)) { continue; }
+
                                 uint32_t current_val = program.add_name(
                                   program.load_variable(
                                     program.member_access(
@@ -338,8 +401,9 @@ namespace engine {
                          *                  ACTIVATION.                  *
                          *************************************************/
 
-                        // Apply selu
-                        if (conv_no + 1 < structure.size() || layer_no + 1 < conv.size()) {
+                        // Apply selu, linear layers have no activation
+                        const bool linear = conv[layer_no].activation == ActivationFunction::LINEAR;
+                        if (!linear && (conv_no + 1 < structure.size() || layer_no + 1 < conv.size())) {
                             program.add_source_line(__FILE__, __LINE__, conv_no);
 
                             for (uint32_t i = 0; i < output_dimensions; ++i) {
@@ -381,7 +445,7 @@ namespace engine {
                             program.add_source_line(__FILE__, __LINE__, conv_no);
                         }
                         // If this is our last layer, apply softmax
-                        else {
+                        else if (!linear) {
                             program.add_source_line(__FILE__, __LINE__, conv_no);
 
                             // Apply exp to each of the elements
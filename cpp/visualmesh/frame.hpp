@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2017-2020 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef VISUALMESH_FRAME_HPP
+#define VISUALMESH_FRAME_HPP
+
+#include <cstdint>
+
+#include "visualmesh/lens.hpp"
+#include "visualmesh/mesh.hpp"
+#include "visualmesh/utility/math.hpp"
+#include "visualmesh/visualmesh.hpp"
+
+namespace visualmesh {
+
+/**
+ * @brief The arguments for classifying a single image, used when classifying several images in one batch
+ *
+ * @details
+ *  The mesh and the image are held by pointer and must stay alive while the frame is being classified.
+ *
+ * @tparam Scalar the scalar type used for calculations and storage (normally one of float or double)
+ * @tparam Model  the mesh model that we are projecting
+ */
+template <typename Scalar, template <typename> class Model>
+struct Frame {
+
+    /**
+     * @brief Construct a new Frame for a mesh
+     *
+     * @param mesh    the mesh table that we are projecting to pixel coordinates
+     * @param Hoc     the homogenous transformation matrix from the camera to the observation plane
+     * @param lens    the lens parameters that describe the optics of the camera
+     * @param image   the data that represents the image the network will run from
+     * @param format  the pixel format of this image as a fourcc code
+     */
+    Frame(const Mesh<Scalar, Model>& mesh,
+          const mat4<Scalar>& Hoc,
+          const Lens<Scalar>& lens,
+          const void* image,
+          const uint32_t& format)
+      : mesh(&mesh), Hoc(Hoc), lens(lens), image(image), format(format) {}
+
+    /**
+     * @brief Construct a new Frame using the mesh from a VisualMesh that is appropriate for the camera height
+     *
+     * @param mesh    the visual mesh that we are selecting a mesh from
+     * @param Hoc     the homogenous transformation matrix from the camera to the observation plane
+     * @param lens    the lens parameters that describe the optics of the camera
+     * @param image   the data that represents the image the network will run from
+     * @param format  the pixel format of this image as a fourcc code
+     */
+    Frame(const VisualMesh<Scalar, Model>& mesh,
+          const mat4<Scalar>& Hoc,
+          const Lens<Scalar>& lens,
+          const void* image,
+          const uint32_t& format)
+      : Frame(mesh.height(Hoc[2][3]), Hoc, lens, image, format) {}
+
+    /// The mesh table that we are projecting to pixel coordinates
+    const Mesh<Scalar, Model>* mesh;
+    /// The homogenous transformation matrix from the camera to the observation plane
+    mat4<Scalar> Hoc;
+    /// The lens parameters that describe the optics of the camera
+    Lens<Scalar> lens;
+    /// The data that represents the image the network will run from
+    const void* image;
+    /// The pixel format of this image as a fourcc code
+    uint32_t format;
+};
+
+}  // namespace visualmesh
+
+#endif  // VISUALMESH_FRAME_HPP
@@ -33,6 +33,7 @@
 
 #include "lens.hpp"
 #include "node.hpp"
+#include "region_of_interest.hpp"
 #include "utility/cone.hpp"
 #include "utility/math.hpp"
 #include "utility/projection.hpp"
@@ -493,16 +494,45 @@ public:
      * @return pairs of start/end ranges that are the points which are on the screen
      */
     std::vector<std::pair<int, int>> lookup(const mat4<Scalar>& Hoc, const Lens<Scalar>& lens) const {
+        return lookup(Hoc, lens, RegionOfInterest<Scalar>());
+    }
+
+    /**
+     * @brief Lookup which ranges in the Visual Mesh are on screen and inside a region of interest.
+     *
+     * @details
+     *  The screen edges are shrunk to the rectangle of the region, and the bounding cones are also checked against
+     *  the band of angles from straight down that the distance band of the region covers. Like the whole screen this
+     *  can include a few points just outside the rectangle, so they should be checked again after projecting them.
+     *
+     * @param Hoc    the homogenous transformation matrix that transforms from camera space to observation plane space
+     * @param lens   the lens object describing the type and geometry of the lens that is used
+     * @param region the part of the image to lookup the points for
+     *
+     * @return pairs of start/end ranges that are the points which are on the screen and inside the region
+     */
+    std::vector<std::pair<int, int>> lookup(const mat4<Scalar>& Hoc,
+                                            const Lens<Scalar>& lens,
+                                            const RegionOfInterest<Scalar>& region) const {
+
+        // Shrink the screen to the rectangle of the region
+        const Lens<Scalar> screen = region.crop(lens);
+        if (screen.dimensions[0] == 0 || screen.dimensions[1] == 0) { return std::vector<std::pair<int, int>>(); }
 
         // Our FOV is an easy check to exclude things outside our view
         // Multiply by 0.5 to get the cone angle
-        const Scalar cos_fov = std::cos(lens.fov * Scalar(0.5));
-        const Scalar sin_fov = std::sin(lens.fov * Scalar(0.5));
+        const Scalar cos_fov = std::cos(screen.fov * Scalar(0.5));
+        const Scalar sin_fov = std::sin(screen.fov * Scalar(0.5));
 
         // Get the x axis of the camera in world space and the cone equations that describe the edges of the screen
         const mat3<Scalar> Rco(block<3, 3>(transpose(Hoc)));
         const vec3<Scalar>& rXCo = Rco[0];  // Camera x in world space
-        const auto edges         = screen_edges(Hoc, lens);
+        const auto edges         = screen_edges(Hoc, screen);
+
+        // The distance band is a band of angles from straight down, -z is the cosine of that angle for a ray
+        const bool banded         = region.banded();
+        const vec2<Scalar> angles = region.nadir_angles(Hoc[2][3]);
+        const vec2<Scalar> band   = {{std::cos(angles[1]), std::cos(angles[0])}};
 
         // Go through our BSP tree to work out which segments of the mesh are on screen
         // The first element of the tree is the root element of the bsp
@@ -531,7 +561,20 @@ public:
 
             // The FOV can either entirely exclude our points, or split based on intersection. If it can't do either of
             // these (entirely inside) we need to use the screen edges to do a proper check.
-            if (!outside && inside) { std::tie(inside, outside) = check_on_screen(Rco, cone, lens, edges); }
+            if (!outside && inside) { std::tie(inside, outside) = check_on_screen(Rco, cone, screen, edges); }
+
+            // The rays in the cone are between the angle of its axis from straight down plus or minus its own angle
+            if (banded && !outside) {
+                const Scalar axis = std::acos(std::min(std::max(-cone.first[2], Scalar(-1.0)), Scalar(1.0)));
+                const Scalar half = std::atan2(cone.second[1], cone.second[0]);
+                if (axis + half < angles[0] || axis - half > angles[1]) {
+                    inside  = false;
+                    outside = true;
+                }
+                else if (axis - half < angles[0] || axis + half > angles[1]) {
+                    inside = false;
+                }
+            }
 
             if (inside) {
                 // If we are building just update our end point
@@ -555,10 +598,11 @@ public:
             else if (elem.children[0] < 0) {
                 for (int i = elem.range.first; i < elem.range.second; ++i) {
                     // Check if the pixel is on the screen
-                    auto px              = visualmesh::project(multiply(Rco, nodes[i].ray), lens);
+                    auto px              = visualmesh::project(multiply(Rco, nodes[i].ray), screen);
                     const bool on_screen = dot(rXCo, nodes[i].ray) > cos_fov && 0 <= px[0]
-                                           && px[0] + 1 <= lens.dimensions[0] && 0 <= px[1]
-                                           && px[1] + 1 <= lens.dimensions[1];
+                                           && px[0] + 1 <= screen.dimensions[0] && 0 <= px[1]
+                                           && px[1] + 1 <= screen.dimensions[1]
+                                           && (!banded || (band[0] <= -nodes[i].ray[2] && -nodes[i].ray[2] <= band[1]));
 
                     if (on_screen && building) {
                         // Extend the end
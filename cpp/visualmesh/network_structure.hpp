@@ -18,6 +18,7 @@
 #ifndef VISUALMESH_NETWORKSTRUCTURE_HPP
 #define VISUALMESH_NETWORKSTRUCTURE_HPP
 
+#include <string>
 #include <vector>
 
 namespace visualmesh {
@@ -34,14 +35,23 @@ enum ActivationFunction {
     RELU,
     SOFTMAX,
     TANH,
+    LINEAR,
 };
 
-/// A layer is made up of weights biases and activation function
+/**
+ * @brief A layer is made up of weights biases and activation function
+ *
+ * @details
+ *  The first layer of a convolutional group may be depthwise separable. Rather than the weights acting on the whole
+ *  gathered neighbourhood, each channel is first summed over the neighbourhood using the depthwise weights
+ *  (depthwise[neighbour][channel] with the point itself first) and the weights then act on just those channels.
+ */
 template <typename Scalar>
 struct Layer {
     Weights<Scalar> weights;
     Biases<Scalar> biases;
     ActivationFunction activation;
+    Weights<Scalar> depthwise = {};
 };
 
 /// A convolutional layer is made up of a list of network layers
@@ -51,6 +61,27 @@ using ConvolutionalGroup = std::vector<Layer<Scalar>>;
 template <typename Scalar>
 using NetworkStructure = std::vector<ConvolutionalGroup<Scalar>>;
 
+/// A named head of a branching network
+template <typename Scalar>
+struct NetworkHead {
+    std::string name;
+    NetworkStructure<Scalar> structure;
+};
+
+/**
+ * @brief A network whose trunk is shared by several heads
+ *
+ * @details
+ *  The trunk runs once from the image and each head then runs from the output of the trunk, so the first group of
+ *  each head gathers over the neighbourhood of the trunk's output rather than the image. Every head must have at least
+ *  one layer.
+ */
+template <typename Scalar>
+struct BranchingNetwork {
+    NetworkStructure<Scalar> trunk;
+    std::vector<NetworkHead<Scalar>> heads;
+};
+
 }  // namespace visualmesh
 
 #endif  // VISUALMESH_NETWORKSTRUCTURE_HPP
@@ -0,0 +1,259 @@
+/*
+ * Copyright (C) 2017-2020 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef VISUALMESH_OPTIMISE_NETWORK_HPP
+#define VISUALMESH_OPTIMISE_NETWORK_HPP
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "visualmesh/network_structure.hpp"
+
+namespace visualmesh {
+
+/// A summary of what optimise changed in a network
+struct OptimisationReport {
+    /// Floating point operations for each point (a multiply and an add per weight) before optimising
+    uint64_t flops_before = 0;
+    /// Floating point operations for each point after optimising
+    uint64_t flops_after = 0;
+    /// Layers with a linear activation that were folded into the layer that consumes them
+    unsigned int folded_layers = 0;
+    /// How many of the folded layers only scaled and shifted each channel, e.g. an exported batch normalisation
+    unsigned int fused_affine_layers = 0;
+    /// Output channels that were removed as nothing downstream reads them
+    unsigned int removed_channels = 0;
+};
+
+/**
+ * @brief Counts the floating point operations the network performs for each point, a multiply and an add per weight
+ */
+template <typename Scalar>
+uint64_t network_flops(const NetworkStructure<Scalar>& structure) {
+    uint64_t flops = 0;
+    for (const auto& conv : structure) {
+        for (const auto& layer : conv) {
+            flops += 2 * uint64_t(layer.weights.size()) * layer.biases.size();
+            for (const auto& d : layer.depthwise) {
+                flops += 2 * uint64_t(d.size());
+            }
+        }
+    }
+    return flops;
+}
+
+namespace optimiser {
+
+    /**
+     * @brief Finds the layer that reads the output of a layer
+     *
+     * @return the next layer in the group, the first layer of the next group (which reads the output through the
+     *         gather) or nullptr for the final layer of the network
+     */
+    template <typename Scalar>
+    Layer<Scalar>* consumer(NetworkStructure<Scalar>& structure,
+                            const std::size_t& conv_no,
+                            const std::size_t& layer_no) {
+        if (layer_no + 1 < structure[conv_no].size()) { return &structure[conv_no][layer_no + 1]; }
+        if (conv_no + 1 < structure.size()) { return &structure[conv_no + 1].front(); }
+        return nullptr;
+    }
+
+    /**
+     * @brief Gives how many copies of a layer's output the consumer reads, one unless there is a gather between them
+     */
+    template <typename Scalar>
+    std::size_t blocks(const Layer<Scalar>& layer, const Layer<Scalar>& consumer) {
+        const std::size_t n = layer.biases.size();
+        if (n == 0 || consumer.weights.size() % n != 0) {
+            throw std::runtime_error("The output of a layer does not match the input of the layer that follows it");
+        }
+        return consumer.weights.size() / n;
+    }
+
+    /**
+     * @brief Checks if a layer only scales and shifts each of its inputs independently (a diagonal weights matrix)
+     */
+    template <typename Scalar>
+    bool is_affine(const Layer<Scalar>& layer) {
+        if (layer.weights.size() != layer.biases.size()) { return false; }
+        for (std::size_t i = 0; i < layer.weights.size(); ++i) {
+            for (std::size_t j = 0; j < layer.weights[i].size(); ++j) {
+                if (i != j && layer.weights[i][j] != Scalar(0)) { return false; }
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Folds a layer with a linear activation into the layer that consumes it.
+     *
+     * @details
+     *  When there is a gather between the two layers the consumer's weights are made of a block for each neighbour,
+     *  each of which is multiplied by the linear layer's weights separately. This is exact because every point,
+     *  including the offscreen point, passes through the same layers before it is gathered.
+     *
+     * @return a layer that acts directly on the inputs of the linear layer, including its depthwise weights
+     */
+    template <typename Scalar>
+    Layer<Scalar> fold(const Layer<Scalar>& linear, const Layer<Scalar>& consumer) {
+        const std::size_t n_in     = linear.weights.size();
+        const std::size_t n_mid    = linear.biases.size();
+        const std::size_t n_out    = consumer.biases.size();
+        const std::size_t n_blocks = blocks(linear, consumer);
+
+        Layer<Scalar> folded{Weights<Scalar>(n_blocks * n_in, std::vector<Scalar>(n_out, Scalar(0))),
+                             consumer.biases,
+                             consumer.activation,
+                             linear.depthwise};
+        for (std::size_t b = 0; b < n_blocks; ++b) {
+            for (std::size_t k = 0; k < n_mid; ++k) {
+                const auto& row = consumer.weights[b * n_mid + k];
+                for (std::size_t o = 0; o < n_out; ++o) {
+                    folded.biases[o] += linear.biases[k] * row[o];
+                }
+                for (std::size_t i = 0; i < n_in; ++i) {
+                    const Scalar w = linear.weights[i][k];
+                    if (w != Scalar(0)) {
+                        for (std::size_t o = 0; o < n_out; ++o) {
+                            folded.weights[b * n_in + i][o] += w * row[o];
+                        }
+                    }
+                }
+            }
+        }
+        return folded;
+    }
+
+}  // namespace optimiser
+
+/**
+ * @brief Simplifies a network without changing what it computes, beyond floating point rounding.
+ *
+ * @details
+ *  Layers with a linear activation are folded into the layer that consumes them when that does not increase the
+ *  amount of work, which always holds for per channel affine layers such as an exported batch normalisation. Output
+ *  channels that the following layer gives no weight to are then removed along with the weights that read them. The
+ *  outputs of the network and of softmax layers are always kept as removing them would change the other outputs.
+ *
+ *  Calibration ranges gathered by an engine are for the optimised network, so they should be quantised with it.
+ *
+ * @tparam Scalar the scalar type used for calculations and storage (normally one of float or double)
+ *
+ * @param structure the network to optimise
+ * @param report    filled in with what was changed and the floating point operations before and after
+ *
+ * @return the optimised network
+ */
+template <typename Scalar>
+NetworkStructure<Scalar> optimise(NetworkStructure<Scalar> structure, OptimisationReport& report) {
+
+    report              = OptimisationReport();
+    report.flops_before = network_flops(structure);
+
+    for (const auto& conv : structure) {
+        for (std::size_t layer_no = 1; layer_no < conv.size(); ++layer_no) {
+            if (!conv[layer_no].depthwise.empty()) {
+                throw std::runtime_error("Only the first layer of a group can be depthwise separable");
+            }
+        }
+    }
+
+    // Work backwards so that chains of linear layers collapse into the layer at the end of them
+    for (std::size_t conv_no = structure.size(); conv_no-- > 0;) {
+        auto& conv = structure[conv_no];
+        for (std::size_t layer_no = conv.size(); layer_no-- > 0;) {
+            const auto& layer = conv[layer_no];
+            // A group can't be emptied as its gather would then read the wrong values
+            if (layer.activation != ActivationFunction::LINEAR || conv.size() == 1) { continue; }
+            // Folding into a depthwise separable layer would make it dense
+            Layer<Scalar>* consumer = optimiser::consumer(structure, conv_no, layer_no);
+            if (consumer == nullptr || !consumer->depthwise.empty()) { continue; }
+
+            const uint64_t n_blocks = optimiser::blocks(layer, *consumer);
+            const uint64_t before   = uint64_t(layer.weights.size()) * layer.biases.size()
+                                    + uint64_t(consumer->weights.size()) * consumer->biases.size();
+            const uint64_t after = n_blocks * layer.weights.size() * consumer->biases.size();
+            if (after <= before) {
+                report.fused_affine_layers += optimiser::is_affine(layer) ? 1 : 0;
+                report.folded_layers++;
+                *consumer = optimiser::fold(layer, *consumer);
+                conv.erase(conv.begin() + layer_no);
+            }
+        }
+    }
+
+    // Remove the output channels that the consumer gives no weight to
+    for (std::size_t conv_no = 0; conv_no < structure.size(); ++conv_no) {
+        for (std::size_t layer_no = 0; layer_no < structure[conv_no].size(); ++layer_no) {
+            auto& layer             = structure[conv_no][layer_no];
+            Layer<Scalar>* consumer = optimiser::consumer(structure, conv_no, layer_no);
+            if (consumer == nullptr || layer.activation == ActivationFunction::SOFTMAX) { continue; }
+
+            const std::size_t n_blocks = optimiser::blocks(layer, *consumer);
+            for (std::size_t j = layer.biases.size(); j-- > 0 && layer.biases.size() > 1;) {
+                const std::size_t n = layer.biases.size();
+
+                bool used = false;
+                for (std::size_t b = 0; b < n_blocks && !used; ++b) {
+                    for (const auto& w : consumer->weights[b * n + j]) {
+                        used = used || w != Scalar(0);
+                    }
+                }
+                // A depthwise separable consumer also ignores channels with no depthwise weight
+                if (!consumer->depthwise.empty()) {
+                    bool summed = false;
+                    for (const auto& d : consumer->depthwise) {
+                        summed = summed || d[j] != Scalar(0);
+                    }
+                    used = used && summed;
+                }
+
+                if (!used) {
+                    for (auto& row : layer.weights) {
+                        row.erase(row.begin() + j);
+                    }
+                    layer.biases.erase(layer.biases.begin() + j);
+                    for (std::size_t b = n_blocks; b-- > 0;) {
+                        consumer->weights.erase(consumer->weights.begin() + b * n + j);
+                    }
+                    for (auto& d : consumer->depthwise) {
+                        d.erase(d.begin() + j);
+                    }
+                    report.removed_channels++;
+                }
+            }
+        }
+    }
+
+    report.flops_after = network_flops(structure);
+    return structure;
+}
+
+/**
+ * @brief Simplifies a network without changing what it computes, see optimise(structure, report)
+ */
+template <typename Scalar>
+NetworkStructure<Scalar> optimise(const NetworkStructure<Scalar>& structure) {
+    OptimisationReport report;
+    return optimise(structure, report);
+}
+
+}  // namespace visualmesh
+
+#endif  // VISUALMESH_OPTIMISE_NETWORK_HPP
@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) 2017-2020 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef VISUALMESH_OUTPUT_MODE_HPP
+#define VISUALMESH_OUTPUT_MODE_HPP
+
+namespace visualmesh {
+
+/// What an engine gives back for each point of a classified mesh
+enum OutputMode {
+    /// The full output of the network for every class
+    CLASSIFICATIONS,
+    /// Only the index of the most likely class as an 8 bit label
+    LABELS,
+    /// The 8 bit label along with the probability of that class quantised to 0-255
+    LABELS_AND_CONFIDENCE,
+};
+
+}  // namespace visualmesh
+
+#endif  // VISUALMESH_OUTPUT_MODE_HPP
@@ -0,0 +1,246 @@
+/*
+ * Copyright (C) 2017-2020 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef VISUALMESH_PIPELINE_HPP
+#define VISUALMESH_PIPELINE_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "visualmesh/classified_mesh.hpp"
+#include "visualmesh/lens.hpp"
+#include "visualmesh/mesh.hpp"
+#include "visualmesh/network_structure.hpp"
+#include "visualmesh/utility/math.hpp"
+#include "visualmesh/visualmesh.hpp"
+
+namespace visualmesh {
+
+/**
+ * @brief Runs classification asynchronously on several engine instances so that consecutive frames overlap.
+ *
+ * @details
+ *  The engines are not thread safe and their operator() blocks until the result is available, which leaves the
+ *  device idle while the CPU looks up and projects the next frame. A pipeline owns one engine per frame that can be in
+ *  flight, each driven by its own worker thread. Submitting a frame hands it to an idle worker and returns a future for
+ *  the classified mesh straight away, so the lookup and projection of frame t+1 run while frame t is still executing.
+ *
+ *  If all of the frames in flight are busy submit blocks until one finishes. This bounds the latency that the pipeline
+ *  can add, so the number of frames in flight should be as small as gives the throughput you need.
+ *
+ *  The mesh and image passed to submit are used by reference and must stay alive until the future is ready.
+ *
+ * @tparam Scalar the scalar type used for calculations and storage (normally one of float or double)
+ * @tparam Engine the engine type that will be used to classify the meshes
+ */
+template <typename Scalar, typename Engine>
+class Pipeline {
+public:
+    /**
+     * @brief Construct a new Pipeline, creating an engine for each frame that can be in flight
+     *
+     * @param structure         the network structure that the engines will use for classification
+     * @param frames_in_flight  the maximum number of frames that can be processed at the same time
+     */
+    Pipeline(const NetworkStructure<Scalar>& structure, const unsigned int& frames_in_flight = 2)
+      : frames_in_flight(frames_in_flight), in_flight(0), stopping(false) {
+
+        if (frames_in_flight == 0) { throw std::invalid_argument("A pipeline needs at least one frame in flight"); }
+
+        // Engines are made here so any errors creating them are thrown to the caller
+        for (unsigned int i = 0; i < frames_in_flight; ++i) {
+            engines.emplace_back(std::make_unique<Engine>(structure));
+        }
+
+        // If a thread can't be started the ones that were must be stopped, as destroying a running thread terminates
+        workers.reserve(engines.size());
+        try {
+            for (const auto& engine : engines) {
+                workers.emplace_back([this, &engine] { run(*engine); });
+            }
+        }
+        catch (...) {
+            stop();
+            throw;
+        }
+    }
+
+    Pipeline(const Pipeline&) = delete;
+    Pipeline& operator=(const Pipeline&) = delete;
+
+    /**
+     * @brief Finishes any frames that are in flight and stops the worker threads
+     */
+    ~Pipeline() {
+        stop();
+    }
+
+    /**
+     * @brief Submit a mesh for projection and classification on the next free engine
+     *
+     * @tparam Model the mesh model that we are projecting
+     *
+     * @param mesh    the mesh table that we are projecting to pixel coordinates
+     * @param Hoc     the homogenous transformation matrix from the camera to the observation plane
+     * @param lens    the lens parameters that describe the optics of the camera
+     * @param image   the data that represents the image the network will run from
+     * @param format  the pixel format of this image as a fourcc code
+     *
+     * @return a future for the classified mesh of this frame
+     */
+    template <template <typename> class Model>
+    std::future<ClassifiedMesh<Scalar, Model<Scalar>::N_NEIGHBOURS>> submit(const Mesh<Scalar, Model>& mesh,
+                                                                            const mat4<Scalar>& Hoc,
+                                                                            const Lens<Scalar>& lens,
+                                                                            const void* image,
+                                                                            const uint32_t& format) {
+        return enqueue<ClassifiedMesh<Scalar, Model<Scalar>::N_NEIGHBOURS>>(
+          [&mesh, Hoc, lens, image, format](const Engine& engine) { return engine(mesh, Hoc, lens, image, format); });
+    }
+
+    /**
+     * @brief Submit a mesh for projection and classification on the next free engine.
+     * This version takes an aggregate VisualMesh object
+     *
+     * @tparam Model the mesh model that we are projecting
+     *
+     * @param mesh    the mesh table that we are projecting to pixel coordinates
+     * @param Hoc     the homogenous transformation matrix from the camera to the observation plane
+     * @param lens    the lens parameters that describe the optics of the camera
+     * @param image   the data that represents the image the network will run from
+     * @param format  the pixel format of this image as a fourcc code
+     *
+     * @return a future for the classified mesh of this frame
+     */
+    template <template <typename> class Model>
+    std::future<ClassifiedMesh<Scalar, Model<Scalar>::N_NEIGHBOURS>> submit(const VisualMesh<Scalar, Model>& mesh,
+                                                                            const mat4<Scalar>& Hoc,
+                                                                            const Lens<Scalar>& lens,
+                                                                            const void* image,
+                                                                            const uint32_t& format) {
+        return submit(mesh.height(Hoc[2][3]), Hoc, lens, image, format);
+    }
+
+    /**
+     * @brief Blocks until every frame that has been submitted has finished
+     */
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        frame_finished.wait(lock, [this] { return in_flight == 0; });
+    }
+
+private:
+    /**
+     * @brief Tells the worker threads to stop once the queue is empty and waits for them to finish
+     */
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        work_available.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    /**
+     * @brief Waits for a free slot and adds a task to the work queue
+     *
+     * @tparam Result the type of result that the task produces
+     * @tparam Task   a callable taking the engine to run on and returning a Result
+     *
+     * @param task the task to run
+     *
+     * @return a future that holds the result of the task, or the exception it threw
+     */
+    template <typename Result, typename Task>
+    std::future<Result> enqueue(Task&& task) {
+        // std::function needs to be copyable so the packaged task is shared
+        auto packaged = std::make_shared<std::packaged_task<Result(const Engine&)>>(std::forward<Task>(task));
+        std::future<Result> result = packaged->get_future();
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            frame_finished.wait(lock, [this] { return in_flight < frames_in_flight; });
+            ++in_flight;
+            queue.emplace_back([packaged](const Engine& engine) { (*packaged)(engine); });
+        }
+        work_available.notify_one();
+
+        return result;
+    }
+
+    /**
+     * @brief The loop run by each of the worker threads
+     *
+     * @param engine the engine that is owned by this worker
+     */
+    void run(const Engine& engine) {
+        while (true) {
+            std::function<void(const Engine&)> job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                work_available.wait(lock, [this] { return stopping || !queue.empty(); });
+                if (queue.empty()) { return; }
+                job = std::move(queue.front());
+                queue.pop_front();
+            }
+
+            job(engine);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                --in_flight;
+            }
+            frame_finished.notify_all();
+        }
+    }
+
+    /// The maximum number of frames that can be processed at once
+    unsigned int frames_in_flight;
+    /// The number of frames that have been submitted and not yet finished
+    unsigned int in_flight;
+    /// Set when the pipeline is being destroyed so the workers exit once the queue is empty
+    bool stopping;
+
+    /// One engine for each of the frames that can be in flight
+    std::vector<std::unique_ptr<Engine>> engines;
+    /// The threads that drive each of the engines
+    std::vector<std::thread> workers;
+
+    /// Frames that have been submitted but not yet picked up by a worker
+    std::deque<std::function<void(const Engine&)>> queue;
+    /// Protects the queue and the frame counters
+    std::mutex mutex;
+    /// Signalled when a frame is added to the queue or the pipeline is stopping
+    std::condition_variable work_available;
+    /// Signalled when a frame finishes
+    std::condition_variable frame_finished;
+};
+
+}  // namespace visualmesh
+
+#endif  // VISUALMESH_PIPELINE_HPP
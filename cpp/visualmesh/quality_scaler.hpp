@@ -0,0 +1,298 @@
+/*
+ * Copyright (C) 2017-2020 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef VISUALMESH_QUALITY_SCALER_HPP
+#define VISUALMESH_QUALITY_SCALER_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "visualmesh/classified_mesh.hpp"
+#include "visualmesh/engine/cpu/project_mesh.hpp"
+#include "visualmesh/lens.hpp"
+#include "visualmesh/mesh.hpp"
+#include "visualmesh/network_structure.hpp"
+#include "visualmesh/projected_mesh.hpp"
+#include "visualmesh/utility/math.hpp"
+#include "visualmesh/visualmesh.hpp"
+
+namespace visualmesh {
+
+/**
+ * @brief Runs an engine over one of several Visual Meshes of different densities, choosing the densest mesh that is
+ * expected to finish within a latency deadline.
+ *
+ * @details
+ *  Each quality level is a VisualMesh built with a different k value for the same model and shape, so the same network
+ *  can classify any of them. Every frame the number of on screen points for a level is found using the mesh lookup and
+ *  multiplied by a moving estimate of the time it takes to process a single point. The densest level whose predicted
+ *  time fits inside the deadline (less some headroom) is used. After classification the measured time is used to
+ *  update the estimate. When a frame runs over the deadline the estimate is raised to the measured cost immediately,
+ *  while decreases are smoothed. This means that when the machine becomes contended the quality drops on the very next
+ *  frame, and recovers gradually once the contention goes away.
+ *
+ *  Until the first frame has been measured there is no cost estimate, so the first frame is run at the lowest quality.
+ *
+ *  The lookup made for the chosen mesh is reused to project it, and the projection is classified with the engine's
+ *  projected mesh operator. Engines without one (such as the Vulkan engine) classify the mesh directly, which looks it
+ *  up again. The lookups are timed along with the classification so their cost is part of the estimate.
+ *
+ * @tparam Scalar the scalar type used for calculations and storage (normally one of float or double)
+ * @tparam Model  the model used to generate the mesh for each of the quality levels
+ * @tparam Engine the engine type that will be used to classify the meshes
+ */
+template <typename Scalar, template <typename> class Model, typename Engine>
+class QualityScaler {
+public:
+    using clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Statistics about how the most recent frame was processed
+     */
+    struct FrameStatistics {
+        /// The index of the quality level that was used (0 is the lowest quality)
+        int level;
+        /// The number of points that were projected and classified
+        int n_points;
+        /// How long the classification was expected to take
+        clock::duration predicted;
+        /// How long the classification actually took
+        clock::duration measured;
+    };
+
+    /**
+     * @brief Construct a new Quality Scaler, generating a VisualMesh for each of the provided k values
+     *
+     * @tparam Shape the shape type that the meshes will be generated using
+     *
+     * @param structure    the network structure that the engine will use for classification
+     * @param shape        the shape we are generating the visual meshes for
+     * @param min_height   the minimum height that our camera will be at
+     * @param max_height   the maximum height our camera will be at
+     * @param ks           the k value for each of the quality levels
+     * @param max_error    the maximum amount of error in terms of k that a mesh can have
+     * @param max_distance the maximum distance that the meshes will project for
+     * @param deadline     the amount of time that a single classification should take
+     */
+    template <typename Shape>
+    QualityScaler(const NetworkStructure<Scalar>& structure,
+                  const Shape& shape,
+                  const Scalar& min_height,
+                  const Scalar& max_height,
+                  std::vector<Scalar> ks,
+                  const Scalar& max_error,
+                  const Scalar& max_distance,
+                  const clock::duration& deadline)
+      : engine(structure), deadline(deadline), headroom(0.9), smoothing(0.1), cost_per_point(0) {
+
+        if (ks.empty()) { throw std::runtime_error("The quality scaler needs at least one k value"); }
+
+        // Sort so the lowest quality (smallest k) is first
+        std::sort(ks.begin(), ks.end());
+        meshes.reserve(ks.size());
+        for (const auto& k : ks) {
+            meshes.emplace_back(shape, min_height, max_height, k, max_error, max_distance);
+        }
+    }
+
+    /**
+     * @brief Project and classify the mesh using the densest quality level that is expected to meet the deadline
+     *
+     * @param Hoc     the homogenous transformation matrix from the camera to the observation plane
+     * @param lens    the lens parameters that describe the optics of the camera
+     * @param image   the data that represents the image the network will run from
+     * @param format  the pixel format of this image as a fourcc code
+     *
+     * @return a classified mesh for the provided arguments
+     */
+    ClassifiedMesh<Scalar, Model<Scalar>::N_NEIGHBOURS> operator()(const mat4<Scalar>& Hoc,
+                                                                   const Lens<Scalar>& lens,
+                                                                   const void* image,
+                                                                   const uint32_t& format) {
+
+        // The lookups made to choose a level are part of the cost of the frame, so they are timed too
+        clock::time_point start = clock::now();
+
+        // Work down from the densest mesh until we find one we expect to be able to process in time
+        const double budget = std::chrono::duration<double>(deadline).count() * headroom;
+        int level           = cost_per_point > 0 ? int(meshes.size()) - 1 : 0;
+        int n_points        = 0;
+        std::vector<std::pair<int, int>> ranges;
+        for (; level >= 0; --level) {
+            ranges   = meshes[level].height(Hoc[2][3]).lookup(Hoc, lens);
+            n_points = 0;
+            for (const auto& r : ranges) {
+                n_points += r.second - r.first;
+            }
+            if (level == 0 || n_points * cost_per_point <= budget) { break; }
+        }
+
+        const double predicted = n_points * cost_per_point;
+
+        // Classify the chosen level, reusing its lookup when the engine can classify a projection it is given
+        auto classified =
+          classify(engine, meshes[level].height(Hoc[2][3]), ranges, Hoc, lens, image, format, PreferProjected());
+        clock::duration elapsed = clock::now() - start;
+
+        // The estimate is updated from the points that were actually processed rather than the lookup's count
+        n_points = int(classified.global_indices.size());
+
+        // Update our moving estimate of how long it takes to process a single point
+        if (n_points > 0) {
+            const double cost = std::chrono::duration<double>(elapsed).count() / n_points;
+            if (cost_per_point <= 0 || elapsed > deadline) { cost_per_point = std::max(cost_per_point, cost); }
+            else {
+                cost_per_point += smoothing * (cost - cost_per_point);
+            }
+        }
+
+        statistics = FrameStatistics{
+          level,
+          n_points,
+          std::chrono::duration_cast<clock::duration>(std::chrono::duration<double>(predicted)),
+          elapsed,
+        };
+
+        return classified;
+    }
+
+    /**
+     * @brief Set the amount of time that a single classification should take
+     *
+     * @param deadline the new deadline for each frame
+     */
+    void set_deadline(const clock::duration& deadline) {
+        this->deadline = deadline;
+    }
+
+    /**
+     * @brief Set the fraction of the deadline that the predicted time must fit inside. Values less than one leave some
+     * slack for variations in the frame time.
+     *
+     * @param headroom the fraction of the deadline that is available for classification
+     */
+    void set_headroom(const double& headroom) {
+        this->headroom = headroom;
+    }
+
+    /**
+     * @brief Set how quickly the cost estimate follows decreases in the measured cost (0 to 1)
+     *
+     * @param smoothing the weight given to each new measurement
+     */
+    void set_smoothing(const double& smoothing) {
+        this->smoothing = smoothing;
+    }
+
+    /**
+     * @return the current estimate of how many seconds it takes to classify a single point
+     */
+    double point_cost() const {
+        return cost_per_point;
+    }
+
+    /**
+     * @return statistics about how the most recent frame was processed
+     */
+    const FrameStatistics& last_frame() const {
+        return statistics;
+    }
+
+    /**
+     * @return the number of quality levels that are available
+     */
+    int levels() const {
+        return meshes.size();
+    }
+
+private:
+    /// A projection of one of the meshes
+    using Projected = ProjectedMesh<Scalar, Model<Scalar>::N_NEIGHBOURS>;
+
+    /// Prefers the overload of classify that uses a projection over the one that doesn't when both are available
+    struct PreferProjected {};
+    struct FallBack {
+        FallBack(PreferProjected) {}
+    };
+
+    /**
+     * @brief Project the points a lookup found and classify them with the engine's projected mesh operator
+     *
+     * @tparam E the engine type, which must have a projected mesh operator for this overload to be used
+     *
+     * @param engine  the engine to classify with
+     * @param mesh    the mesh that was looked up
+     * @param ranges  the on screen ranges of the mesh that the lookup found
+     * @param Hoc     the homogenous transformation matrix from the camera to the observation plane
+     * @param lens    the lens parameters that describe the optics of the camera
+     * @param image   the data that represents the image the network will run from
+     * @param format  the pixel format of this image as a fourcc code
+     *
+     * @return a classified mesh for the provided arguments
+     */
+    template <typename E>
+    static auto classify(const E& engine,
+                         const Mesh<Scalar, Model>& mesh,
+                         const std::vector<std::pair<int, int>>& ranges,
+                         const mat4<Scalar>& Hoc,
+                         const Lens<Scalar>& lens,
+                         const void* image,
+                         const uint32_t& format,
+                         PreferProjected)
+      -> std::decay_t<decltype(engine(std::declval<const Projected&>(), lens, image, format).front())> {
+        const auto projected = visualmesh::engine::cpu::project_ranges(mesh, Hoc, lens, ranges);
+        return std::move(engine(projected, lens, image, format).front());
+    }
+
+    /**
+     * @brief Classify a mesh with an engine that has no projected mesh operator, which looks the mesh up again itself
+     */
+    template <typename E>
+    static ClassifiedMesh<Scalar, Model<Scalar>::N_NEIGHBOURS> classify(const E& engine,
+                                                                        const Mesh<Scalar, Model>& mesh,
+                                                                        const std::vector<std::pair<int, int>>&,
+                                                                        const mat4<Scalar>& Hoc,
+                                                                        const Lens<Scalar>& lens,
+                                                                        const void* image,
+                                                                        const uint32_t& format,
+                                                                        FallBack) {
+        return engine(mesh, Hoc, lens, image, format);
+    }
+
+    /// The engine that is used to classify the meshes
+    Engine engine;
+    /// The meshes for each quality level sorted from the lowest to the highest k
+    std::vector<VisualMesh<Scalar, Model>> meshes;
+    /// How long each frame is allowed to take
+    clock::duration deadline;
+    /// The fraction of the deadline that predictions must fit inside
+    double headroom;
+    /// The weight given to new measurements when the cost is decreasing
+    double smoothing;
+    /// The moving estimate of the number of seconds needed to process a single point
+    double cost_per_point;
+    /// Statistics from the most recent frame
+    FrameStatistics statistics{0, 0, clock::duration(0), clock::duration(0)};
+};
+
+}  // namespace visualmesh
+
+#endif  // VISUALMESH_QUALITY_SCALER_HPP
@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2017-2020 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef VISUALMESH_QUANTISED_NETWORK_HPP
+#define VISUALMESH_QUANTISED_NETWORK_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "visualmesh/network_structure.hpp"
+
+namespace visualmesh {
+
+/// The range of values seen at the input of each layer, indexed the same way as the network [group][layer]
+template <typename Scalar>
+using CalibrationRanges = std::vector<std::vector<std::pair<Scalar, Scalar>>>;
+
+/// Maps a real value to an unsigned 8 bit value as q = round(value / scale) + zero_point
+template <typename Scalar>
+struct QuantisationParameters {
+    Scalar scale;
+    int32_t zero_point;
+};
+
+/**
+ * @brief A layer with 8 bit weights and activations that accumulates in 32 bits.
+ *
+ * @details
+ *  Inputs are quantised to unsigned 8 bit values using the layer's input parameters. Weights are signed 8 bit values
+ *  that are symmetric around zero with a separate scale for each output. Unlike Layer the weights are stored as
+ *  weights[output][input] so each output is a contiguous dot product. Biases are stored in units of the accumulator
+ *  (input.scale * weight_scales[output]) so they can be added directly to it.
+ */
+template <typename Scalar>
+struct QuantisedLayer {
+    QuantisationParameters<Scalar> input;
+    std::vector<std::vector<int8_t>> weights;
+    std::vector<Scalar> weight_scales;
+    std::vector<int32_t> biases;
+    ActivationFunction activation;
+};
+
+/// A quantised convolutional layer is made up of a list of quantised network layers
+template <typename Scalar>
+using QuantisedGroup = std::vector<QuantisedLayer<Scalar>>;
+/// A quantised network is a list of quantised convolutional layers
+template <typename Scalar>
+using QuantisedNetwork = std::vector<QuantisedGroup<Scalar>>;
+
+/**
+ * @brief Quantise a network to 8 bits using the ranges of values observed at the input of each layer.
+ *
+ * @details
+ *  The ranges are normally gathered by running the floating point network over a set of representative images. Each
+ *  range is widened to include zero so that zero (and therefore the padding of the gather) is exactly representable.
+ *
+ * @tparam Scalar the scalar type used for calculations and storage (normally one of float or double)
+ *
+ * @param structure the floating point network to quantise
+ * @param ranges    the minimum and maximum value seen at the input of each layer
+ *
+ * @return the quantised network
+ */
+template <typename Scalar>
+QuantisedNetwork<Scalar> quantise(const NetworkStructure<Scalar>& structure, const CalibrationRanges<Scalar>& ranges) {
+
+    if (ranges.size() != structure.size()) {
+        throw std::runtime_error("The calibration ranges do not match the shape of the network");
+    }
+
+    QuantisedNetwork<Scalar> network;
+    for (unsigned int conv_no = 0; conv_no < structure.size(); ++conv_no) {
+        if (ranges[conv_no].size() != structure[conv_no].size()) {
+            throw std::runtime_error("The calibration ranges do not match the shape of the network");
+        }
+
+        network.emplace_back();
+        for (unsigned int layer_no = 0; layer_no < structure[conv_no].size(); ++layer_no) {
+            const auto& layer = structure[conv_no][layer_no];
+            const auto& range = ranges[conv_no][layer_no];
+            if (!layer.depthwise.empty()) {
+                throw std::runtime_error("Depthwise separable layers can not be quantised");
+            }
+            if (!(range.first <= range.second)) {
+                throw std::runtime_error("The network must be calibrated with at least one image before quantising");
+            }
+
+            // Choose the input mapping so the whole observed range fits in [0, 255]
+            const Scalar low   = std::min(range.first, Scalar(0));
+            const Scalar high  = std::max(range.second, Scalar(0));
+            const Scalar scale = high > low ? (high - low) / Scalar(255) : Scalar(1);
+            const int32_t zero = std::min(255, std::max(0, int32_t(std::round(-low / scale))));
+
+            const unsigned int n_inputs  = layer.weights.size();
+            const unsigned int n_outputs = layer.biases.size();
+
+            QuantisedLayer<Scalar> q{{scale, zero},
+                                     std::vector<std::vector<int8_t>>(n_outputs, std::vector<int8_t>(n_inputs)),
+                                     std::vector<Scalar>(n_outputs),
+                                     std::vector<int32_t>(n_outputs),
+                                     layer.activation};
+
+            for (unsigned int j = 0; j < n_outputs; ++j) {
+                // Symmetric per output scale so the largest weight maps to 127
+                Scalar max_weight = 0;
+                for (unsigned int i = 0; i < n_inputs; ++i) {
+                    max_weight = std::max(max_weight, std::abs(layer.weights[i][j]));
+                }
+                const Scalar weight_scale = max_weight > 0 ? max_weight / Scalar(127) : Scalar(1);
+
+                for (unsigned int i = 0; i < n_inputs; ++i) {
+                    q.weights[j][i] = int8_t(std::round(layer.weights[i][j] / weight_scale));
+                }
+                q.weight_scales[j] = weight_scale;
+                q.biases[j]        = int32_t(std::round(layer.biases[j] / (scale * weight_scale)));
+            }
+
+            network.back().push_back(std::move(q));
+        }
+    }
+
+    return network;
+}
+
+}  // namespace visualmesh
+
+#endif  // VISUALMESH_QUANTISED_NETWORK_HPP
@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2017-2020 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef VISUALMESH_REGION_OF_INTEREST_HPP
+#define VISUALMESH_REGION_OF_INTEREST_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "visualmesh/lens.hpp"
+#include "visualmesh/utility/math.hpp"
+#include "visualmesh/utility/projection.hpp"
+
+namespace visualmesh {
+
+/**
+ * @brief Restricts projection and classification to part of the image
+ *
+ * @details
+ *  A point is in the region when its pixel coordinates are inside the rectangle and its distance along the
+ *  observation plane from the camera is inside the distance band. The default region is the whole image.
+ *
+ * @tparam Scalar the scalar type used for calculations and storage (normally one of float or double)
+ */
+template <typename Scalar>
+struct RegionOfInterest {
+
+    /// The smallest pixel coordinates (x,y) of points in the region
+    vec2<Scalar> top_left = {{std::numeric_limits<Scalar>::lowest(), std::numeric_limits<Scalar>::lowest()}};
+    /// The largest pixel coordinates (x,y) of points in the region
+    vec2<Scalar> bottom_right = {{std::numeric_limits<Scalar>::max(), std::numeric_limits<Scalar>::max()}};
+    /// The closest distance along the observation plane of points in the region
+    Scalar min_distance = Scalar(0.0);
+    /// The furthest distance along the observation plane of points in the region, points above the horizon are
+    /// infinitely far away
+    Scalar max_distance = std::numeric_limits<Scalar>::infinity();
+
+    /**
+     * @brief Checks if a pixel is inside the rectangle of the region, ignoring the distance band
+     *
+     * @param px the pixel coordinates to check
+     *
+     * @return true if the pixel is inside the rectangle
+     */
+    bool contains(const vec2<Scalar>& px) const {
+        return top_left[0] <= px[0] && px[0] <= bottom_right[0] && top_left[1] <= px[1] && px[1] <= bottom_right[1];
+    }
+
+    /**
+     * @brief Checks if a pixel is inside the rectangle of the region and the ray through it is inside the distance band
+     *
+     * @details
+     *  This is the check to use to tell the points of a region apart from the rings of neighbours that are classified
+     *  around them, as points can be inside the rectangle while being outside the distance band.
+     *
+     * @param px   the pixel coordinates to check
+     * @param Hoc  the homogenous transformation matrix from the camera to the observation plane
+     * @param lens the lens parameters that describe the optics of the camera
+     *
+     * @return true if the pixel is inside the region
+     */
+    bool contains(const vec2<Scalar>& px, const mat4<Scalar>& Hoc, const Lens<Scalar>& lens) const {
+        if (!contains(px)) { return false; }
+        if (!banded()) { return true; }
+
+        // Compare the ray's cosine from straight down to the band the same way the mesh lookup does
+        const vec3<Scalar> ray    = multiply(mat3<Scalar>(block<3, 3>(Hoc)), unproject(px, lens));
+        const vec2<Scalar> angles = nadir_angles(Hoc[2][3]);
+        const Scalar down         = -ray[2] / norm(ray);
+        return std::cos(angles[1]) <= down && down <= std::cos(angles[0]);
+    }
+
+    /**
+     * @brief Checks if the distance band of the region limits which points are in it
+     */
+    bool banded() const {
+        return min_distance > Scalar(0.0) || std::isfinite(max_distance);
+    }
+
+    /**
+     * @brief Checks if the region is the whole of an image, in which case there is nothing to restrict
+     *
+     * @param lens the lens of the image
+     */
+    bool covers(const Lens<Scalar>& lens) const {
+        return !banded() && top_left[0] <= Scalar(0.0) && top_left[1] <= Scalar(0.0)
+               && bottom_right[0] >= Scalar(lens.dimensions[0]) && bottom_right[1] >= Scalar(lens.dimensions[1]);
+    }
+
+    /**
+     * @brief Works out the range of angles from straight down that rays in the distance band make
+     *
+     * @param h the height of the camera above the observation plane
+     *
+     * @return the smallest and largest angle from straight down in radians
+     */
+    vec2<Scalar> nadir_angles(const Scalar& h) const {
+        return vec2<Scalar>{{std::atan2(min_distance, h),
+                             std::isfinite(max_distance) ? std::atan2(max_distance, h) : Scalar(M_PI)}};
+    }
+
+    /**
+     * @brief Makes a lens for the part of the image that covers the rectangle of the region, so the screen edges of the
+     * new lens are the edges of the rectangle. The crop is rounded out to whole pixels and includes an extra pixel on
+     * the bottom and right so every point in the rectangle is on screen for the new lens.
+     *
+     * @param lens the lens of the whole image
+     *
+     * @return the lens for the cropped image, with zero dimensions if the rectangle misses the image
+     */
+    Lens<Scalar> crop(const Lens<Scalar>& lens) const {
+        const auto& d = lens.dimensions;
+        const int x0  = int(std::max(Scalar(0.0), std::floor(std::max(top_left[0], Scalar(-1.0)))));
+        const int y0  = int(std::max(Scalar(0.0), std::floor(std::max(top_left[1], Scalar(-1.0)))));
+        const int x1  = int(std::min(Scalar(d[0]), std::ceil(std::min(bottom_right[0], Scalar(d[0]))) + Scalar(1.0)));
+        const int y1  = int(std::min(Scalar(d[1]), std::ceil(std::min(bottom_right[1], Scalar(d[1]))) + Scalar(1.0)));
+
+        // Moving the image's origin and size moves where the centre of the lens is relative to the centre of the image
+        Lens<Scalar> cropped = lens;
+        cropped.dimensions   = {{std::max(x1 - x0, 0), std::max(y1 - y0, 0)}};
+        cropped.centre[0]    = lens.centre[0] + Scalar(x0) + Scalar(cropped.dimensions[0] - d[0]) * Scalar(0.5);
+        cropped.centre[1]    = lens.centre[1] + Scalar(y0) + Scalar(cropped.dimensions[1] - d[1]) * Scalar(0.5);
+        return cropped;
+    }
+};
+
+}  // namespace visualmesh
+
+#endif  // VISUALMESH_REGION_OF_INTEREST_HPP
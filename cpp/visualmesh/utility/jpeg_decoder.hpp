@@ -0,0 +1,171 @@
+/*
+ * Copyright (C) 2017-2020 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef VISUALMESH_UTILITY_JPEG_DECODER_HPP
+#define VISUALMESH_UTILITY_JPEG_DECODER_HPP
+
+// If JPEG is disabled then we don't provide this file
+#if !defined(VISUALMESH_DISABLE_JPEG)
+
+// jpeglib.h uses size_t and FILE without including anything for them
+#include <cstddef>
+#include <cstdio>
+
+#include <jpeglib.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <csetjmp>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "visualmesh/utility/math.hpp"
+
+namespace visualmesh {
+
+/**
+ * @brief Decodes only the parts of a JPEG image that are needed to sample it at a set of pixel coordinates
+ *
+ * @details
+ *  The mesh only samples a small part of most images, but a JPEG has to be entropy decoded from the start. This uses
+ *  libjpeg-turbo's partial decoding so that rows with no points near them are skipped without the inverse DCT,
+ *  upsampling or colour conversion, and the columns outside the points are cropped away. The decoded pixels are written
+ *  as BGRA into a full size image that is kept between frames, so the result can be given to any engine with the format
+ *  fourcc("BGRA") along with the projection the pixel coordinates came from. Pixels that no point samples are left as
+ *  they were.
+ */
+class JPEGDecoder {
+public:
+    /**
+     * @brief Decode the parts of a JPEG image that the bilinear samplers read for each of the pixel coordinates
+     *
+     * @tparam Scalar the scalar type used for the pixel coordinates
+     *
+     * @param data   the compressed JPEG image
+     * @param size   the number of bytes in the compressed image
+     * @param pixels the pixel coordinates that will be sampled from the image
+     *
+     * @return the decoded BGRA image, valid until the next call to decode
+     */
+    template <typename Scalar>
+    const uint8_t* decode(const void* data,
+                          const std::size_t& size,
+                          const std::vector<std::array<Scalar, 2>>& pixels) {
+
+        jpeg_decompress_struct cinfo;
+        ErrorManager error;
+        cinfo.err                = jpeg_std_error(&error.manager);
+        error.manager.error_exit = &ErrorManager::error_exit;
+
+        // libjpeg reports errors by calling error_exit which jumps back here, so nothing that needs to be destroyed can
+        // be declared between here and the end of the decode
+        if (setjmp(error.jump)) {
+            jpeg_destroy_decompress(&cinfo);
+            throw std::runtime_error(std::string("Failed to decode the JPEG image: ") + error.message);
+        }
+
+        jpeg_create_decompress(&cinfo);
+        jpeg_mem_src(&cinfo, reinterpret_cast<const unsigned char*>(data), static_cast<unsigned long>(size));
+        jpeg_read_header(&cinfo, TRUE);
+        cinfo.out_color_space = JCS_EXT_BGRA;
+        jpeg_start_decompress(&cinfo);
+
+        image_dimensions = {int(cinfo.output_width), int(cinfo.output_height)};
+        image.resize(cinfo.output_width * cinfo.output_height * 4);
+        rows.assign(cinfo.output_height, false);
+
+        // Each point reads the pixel it is in and the ones after it, clamped to the image
+        int min_x = image_dimensions[0];
+        int max_x = -1;
+        for (const auto& px : pixels) {
+            const int x = std::min(std::max(int(std::floor(px[0])), 0), image_dimensions[0] - 1);
+            const int y = std::min(std::max(int(std::floor(px[1])), 0), image_dimensions[1] - 1);
+            min_x       = std::min(min_x, x);
+            max_x       = std::max(max_x, std::min(x + 1, image_dimensions[0] - 1));
+            rows[y]     = true;
+            rows[std::min(y + 1, image_dimensions[1] - 1)] = true;
+        }
+
+        // Crop to the columns the points are in, which libjpeg widens to a whole number of blocks
+        JDIMENSION x_offset = JDIMENSION(std::max(min_x, 0));
+        JDIMENSION width    = JDIMENSION(std::max(max_x - min_x + 1, 0));
+        if (width > 0 && width < cinfo.output_width) { jpeg_crop_scanline(&cinfo, &x_offset, &width); }
+
+        // Nothing is needed after the last row with a point near it
+        const auto last_row      = std::find(rows.rbegin(), rows.rend(), true);
+        const JDIMENSION end_row = JDIMENSION(std::distance(last_row, rows.rend()));
+
+        while (cinfo.output_scanline < end_row) {
+            const JDIMENSION y = cinfo.output_scanline;
+
+            // Skip every row up to the next one that is needed
+            if (!rows[y]) {
+                JDIMENSION n = 0;
+                while (y + n < end_row && !rows[y + n]) {
+                    ++n;
+                }
+                jpeg_skip_scanlines(&cinfo, n);
+                continue;
+            }
+
+            JSAMPROW row = image.data() + (y * image_dimensions[0] + x_offset) * 4;
+            jpeg_read_scanlines(&cinfo, &row, 1);
+        }
+
+        // Stop without decoding the rest of the image
+        jpeg_abort_decompress(&cinfo);
+        jpeg_destroy_decompress(&cinfo);
+
+        return image.data();
+    }
+
+    /**
+     * @brief The dimensions of the last image that was decoded
+     */
+    const vec2<int>& dimensions() const {
+        return image_dimensions;
+    }
+
+private:
+    /// Replaces libjpeg's default error handling, which exits the program, with a jump back to the decoder
+    struct ErrorManager {
+        jpeg_error_mgr manager;
+        std::jmp_buf jump;
+        char message[JMSG_LENGTH_MAX];
+
+        static void error_exit(j_common_ptr cinfo) {
+            ErrorManager* error = reinterpret_cast<ErrorManager*>(cinfo->err);
+            (*cinfo->err->format_message)(cinfo, error->message);
+            std::longjmp(error->jump, 1);
+        }
+    };
+
+    /// The decoded image, kept so it only needs to be allocated once
+    std::vector<uint8_t> image;
+    /// Which rows of the image have a point near them
+    std::vector<bool> rows;
+    /// The dimensions of the last decoded image
+    vec2<int> image_dimensions = {{0, 0}};
+};
+
+}  // namespace visualmesh
+
+#endif  // !defined(VISUALMESH_DISABLE_JPEG)
+#endif  // VISUALMESH_UTILITY_JPEG_DECODER_HPP
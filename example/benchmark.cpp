@@ -26,6 +26,7 @@
 
 #include "Timer.hpp"
 #include "dataset.hpp"
+#include "example_network.hpp"
 #include "load_model.hpp"
 #include "visualmesh/engine/cpu/engine.hpp"
 #include "visualmesh/engine/opencl/engine.hpp"
@@ -33,15 +34,16 @@
 #include "visualmesh/geometry/Sphere.hpp"
 #include "visualmesh/model/ring6.hpp"
 #include "visualmesh/network_structure.hpp"
+#include "visualmesh/optimise_network.hpp"
 #include "visualmesh/utility/fourcc.hpp"
 #include "visualmesh/visualmesh.hpp"
 
 using Scalar = float;
 
-template <typename Engine, typename Mesh>
+template <typename Engine, typename Network, typename Mesh>
 class Benchmarker {
 public:
-    Benchmarker(const visualmesh::NetworkStructure<Scalar>& network,
+    Benchmarker(const Network& network,
                 const Mesh& mesh,
                 const std::vector<dataset_element<Scalar>>& dataset,
                 const int& loops)
@@ -73,8 +75,8 @@ private:
     std::thread thread;
 };
 
-template <typename Engine, typename Mesh>
-void benchmark(const visualmesh::NetworkStructure<Scalar>& network,
+template <typename Engine, typename Network, typename Mesh>
+void benchmark(const Network& network,
                const std::vector<dataset_element<Scalar>>& dataset,
                const Mesh& mesh,
                const int loops,
@@ -83,7 +85,7 @@ void benchmark(const visualmesh::NetworkStructure<Scalar>& network,
     using namespace std::chrono;
     Timer t;
     // Build engines
-    std::vector<Benchmarker<Engine, Mesh>> benchmarkers;
+    std::vector<Benchmarker<Engine, Network, Mesh>> benchmarkers;
     for (int t = 0; t < parallelity; ++t) {
         benchmarkers.emplace_back(network, mesh, dataset, loops);
     }
@@ -115,6 +117,13 @@ int main() {
     visualmesh::NetworkStructure<Scalar> network = load_model<Scalar>(model_path);
     t.measure("Loaded network from YAML file");
 
+    // The engines simplify the network when they are constructed, show how much that saves
+    visualmesh::OptimisationReport report;
+    visualmesh::optimise(network, report);
+    std::cout << "Optimised network from " << report.flops_before << " to " << report.flops_after
+              << " FLOPs per point (" << report.folded_layers << " layers folded, " << report.fused_affine_layers
+              << " affine layers fused, " << report.removed_channels << " channels removed)" << std::endl;
+
     // Build Mesh
     visualmesh::geometry::Sphere<Scalar> sphere(0.0949996);
     visualmesh::VisualMesh<Scalar, visualmesh::model::Ring6> mesh(sphere, 0.5, 1.5, 6, 0.5, 20);
@@ -138,4 +147,8 @@ int main() {
 
     std::cout << "Benchmarking CPU Engine" << std::endl;
     benchmark<visualmesh::engine::cpu::Engine<Scalar>>(network, dataset, mesh, 2, std::thread::hardware_concurrency());
+
+    std::cout << "Benchmarking CPU Engine with the compiled network" << std::endl;
+    benchmark<visualmesh::engine::cpu::Engine<Scalar>>(
+      visualmesh::compiled::example_network(), dataset, mesh, 2, std::thread::hardware_concurrency());
 }
@@ -18,9 +18,20 @@
 #ifndef LOAD_MODEL_HPP
 #define LOAD_MODEL_HPP
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include <yaml-cpp/yaml.h>
 
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
 #include "visualmesh/network_structure.hpp"
+#include "visualmesh/quantised_network.hpp"
 
 visualmesh::ActivationFunction activation_function(const std::string& name) {
     // clang-format off
@@ -28,15 +39,193 @@ visualmesh::ActivationFunction activation_function(const std::string& name) {
     else if (name == "softmax") { return visualmesh::ActivationFunction::SOFTMAX; }
     else if (name == "relu") { return visualmesh::ActivationFunction::RELU; }
     else if (name == "tanh") { return visualmesh::ActivationFunction::TANH; }
+    else if (name == "linear") { return visualmesh::ActivationFunction::LINEAR; }
     else { throw std::runtime_error("Unknown activation function " + name); }
     // clang-format on
 }
 
-template <typename Scalar>
-visualmesh::NetworkStructure<Scalar> load_model(const std::string& path) {
+std::string activation_name(const visualmesh::ActivationFunction& activation) {
+    switch (activation) {
+        case visualmesh::ActivationFunction::SELU: return "selu";
+        case visualmesh::ActivationFunction::SOFTMAX: return "softmax";
+        case visualmesh::ActivationFunction::RELU: return "relu";
+        case visualmesh::ActivationFunction::TANH: return "tanh";
+        case visualmesh::ActivationFunction::LINEAR: return "linear";
+        default: throw std::runtime_error("Unknown activation function");
+    }
+}
+
+/**
+ * @brief A read only view of a model written by training/binary_model.py
+ *
+ * @details
+ *  The file is memory mapped and the weights and biases of each layer are used in place, so nothing is parsed and the
+ *  only allocations are for the small table of layers. The format is little endian, as are all the platforms we run on.
+ *
+ *  The engines are constructed from a NetworkStructure, so structure() still copies the weights into one vector per
+ *  row just like the YAML loader does. Loading is faster because nothing is parsed, but the network takes the same
+ *  memory once it is built.
+ */
+class BinaryModel {
+public:
+    struct Layer {
+        /// The number of inputs to this layer
+        uint32_t input_dimensions;
+        /// The number of outputs from this layer
+        uint32_t output_dimensions;
+        /// The activation function applied to the outputs
+        visualmesh::ActivationFunction activation;
+        /// The weights stored in [input][output] order
+        const float* weights;
+        /// The biases for each output
+        const float* biases;
+        /// The number of rows of depthwise weights, zero unless the layer is depthwise separable
+        uint32_t depthwise_rows;
+        /// The depthwise weights stored in [neighbour][input] order
+        const float* depthwise;
+    };
+
+    explicit BinaryModel(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) { throw std::runtime_error("Failed to open the model " + path); }
+        struct stat info;
+        if (::fstat(fd, &info) != 0) {
+            ::close(fd);
+            throw std::runtime_error("Failed to read the size of the model " + path);
+        }
+        size = info.st_size;
+        data = size > 0 ? ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+        ::close(fd);
+        if (data == MAP_FAILED) { throw std::runtime_error("Failed to map the model " + path); }
 
+        try {
+            parse(path);
+        }
+        catch (...) {
+            ::munmap(data, size);
+            throw;
+        }
+    }
+
+    ~BinaryModel() {
+        ::munmap(data, size);
+    }
+
+    BinaryModel(const BinaryModel&)            = delete;
+    BinaryModel& operator=(const BinaryModel&) = delete;
+
+    /// The layers of each convolutional group pointing into the mapped file
+    const std::vector<std::vector<Layer>>& groups() const {
+        return network;
+    }
+
+    /**
+     * @brief Copies the mapped weights into a network structure the engines can be constructed from, allocating a
+     * vector for each row of weights
+     */
+    template <typename Scalar>
+    visualmesh::NetworkStructure<Scalar> structure() const {
+        visualmesh::NetworkStructure<Scalar> model(network.size());
+        for (std::size_t i = 0; i < network.size(); ++i) {
+            model[i].reserve(network[i].size());
+            for (const auto& layer : network[i]) {
+                std::vector<std::vector<Scalar>> weights;
+                weights.reserve(layer.input_dimensions);
+                for (uint32_t j = 0; j < layer.input_dimensions; ++j) {
+                    const float* row = layer.weights + j * layer.output_dimensions;
+                    weights.emplace_back(row, row + layer.output_dimensions);
+                }
+                visualmesh::Weights<Scalar> depthwise;
+                depthwise.reserve(layer.depthwise_rows);
+                for (uint32_t j = 0; j < layer.depthwise_rows; ++j) {
+                    const float* row = layer.depthwise + j * layer.input_dimensions;
+                    depthwise.emplace_back(row, row + layer.input_dimensions);
+                }
+                model[i].emplace_back(visualmesh::Layer<Scalar>{
+                  std::move(weights),
+                  std::vector<Scalar>(layer.biases, layer.biases + layer.output_dimensions),
+                  layer.activation,
+                  std::move(depthwise),
+                });
+            }
+        }
+        return model;
+    }
+
+private:
+    template <typename T>
+    T read(const std::size_t& offset, const std::string& path) const {
+        if (offset + sizeof(T) > size) { throw std::runtime_error("The model " + path + " is truncated"); }
+        T value;
+        std::memcpy(&value, static_cast<const char*>(data) + offset, sizeof(T));
+        return value;
+    }
+
+    const float* blob(const uint64_t& offset, const std::size_t& n, const std::string& path) const {
+        if (offset % alignof(float) != 0 || offset > size || n * sizeof(float) > size - offset) {
+            throw std::runtime_error("The model " + path + " is truncated");
+        }
+        return reinterpret_cast<const float*>(static_cast<const char*>(data) + offset);
+    }
+
+    void parse(const std::string& path) {
+        if (size < 16 || std::memcmp(data, "VMNB", 4) != 0) {
+            throw std::runtime_error(path + " is not a binary visual mesh model");
+        }
+        // Version 1 had no depthwise weights so its records are shorter
+        const uint32_t version = read<uint32_t>(4, path);
+        if (version != 1 && version != 2) {
+            throw std::runtime_error("Unsupported binary model version in " + path);
+        }
+        const std::size_t record_size = version == 1 ? 32 : 40;
+        const uint32_t n_groups = read<uint32_t>(8, path);
+        const uint32_t n_layers = read<uint32_t>(12, path);
+
+        std::size_t offset = 16;
+        std::size_t record = offset + 4 * std::size_t(n_groups);
+        uint32_t total     = 0;
+        network.resize(n_groups);
+        for (auto& group : network) {
+            const uint32_t count = read<uint32_t>(offset, path);
+            offset += 4;
+            if (count > n_layers - total) { throw std::runtime_error("The layer table of " + path + " is invalid"); }
+            total += count;
+
+            group.reserve(count);
+            for (uint32_t i = 0; i < count; ++i, record += record_size) {
+                const uint32_t input      = read<uint32_t>(record, path);
+                const uint32_t output     = read<uint32_t>(record + 4, path);
+                const uint32_t activation = read<uint32_t>(record + 8, path);
+                const uint32_t depthwise  = version == 1 ? 0 : read<uint32_t>(record + 12, path);
+                if (activation > visualmesh::ActivationFunction::LINEAR) {
+                    throw std::runtime_error("Unknown activation function in " + path);
+                }
+                group.push_back(Layer{
+                  input,
+                  output,
+                  static_cast<visualmesh::ActivationFunction>(activation),
+                  blob(read<uint64_t>(record + 16, path), std::size_t(input) * output, path),
+                  blob(read<uint64_t>(record + 24, path), output, path),
+                  depthwise,
+                  depthwise == 0 ? nullptr
+                                 : blob(read<uint64_t>(record + 32, path), std::size_t(depthwise) * input, path),
+                });
+            }
+        }
+        if (total != n_layers) { throw std::runtime_error("The layer table of " + path + " is invalid"); }
+    }
+
+    /// The mapped file
+    void* data;
+    /// The size of the mapped file in bytes
+    std::size_t size;
+    /// The layers found in the file
+    std::vector<std::vector<Layer>> network;
+};
+
+template <typename Scalar>
+visualmesh::NetworkStructure<Scalar> parse_model(const YAML::Node& config) {
     visualmesh::NetworkStructure<Scalar> model;
-    YAML::Node config = YAML::LoadFile(path);
     for (const auto& conv : config) {
         model.emplace_back();
         auto& net_conv = model.back();
@@ -46,6 +235,107 @@ visualmesh::NetworkStructure<Scalar> load_model(const std::string& path) {
               layer["weights"].as<std::vector<std::vector<Scalar>>>(),
               layer["biases"].as<std::vector<Scalar>>(),
               activation_function(layer["activation"].as<std::string>()),
+              layer["depthwise"] ? layer["depthwise"].as<std::vector<std::vector<Scalar>>>()
+                                 : std::vector<std::vector<Scalar>>(),
+            });
+        }
+    }
+    return model;
+}
+
+template <typename Scalar>
+visualmesh::NetworkStructure<Scalar> load_model(const std::string& path) {
+
+    // Binary models are mapped rather than parsed
+    if (path.size() >= 4 && path.compare(path.size() - 4, 4, ".bin") == 0) {
+        return BinaryModel(path).structure<Scalar>();
+    }
+
+    return parse_model<Scalar>(YAML::LoadFile(path));
+}
+
+/**
+ * @brief Loads a branching model, a yaml file with a trunk and a map of named heads each in the same form as a model
+ */
+template <typename Scalar>
+visualmesh::BranchingNetwork<Scalar> load_branching_model(const std::string& path) {
+    YAML::Node config = YAML::LoadFile(path);
+
+    visualmesh::BranchingNetwork<Scalar> model;
+    model.trunk = parse_model<Scalar>(config["trunk"]);
+    for (const auto& head : config["heads"]) {
+        model.heads.push_back({head.first.as<std::string>(), parse_model<Scalar>(head.second)});
+    }
+    return model;
+}
+
+/**
+ * @brief Gives the path that the quantised version of a model is stored at, next to the original (model.int8.yaml)
+ */
+inline std::string quantised_model_path(const std::string& path) {
+    const auto dot = path.rfind('.');
+    return (dot == std::string::npos ? path : path.substr(0, dot)) + ".int8.yaml";
+}
+
+template <typename Scalar>
+void save_quantised_model(const std::string& path, const visualmesh::QuantisedNetwork<Scalar>& model) {
+
+    YAML::Emitter out;
+    out << YAML::BeginSeq;
+    for (const auto& conv : model) {
+        out << YAML::BeginSeq;
+        for (const auto& layer : conv) {
+            // int8_t would be written as characters so widen the weights
+            std::vector<std::vector<int>> weights;
+            for (const auto& w : layer.weights) {
+                weights.emplace_back(w.begin(), w.end());
+            }
+
+            out << YAML::BeginMap;
+            out << YAML::Key << "input" << YAML::Value << YAML::Flow << YAML::BeginMap;
+            out << YAML::Key << "scale" << YAML::Value << layer.input.scale;
+            out << YAML::Key << "zero_point" << YAML::Value << layer.input.zero_point;
+            out << YAML::EndMap;
+            out << YAML::Key << "weights" << YAML::Value << YAML::BeginSeq;
+            for (const auto& w : weights) {
+                out << YAML::Flow << w;
+            }
+            out << YAML::EndSeq;
+            out << YAML::Key << "weight_scales" << YAML::Value << YAML::Flow << layer.weight_scales;
+            out << YAML::Key << "biases" << YAML::Value << YAML::Flow << layer.biases;
+            out << YAML::Key << "activation" << YAML::Value << activation_name(layer.activation);
+            out << YAML::EndMap;
+        }
+        out << YAML::EndSeq;
+    }
+    out << YAML::EndSeq;
+
+    std::ofstream file(path);
+    file << out.c_str() << std::endl;
+    if (!file) { throw std::runtime_error("Failed to write the quantised model to " + path); }
+}
+
+template <typename Scalar>
+visualmesh::QuantisedNetwork<Scalar> load_quantised_model(const std::string& path) {
+
+    visualmesh::QuantisedNetwork<Scalar> model;
+    YAML::Node config = YAML::LoadFile(path);
+    for (const auto& conv : config) {
+        model.emplace_back();
+        auto& net_conv = model.back();
+
+        for (const auto& layer : conv) {
+            std::vector<std::vector<int8_t>> weights;
+            for (const auto& w : layer["weights"].as<std::vector<std::vector<int>>>()) {
+                weights.emplace_back(w.begin(), w.end());
+            }
+
+            net_conv.emplace_back(visualmesh::QuantisedLayer<Scalar>{
+              {layer["input"]["scale"].as<Scalar>(), layer["input"]["zero_point"].as<int32_t>()},
+              std::move(weights),
+              layer["weight_scales"].as<std::vector<Scalar>>(),
+              layer["biases"].as<std::vector<int32_t>>(),
+              activation_function(layer["activation"].as<std::string>()),
             });
         }
     }
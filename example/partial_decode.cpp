@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2017-2020 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <yaml-cpp/yaml.h>
+
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "Timer.hpp"
+#include "load_model.hpp"
+#include "visualmesh/engine/cpu/engine.hpp"
+#include "visualmesh/geometry/Sphere.hpp"
+#include "visualmesh/model/ring6.hpp"
+#include "visualmesh/utility/fourcc.hpp"
+#include "visualmesh/utility/jpeg_decoder.hpp"
+#include "visualmesh/visualmesh.hpp"
+
+int main(int argc, const char* argv[]) {
+
+    if (argc < 4) {
+        std::cerr << "Usage: " << argv[0] << " <model.yaml> <image.jpg> <lens.yaml>" << std::endl;
+        return 1;
+    }
+
+    // Read the compressed image without decoding it
+    std::ifstream file(argv[2], std::ios::binary);
+    const std::vector<uint8_t> jpeg((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    // Load the lens, its dimensions come from the image once it has been decoded
+    YAML::Node config            = YAML::LoadFile(argv[3]);
+    const std::string projection = config["projection"].as<std::string>();
+    visualmesh::Lens<float> lens;
+    lens.projection   = projection == "RECTILINEAR"   ? visualmesh::RECTILINEAR
+                        : projection == "EQUIDISTANT" ? visualmesh::EQUIDISTANT
+                                                      : visualmesh::EQUISOLID;
+    lens.focal_length = config["focal_length"].as<float>();
+    lens.centre       = config["centre"].as<visualmesh::vec2<float>>();
+    lens.k            = config["k"].as<visualmesh::vec2<float>>();
+    lens.fov          = config["fov"].as<float>();
+    const auto Hoc    = config["Hoc"].as<visualmesh::mat4<float>>();
+
+    // Read the size of the image from the header by decoding it with no points
+    visualmesh::JPEGDecoder decoder;
+    decoder.decode(jpeg.data(), jpeg.size(), std::vector<visualmesh::vec2<float>>());
+    lens.dimensions = decoder.dimensions();
+
+    visualmesh::VisualMesh<float, visualmesh::model::Ring6> mesh(
+      visualmesh::geometry::Sphere<float>(0.0949996), 0.5, 1.5, 6, 0.5, 20);
+    visualmesh::engine::cpu::Engine<float> engine(load_model<float>(argv[1]));
+
+    // Project the mesh, decode only the parts of the image the points sample, and classify them
+    Timer t;
+    auto projected = engine(mesh, Hoc, lens);
+    t.measure("Projected the mesh");
+    const uint8_t* image = decoder.decode(jpeg.data(), jpeg.size(), projected.pixel_coordinates);
+    t.measure("Decoded the sampled parts of the image");
+    auto classified = engine(projected, lens, image, visualmesh::fourcc("BGRA"));
+    t.measure("Classified the mesh");
+
+    std::cout << "Classified " << classified.front().global_indices.size() << " points" << std::endl;
+    return 0;
+}
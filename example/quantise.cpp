@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2017-2020 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "Timer.hpp"
+#include "dataset.hpp"
+#include "load_model.hpp"
+#include "visualmesh/engine/cpu/engine.hpp"
+#include "visualmesh/geometry/Sphere.hpp"
+#include "visualmesh/model/ring6.hpp"
+#include "visualmesh/network_structure.hpp"
+#include "visualmesh/optimise_network.hpp"
+#include "visualmesh/quantised_network.hpp"
+#include "visualmesh/utility/fourcc.hpp"
+#include "visualmesh/visualmesh.hpp"
+
+using Scalar = float;
+
+int main() {
+    std::string image_path = "../example/images";
+    std::string model_path = "../example/model.yaml";
+
+    Timer t;
+
+    // Load the classification network
+    visualmesh::NetworkStructure<Scalar> network = load_model<Scalar>(model_path);
+    t.measure("Loaded network from YAML file");
+
+    // Build Mesh
+    visualmesh::geometry::Sphere<Scalar> sphere(0.0949996);
+    visualmesh::VisualMesh<Scalar, visualmesh::model::Ring6> mesh(sphere, 0.5, 1.5, 6, 0.5, 20);
+    t.measure("Built mesh");
+
+    // Load dataset
+    auto dataset = load_dataset<Scalar>(image_path);
+    t.measure("Loaded dataset");
+
+    // Find the range of the values at the input of each layer over the dataset
+    visualmesh::engine::cpu::Engine<Scalar> engine(network);
+    for (const auto& element : dataset) {
+        engine.calibrate(mesh, element.Hoc, element.lens, element.image.data, visualmesh::fourcc("BGRA"));
+    }
+    t.measure("Calibrated network");
+
+    // Quantise and store the model next to the original, the engine calibrated the optimised network
+    const std::string quantised_path = quantised_model_path(model_path);
+    save_quantised_model(quantised_path, visualmesh::quantise(visualmesh::optimise(network), engine.calibration()));
+    t.measure("Saved quantised network");
+
+    // Compare the classifications of the two networks
+    visualmesh::engine::cpu::Engine<Scalar> quantised(load_quantised_model<Scalar>(quantised_path));
+    int agree = 0;
+    int total = 0;
+    for (const auto& element : dataset) {
+        const auto a = engine(mesh, element.Hoc, element.lens, element.image.data, visualmesh::fourcc("BGRA"));
+        const auto b = quantised(mesh, element.Hoc, element.lens, element.image.data, visualmesh::fourcc("BGRA"));
+
+        const int n_classes = network.back().back().biases.size();
+        for (unsigned int i = 0; i + n_classes <= a.classifications.size(); i += n_classes) {
+            auto a_begin = std::next(a.classifications.begin(), i);
+            auto b_begin = std::next(b.classifications.begin(), i);
+            agree += std::distance(a_begin, std::max_element(a_begin, std::next(a_begin, n_classes)))
+                     == std::distance(b_begin, std::max_element(b_begin, std::next(b_begin, n_classes)));
+            ++total;
+        }
+    }
+    std::cout << "Quantised network agrees with the original on " << (100.0 * agree / total) << "% of points"
+              << std::endl;
+}
@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2017-2020 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch2/catch.hpp>
+#include <cstdint>
+#include <vector>
+
+#include "visualmesh/engine/cpu/engine.hpp"
+#include "visualmesh/engine/opencl/engine.hpp"
+#include "visualmesh/frame.hpp"
+#include "visualmesh/geometry/Sphere.hpp"
+#include "visualmesh/lens.hpp"
+#include "visualmesh/model/ring6.hpp"
+#include "visualmesh/network_structure.hpp"
+#include "visualmesh/output_mode.hpp"
+#include "visualmesh/utility/fourcc.hpp"
+#include "visualmesh/utility/math.hpp"
+#include "visualmesh/visualmesh.hpp"
+
+namespace {
+
+// A single layer network reading the point and its six neighbours and giving three classes
+visualmesh::NetworkStructure<float> test_network() {
+    visualmesh::Layer<float> layer;
+    layer.weights.resize(4 * 7, std::vector<float>(3));
+    for (unsigned int i = 0; i < layer.weights.size(); ++i) {
+        for (unsigned int j = 0; j < 3; ++j) {
+            layer.weights[i][j] = float((i * 7 + j * 3) % 11) / 11.0f - 0.5f;
+        }
+    }
+    layer.biases     = {0.1f, -0.2f, 0.0f};
+    layer.activation = visualmesh::SOFTMAX;
+    return visualmesh::NetworkStructure<float>{{layer}};
+}
+
+visualmesh::Lens<float> test_lens() {
+    visualmesh::Lens<float> lens;
+    lens.dimensions   = {{640, 480}};
+    lens.projection   = visualmesh::RECTILINEAR;
+    lens.focal_length = 434.0f;
+    lens.centre       = {{0.0f, 0.0f}};
+    lens.k            = {{0.0f, 0.0f}};
+    lens.fov          = 1.66562f;
+    return lens;
+}
+
+visualmesh::mat4<float> test_Hoc() {
+    return visualmesh::mat4<float>{{
+      {{-0.316188f, -0.144188f, 0.937675f, 0.0f}},
+      {{0.181584f, 0.960911f, 0.208992f, 0.0f}},
+      {{-0.931160f, 0.236217f, -0.277669f, 0.8f}},
+      {{0.0f, 0.0f, 0.0f, 1.0f}},
+    }};
+}
+
+// A BGRA image with a different pattern for each seed
+std::vector<uint8_t> test_image(const visualmesh::Lens<float>& lens, const int& seed) {
+    std::vector<uint8_t> image(lens.dimensions[0] * lens.dimensions[1] * 4);
+    for (unsigned int i = 0; i < image.size(); ++i) {
+        image[i] = uint8_t((i * (seed + 3) / 7 + seed * 31) % 256);
+    }
+    return image;
+}
+
+// Classifying a batch in a label mode should give the same labels as classifying each frame alone, and no
+// classifications since the label modes don't read them back
+template <typename Engine>
+void check_batch_labels(Engine& engine, const visualmesh::OutputMode& mode) {
+    const visualmesh::VisualMesh<float, visualmesh::model::Ring6> mesh(
+      visualmesh::geometry::Sphere<float>(0.0949996f), 0.5f, 1.5f, 4, 0.5f, 20);
+    const auto lens                = test_lens();
+    const auto Hoc                 = test_Hoc();
+    const std::vector<uint8_t> im0 = test_image(lens, 0);
+    const std::vector<uint8_t> im1 = test_image(lens, 1);
+    const uint32_t format          = visualmesh::fourcc("BGRA");
+
+    engine.set_output_mode(mode);
+    const auto batch = engine(std::vector<visualmesh::Frame<float, visualmesh::model::Ring6>>{
+      {mesh, Hoc, lens, im0.data(), format}, {mesh, Hoc, lens, im1.data(), format}});
+    const auto first  = engine(mesh, Hoc, lens, im0.data(), format);
+    const auto second = engine(mesh, Hoc, lens, im1.data(), format);
+
+    REQUIRE(batch.size() == 2);
+    REQUIRE(!first.global_indices.empty());
+    REQUIRE(batch[0].global_indices == first.global_indices);
+    REQUIRE(batch[1].global_indices == second.global_indices);
+    REQUIRE(batch[0].classifications.empty());
+    REQUIRE(batch[1].classifications.empty());
+    REQUIRE(batch[0].labels == first.labels);
+    REQUIRE(batch[1].labels == second.labels);
+    REQUIRE(batch[0].confidence == first.confidence);
+    REQUIRE(batch[1].confidence == second.confidence);
+}
+
+}  // namespace
+
+TEST_CASE("The CPU engine classifies batches in the label modes", "[engine][cpu]") {
+    visualmesh::engine::cpu::Engine<float> engine(test_network());
+    check_batch_labels(engine, visualmesh::LABELS);
+    check_batch_labels(engine, visualmesh::LABELS_AND_CONFIDENCE);
+}
+
+#if !defined(VISUALMESH_DISABLE_OPENCL)
+TEST_CASE("The OpenCL engine classifies batches in the label modes", "[engine][opencl]") {
+    visualmesh::engine::opencl::Engine<float> engine(test_network());
+    check_batch_labels(engine, visualmesh::LABELS);
+    check_batch_labels(engine, visualmesh::LABELS_AND_CONFIDENCE);
+}
+#endif  // !defined(VISUALMESH_DISABLE_OPENCL)
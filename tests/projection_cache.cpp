@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2017-2020 Trent Houliston <trent@houliston.me>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+ * documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+ * WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+ * OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch2/catch.hpp>
+#include <cmath>
+#include <vector>
+
+#include "visualmesh/engine/projection_cache.hpp"
+#include "visualmesh/lens.hpp"
+#include "visualmesh/projected_mesh.hpp"
+#include "visualmesh/utility/math.hpp"
+
+namespace {
+
+// The cache only needs the number of nodes in a mesh to tell meshes apart
+struct TestMesh {
+    std::vector<int> nodes = std::vector<int>(10);
+};
+
+// The fisheye camera from example image 1, whose corners are outside of its field of view
+visualmesh::Lens<float> equisolid_lens() {
+    visualmesh::Lens<float> lens;
+    lens.dimensions   = {{1280, 1024}};
+    lens.projection   = visualmesh::EQUISOLID;
+    lens.focal_length = 420.0f;
+    lens.centre       = {{0.0f, 0.0f}};
+    lens.k            = {{0.0f, 0.0f}};
+    lens.fov          = 1.80248f;
+    return lens;
+}
+
+visualmesh::mat4<float> example_Hoc() {
+    return visualmesh::mat4<float>{{
+      {{-0.244225f, -0.905877f, 0.346036f, 0.0f}},
+      {{-0.0304556f, 0.363831f, 0.930967f, 0.0f}},
+      {{-0.96924f, 0.216827f, -0.116446f, 0.8f}},
+      {{0.0f, 0.0f, 0.0f, 1.0f}},
+    }};
+}
+
+// Rotates the camera about the world z axis
+visualmesh::mat4<float> yaw(const visualmesh::mat4<float>& Hoc, const float& angle) {
+    const float c = std::cos(angle);
+    const float s = std::sin(angle);
+    visualmesh::mat4<float> rotated = Hoc;
+    for (int i = 0; i < 4; ++i) {
+        rotated[0][i] = c * Hoc[0][i] - s * Hoc[1][i];
+        rotated[1][i] = s * Hoc[0][i] + c * Hoc[1][i];
+    }
+    return rotated;
+}
+
+}  // namespace
+
+TEST_CASE("An unchanged pose has no displacement on an equisolid lens", "[projection_cache]") {
+    const auto lens = equisolid_lens();
+    const auto Hoc  = example_Hoc();
+
+    const float same = visualmesh::engine::ProjectionCache<float>::displacement(Hoc, lens, Hoc, lens);
+    REQUIRE(std::isfinite(same));
+    REQUIRE(same < 0.01f);
+
+    // A milliradian of yaw moves the pixels by about the focal length in milliradians
+    const float moved = visualmesh::engine::ProjectionCache<float>::displacement(Hoc, lens, yaw(Hoc, 0.001f), lens);
+    REQUIRE(moved > 0.1f);
+    REQUIRE(moved < 1.0f);
+}
+
+TEST_CASE("A cached projection is reused for an unchanged pose on an equisolid lens", "[projection_cache]") {
+    const auto lens = equisolid_lens();
+    const auto Hoc  = example_Hoc();
+    TestMesh mesh;
+
+    visualmesh::engine::ProjectionCache<float> cache(0.5f);
+    visualmesh::ProjectedMesh<float, 6> projected;
+    projected.global_indices = {1, 2, 3};
+    cache.store(mesh, Hoc, lens, projected);
+
+    const auto found = cache.find<6>(mesh, Hoc, lens);
+    REQUIRE(found != nullptr);
+    REQUIRE(found->global_indices == projected.global_indices);
+
+    // Yawing by a tenth of a radian moves the image far outside the tolerance
+    REQUIRE(cache.find<6>(mesh, yaw(Hoc, 0.1f), lens) == nullptr);
+}
+
+TEST_CASE("A speculative projection for an exactly predicted pose is accepted on an equisolid lens",
+          "[projection_cache]") {
+    const auto lens = equisolid_lens();
+    const auto Hoc  = example_Hoc();
+    TestMesh mesh;
+
+    // Speculations are used even when the cache itself is disabled
+    visualmesh::engine::ProjectionCache<float> cache;
+    cache.speculate<6>(mesh, Hoc, lens, 0.5f, [](const TestMesh&, const visualmesh::mat4<float>&, const auto&) {
+        visualmesh::ProjectedMesh<float, 6> projected;
+        projected.global_indices = {4, 5, 6};
+        return projected;
+    });
+
+    const auto found = cache.find<6>(mesh, Hoc, lens);
+    REQUIRE(found != nullptr);
+    REQUIRE(found->global_indices == std::vector<int>{4, 5, 6});
+}
@@ -0,0 +1,117 @@
+# Copyright (C) 2017-2020 Trent Houliston <trent@houliston.me>
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+# documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+# rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+# permit persons to whom the Software is furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+# Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+# WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+# COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+# OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+"""
+A compact binary format for exported networks that can be memory mapped by the c++ code instead of parsing YAML.
+
+All values are little endian. The file starts with a header
+    char[4]  magic "VMNB"
+    uint32   format version (2)
+    uint32   number of convolutional groups
+    uint32   total number of layers
+followed by the number of layers in each group as a uint32 and then a 40 byte record for each layer
+    uint32   input dimensions
+    uint32   output dimensions
+    uint32   activation function (0 selu, 1 relu, 2 softmax, 3 tanh, 4 linear)
+    uint32   rows of depthwise weights, the neighbourhood size for a depthwise separable layer and 0 otherwise
+    uint64   byte offset of the weights from the start of the file
+    uint64   byte offset of the biases from the start of the file
+    uint64   byte offset of the depthwise weights from the start of the file (0 if there are none)
+The weights of each layer are stored as float32 in [input][output] order, the biases as float32 and the depthwise
+weights as float32 in [neighbour][input] order, each starting on a 64 byte boundary so they can be used in place once
+mapped. Version 1 had 32 byte records without the depthwise weights.
+"""
+
+import struct
+import sys
+
+import yaml
+
+MAGIC = b"VMNB"
+VERSION = 2
+ALIGNMENT = 64
+ACTIVATIONS = ["selu", "relu", "softmax", "tanh", "linear"]
+
+
+def _align(offset):
+    return (offset + ALIGNMENT - 1) // ALIGNMENT * ALIGNMENT
+
+
+def write(stages, path):
+    """Write a network in the same structure as the exported model.yaml (a list of groups of layers) to path"""
+
+    layers = [layer for group in stages for layer in group]
+
+    # Lay out the blobs after the header
+    offset = 16 + 4 * len(stages) + 40 * len(layers)
+    records = []
+    blobs = []
+    for layer in layers:
+        weights = [w for row in layer["weights"] for w in row]
+        biases = layer["biases"]
+        input_dims = len(layer["weights"])
+        output_dims = len(biases)
+        if len(weights) != input_dims * output_dims:
+            raise ValueError("The weights of a layer are not a {}x{} matrix".format(input_dims, output_dims))
+
+        depthwise_rows = len(layer.get("depthwise", []))
+        depthwise = [w for row in layer.get("depthwise", []) for w in row]
+        if len(depthwise) != depthwise_rows * input_dims:
+            raise ValueError("The depthwise weights of a layer do not have {} columns".format(input_dims))
+
+        weights_offset = _align(offset)
+        biases_offset = _align(weights_offset + 4 * len(weights))
+        offset = biases_offset + 4 * len(biases)
+        depthwise_offset = 0
+        if depthwise_rows > 0:
+            depthwise_offset = _align(offset)
+            offset = depthwise_offset + 4 * len(depthwise)
+
+        records.append(
+            struct.pack(
+                "<IIIIQQQ",
+                input_dims,
+                output_dims,
+                ACTIVATIONS.index(layer["activation"]),
+                depthwise_rows,
+                weights_offset,
+                biases_offset,
+                depthwise_offset,
+            )
+        )
+        blobs.append((weights_offset, struct.pack("<{}f".format(len(weights)), *weights)))
+        blobs.append((biases_offset, struct.pack("<{}f".format(len(biases)), *biases)))
+        if depthwise_rows > 0:
+            blobs.append((depthwise_offset, struct.pack("<{}f".format(len(depthwise)), *depthwise)))
+
+    with open(path, "wb") as out:
+        out.write(MAGIC)
+        out.write(struct.pack("<III", VERSION, len(stages), len(layers)))
+        out.write(struct.pack("<{}I".format(len(stages)), *[len(group) for group in stages]))
+        for record in records:
+            out.write(record)
+        for blob_offset, blob in blobs:
+            out.write(b"\0" * (blob_offset - out.tell()))
+            out.write(blob)
+
+
+if __name__ == "__main__":
+    # Convert an existing model.yaml into the binary format
+    if len(sys.argv) != 3:
+        print("Usage: {} model.yaml model.bin".format(sys.argv[0]))
+        exit(1)
+
+    with open(sys.argv[1], "r") as f:
+        write(yaml.safe_load(f), sys.argv[2])
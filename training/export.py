@@ -20,8 +20,10 @@ import yaml
 
 import tensorflow as tf
 
+from . import binary_model
 from .dataset import keras_dataset
 from .flavour import Dataset
+from .layer.depthwise_seperable_graph_convolution import DepthwiseSeparableGraphConvolution
 from .layer.graph_convolution import GraphConvolution
 from .model import VisualMeshModel
 
@@ -69,6 +71,18 @@ def export(config, output_path):
                     }
                 ]
             )
+        elif type(op[0]) is DepthwiseSeparableGraphConvolution:
+            op = op[0].depthwise
+            stages.append(
+                [
+                    {
+                        "depthwise": op.depthwise_weights.numpy().tolist(),
+                        "weights": op.pointwise.weights[0].numpy().tolist(),
+                        "biases": op.pointwise.weights[1].numpy().tolist(),
+                        "activation": op.pointwise.activation.__name__,
+                    }
+                ]
+            )
         elif type(op[0]) is tf.keras.layers.Dense:
             op = op[0]
             stages[-1].append(
@@ -78,17 +92,41 @@ def export(config, output_path):
                     "activation": op.activation.__name__,
                 }
             )
+        elif type(op[0]) is tf.keras.layers.BatchNormalization and len(stages) > 0:
+            # At inference batch normalisation scales and shifts each channel, so it is exported as a diagonal layer
+            # with a linear activation which the c++ code fuses into the layers around it
+            op = op[0]
+            scale = tf.math.rsqrt(op.moving_variance + op.epsilon) * (op.gamma if op.gamma is not None else 1.0)
+            shift = (op.beta if op.beta is not None else 0.0) - op.moving_mean * scale
+            stages[-1].append(
+                {
+                    "weights": tf.linalg.diag(scale).numpy().tolist(),
+                    "biases": shift.numpy().tolist(),
+                    "activation": "linear",
+                }
+            )
         else:
-            print("Error: currently we can only export GraphConvolution and Dense layers")
+            print(
+                "Error: currently we can only export GraphConvolution, DepthwiseSeparableGraphConvolution, Dense and"
+                " BatchNormalization layers"
+            )
             exit(1)
 
     # While we have a 3 values on our input, all the c++ take 4 due to alignment issues
     # Therefore for that weights we need to increase it to 4
-    first = tf.convert_to_tensor(stages[0][0]["weights"])
-    first = tf.reshape(first, (-1, 3, first.shape[-1]))
-    first = tf.pad(first, [[0, 0], [0, 1], [0, 0]])
-    first = tf.reshape(first, (-1, first.shape[-1]))
-    stages[0][0]["weights"] = first.numpy().tolist()
+    if "depthwise" in stages[0][0]:
+        # The depthwise weights have a column and the pointwise weights a row for each input channel
+        stages[0][0]["depthwise"] = tf.pad(stages[0][0]["depthwise"], [[0, 0], [0, 1]]).numpy().tolist()
+        stages[0][0]["weights"] = tf.pad(stages[0][0]["weights"], [[0, 1], [0, 0]]).numpy().tolist()
+    else:
+        first = tf.convert_to_tensor(stages[0][0]["weights"])
+        first = tf.reshape(first, (-1, 3, first.shape[-1]))
+        first = tf.pad(first, [[0, 0], [0, 1], [0, 0]])
+        first = tf.reshape(first, (-1, first.shape[-1]))
+        stages[0][0]["weights"] = first.numpy().tolist()
 
     with open(os.path.join(output_path, "model.yaml"), "w") as out:
         yaml.dump(stages, out, default_flow_style=None, width=float("inf"))
+
+    # Also write the binary version which is much faster to load
+    binary_model.write(stages, os.path.join(output_path, "model.bin"))